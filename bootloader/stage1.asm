@@ -1,5 +1,9 @@
 ;  ___________________
-; |        Free       | -> We will use this region for Protected Mode kernel.
+; |      Kernel       | -> Copied up by stage2 (kernel.ld).
+; |___________________| 0x100000
+;         ...
+; |___________________|
+; |  Bounce buffer    | -> stage2 reads the kernel here in chunks.
 ; |___________________| 0x010000
 ; |    Second-Stage   |
 ; |      Loader       |
@@ -32,7 +36,7 @@ Start:
 LoadStage2:
 	mov si, ReadPacket
 	mov word[si],   0x10
-	mov word[si+2], 0x05
+	mov word[si+2], 0x08	; All of stage2 (LBA 1-8, the kernel starts at 9)
 	mov word[si+4], 0x7E00	; Offset in Memory to Load
 	mov word[si+6], 0x00	; Segement in Memory to Load
 	mov dword[si+8], 0x01	; Read from LBA = 1
@@ -43,6 +47,7 @@ LoadStage2:
 	jc ReadError
 
 ReadSuccess:	
+	push dx			; BIOS boot drive (dl), handed on to stage2
 	mov ah, 0x13
 	mov al, 1
 	mov bx, 0xA
@@ -52,6 +57,7 @@ ReadSuccess:
 	int 0x10
 
 	; Transfer control to loaded memory
+	pop dx
 	jmp 0x7E00
 	
 
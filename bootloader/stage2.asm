@@ -3,8 +3,69 @@ BITS 16
 [org 0x7e00]
 %endif
 
+; Kernel image header, written by kernel_entry.asm at KERNEL_HDR_OFFSET bytes
+; into the image:
+;   [+0]  magic 'KVHD'
+;   [+4]  physical load address
+;   [+8]  end of the file image (start of .bss)
+;   [+12] end of the memory image (end of .bss)
+;   [+16] entry point
+KERNEL_LBA          equ 9
+KERNEL_HDR_OFFSET   equ 8
+KERNEL_MAGIC        equ 'KVHD'
+KHDR_MAGIC          equ KERNEL_HDR_OFFSET
+KHDR_LOAD           equ KERNEL_HDR_OFFSET + 4
+KHDR_LOAD_END       equ KERNEL_HDR_OFFSET + 8
+KHDR_BSS_END        equ KERNEL_HDR_OFFSET + 12
+KHDR_ENTRY          equ KERNEL_HDR_OFFSET + 16
+
+; EDD reads land here (below 1MiB) and are copied up to the load address
+BOUNCE_SEG          equ 0x1000
+BOUNCE_ADDR         equ BOUNCE_SEG << 4
+MAX_SECTORS         equ 127         ; Largest transfer every EDD BIOS accepts
+
+; struct boot_info (kernel/include/boot_info.h), handed to the kernel in ebx
+BOOT_INFO_MAGIC     equ 'BINF'
+BOOT_INFO_VERSION   equ 2
+BI_FLAGS            equ 8
+BI_KERNEL_START     equ 12
+BI_KERNEL_END       equ 16
+BI_MMAP_ADDR        equ 20
+BI_MMAP_COUNT       equ 24
+BI_BOOT_DRIVE       equ 28
+BI_VIDEO_MODE       equ 32
+BI_ACPI_RSDP        equ 36
+BI_CMDLINE          equ 40
+BI_FB               equ 44
+BI_TSC_STAGE2       equ 68
+BI_TSC_LOADED       equ 76
+BI_TSC_HANDOFF      equ 84
+BI_SIZE             equ 92
+
+BOOT_INFO_MMAP          equ 1 << 0
+BOOT_INFO_KERNEL_RANGE  equ 1 << 1
+BOOT_INFO_BOOT_DRIVE    equ 1 << 2
+BOOT_INFO_VIDEO_MODE    equ 1 << 3
+BOOT_INFO_ACPI_RSDP     equ 1 << 4
+BOOT_INFO_FRAMEBUFFER   equ 1 << 5
+BOOT_INFO_TSC           equ 1 << 7
+
+; Record rdtsc in a boot_info field, for the kernel's boot profiler
+%macro STAMP 1
+    rdtsc
+    mov [BootInfo + %1], eax
+    mov [BootInfo + %1 + 4], edx
+%endmacro
+
+E820_MAP            equ 0x5000      ; Scratch for the E820 entries (below 1MiB)
+
 Start:
-    mov dl, 0x80
+    ; stage1 passes on the BIOS boot drive in dl
+    mov [BootInfo + BI_BOOT_DRIVE], dl
+    or dword [BootInfo + BI_FLAGS], BOOT_INFO_BOOT_DRIVE
+    STAMP BI_TSC_STAGE2
+    mov dl, [BootInfo + BI_BOOT_DRIVE]
+
     mov ah, 0x41
     mov bx, 0x55AA
     int 0x13
@@ -12,33 +73,88 @@ Start:
     cmp bx, 0xAA55
     jne NotSupported
 
-    ; ReadPacket - 16 Bytes.
-    ; si = *ReadPacket
-    ; [si]              - to store the size of Read Packet
-    ; [si+1]            - Reserved (must be 0)
-    ; [si+2] [si+3]     - to store the number of sectors to Read
-    ; [si+4] [si+5]     - Offset to Load the Read content
-    ; [si+6] [si+7]     - Segment to Load the Read content
-    ; [si+8] [si+15]    - LBA to Read from the Disk
-    ; 1. Load the Kernel into memory 0x10000 ()
-    ; [PMM] Reserved kernel range: 0x65536 - 0x78800 
+    ; The kernel lives at 1MiB and above: without A20 those writes would
+    ; wrap around to low memory
+    call EnableA20
+    jc A20Error
+
+    ; 1. Load the Kernel to its load address (1MiB)
+    ;    Read the first sector for the header, then the whole image in
+    ;    MAX_SECTORS chunks through the bounce buffer
 LoadKernel:
-    mov si, ReadPacket
-    mov word[si], 0x10
-    mov word[si+2], 0x30        ; Load 16 sectors from the Disk 
-    mov word[si+4], 0x00
-    mov word[si+6], 0x1000      ; Segment to Load to Load
-    mov dword[si+8], 0x09        ; Read from the 10th Sector (LBA=9, offset 0x1200)
-    mov dword[si+12], 0x00
+    mov eax, KERNEL_LBA
+    mov cx, 1
+    call ReadSectors
+    jc ReadError
 
-    mov ah, 0x42
-    int 0x13
+    call EnterUnrealMode
+    mov esi, BOUNCE_ADDR
+    cmp dword [esi + KHDR_MAGIC], KERNEL_MAGIC
+    jne BadKernel
+
+    mov eax, [esi + KHDR_LOAD]
+    mov [kernel_load], eax
+    mov [kernel_dest], eax
+    mov ebx, [esi + KHDR_LOAD_END]
+    mov [kernel_load_end], ebx
+    mov ecx, [esi + KHDR_BSS_END]
+    mov [kernel_bss_end], ecx
+    mov edx, [esi + KHDR_ENTRY]
+    mov [kernel_entry], edx
+
+    ; sectors = (load_end - load + 511) / 512
+    sub ebx, eax
+    add ebx, 511
+    shr ebx, 9
+    mov [kernel_sectors], ebx
+    mov dword [kernel_lba], KERNEL_LBA
+
+.chunk:
+    mov ecx, [kernel_sectors]
+    test ecx, ecx
+    jz .loaded
+    cmp ecx, MAX_SECTORS
+    jbe .read
+    mov ecx, MAX_SECTORS
+.read:
+    mov eax, [kernel_lba]
+    call ReadSectors
     jc ReadError
+    add [kernel_lba], ecx
+    sub [kernel_sectors], ecx
+
+    ; The BIOS may have reloaded the segment limits
+    call EnterUnrealMode
+    cld
+    shl ecx, 7                  ; sectors -> dwords
+    mov esi, BOUNCE_ADDR
+    mov edi, [kernel_dest]
+    a32 rep movsd
+    mov [kernel_dest], edi
+    jmp .chunk
+
+.loaded:
+    ; Zero .bss (this also clears the tail of the last sector)
+    mov edi, [kernel_load_end]
+    mov ecx, [kernel_bss_end]
+    sub ecx, edi
+    shr ecx, 2                  ; The linker script keeps both 4 byte aligned
+    xor eax, eax
+    a32 rep stosd
+
+    mov eax, [kernel_load]
+    mov [BootInfo + BI_KERNEL_START], eax
+    mov eax, [kernel_bss_end]
+    mov [BootInfo + BI_KERNEL_END], eax
+    or dword [BootInfo + BI_FLAGS], BOOT_INFO_KERNEL_RANGE
+
+    call FindRSDP
+    STAMP BI_TSC_LOADED
 
 GetMemoryMap:
     xor ax, ax
     xor ebx, ebx
-    mov di, 0x5000              ; di = destination index for an entry (16 bit)
+    mov di, E820_MAP            ; di = destination index for an entry (16 bit)
     mov es, ax                  ; es = segment where the memory map will be stored 
     xor cx, cx
     mov word [memmap_count], 0
@@ -58,15 +174,17 @@ GetMemoryMap:
     jnz .e820_loop
 
 .e820_done:
-    mov dword   [0x2000], 0x5000
-    mov word    ax, [memmap_count]
-    mov word    [0x2004], ax
+    mov dword   [BootInfo + BI_MMAP_ADDR], E820_MAP
+    movzx       eax, word [memmap_count]
+    mov dword   [BootInfo + BI_MMAP_COUNT], eax
+    or dword    [BootInfo + BI_FLAGS], BOOT_INFO_MMAP
 
 SetVideoMode:
     mov ax, 0x03
     int 0x10
 
 SwitchToProtectedMode:
+    STAMP BI_TSC_HANDOFF
     cli
     lgdt [GDT32Pointer]         ; Load Global Descriptor Table
     lidt [IDT32Pointer]         ; Load Invalid IDT
@@ -77,6 +195,156 @@ SwitchToProtectedMode:
 
     jmp 0x08:PMEntry
 
+; Read cx sectors from LBA eax into the bounce buffer. CF set on error.
+; ReadPacket - 16 Bytes.
+; si = *ReadPacket
+; [si]              - to store the size of Read Packet
+; [si+1]            - Reserved (must be 0)
+; [si+2] [si+3]     - to store the number of sectors to Read
+; [si+4] [si+5]     - Offset to Load the Read content
+; [si+6] [si+7]     - Segment to Load the Read content
+; [si+8] [si+15]    - LBA to Read from the Disk
+ReadSectors:
+    pushad
+    mov si, ReadPacket
+    mov word [si], 0x10
+    mov [si+2], cx
+    mov word [si+4], 0x00
+    mov word [si+6], BOUNCE_SEG
+    mov [si+8], eax
+    mov dword [si+12], 0x00
+
+    mov dl, [BootInfo + BI_BOOT_DRIVE]
+    mov ah, 0x42
+    int 0x13
+    popad                       ; Leaves CF alone
+    ret
+
+; Look for the ACPI RSDP like the kernel would: first KiB of the EBDA, then
+; the BIOS area. Only the signature is checked; the kernel verifies the
+; checksum. Needs unreal mode.
+FindRSDP:
+    movzx esi, word [0x040E]    ; EBDA segment
+    shl esi, 4
+    cmp esi, 0x80000
+    jb .bios
+    lea edi, [esi + 1024]
+    call ScanRSDP
+    jnc .found
+.bios:
+    mov esi, 0xE0000
+    mov edi, 0x100000
+    call ScanRSDP
+    jc .done
+.found:
+    mov [BootInfo + BI_ACPI_RSDP], esi
+    or dword [BootInfo + BI_FLAGS], BOOT_INFO_ACPI_RSDP
+.done:
+    ret
+
+; Scan [esi, edi) on 16 byte boundaries for "RSD PTR ". CF clear and esi
+; at the match if found.
+ScanRSDP:
+    cmp esi, edi
+    jae .none
+    cmp dword [esi], 'RSD '
+    jne .next
+    cmp dword [esi + 4], 'PTR '
+    jne .next
+    clc
+    ret
+.next:
+    add esi, 16
+    jmp ScanRSDP
+.none:
+    stc
+    ret
+
+; Give ds and es a 4GiB limit while staying in real mode ("unreal mode").
+; A real mode segment load only changes the base, so the limit cached from
+; the protected mode descriptor stays in effect.
+EnterUnrealMode:
+    pushad
+    push ds
+    push es
+    cli
+    lgdt [GDT32Pointer]
+    mov eax, cr0
+    or al, 0x01
+    mov cr0, eax
+    mov bx, 0x10
+    mov ds, bx
+    mov es, bx
+    and al, 0xFE
+    mov cr0, eax
+    pop es
+    pop ds
+    sti
+    popad
+    ret
+
+; Enable the A20 line: BIOS first, then the "fast A20" port. CF set on failure.
+EnableA20:
+    call CheckA20
+    jnc .done
+    mov ax, 0x2401
+    int 0x15
+    call CheckA20
+    jnc .done
+    in al, 0x92
+    or al, 0x02
+    and al, 0xFE                ; Bit 0 resets the machine
+    out 0x92, al
+    call CheckA20
+.done:
+    ret
+
+; CF clear if A20 is on: with it off 0xFFFF:0x0510 wraps around to 0x0000:0x0500
+CheckA20:
+    pushad
+    push ds
+    push es
+    xor ax, ax
+    mov ds, ax
+    dec ax
+    mov es, ax
+    mov bl, [ds:0x0500]
+    mov bh, [es:0x0510]
+    mov byte [ds:0x0500], 0x00
+    mov byte [es:0x0510], 0xFF
+    cmp byte [ds:0x0500], 0xFF
+    mov [es:0x0510], bh
+    mov [ds:0x0500], bl
+    pop es
+    pop ds
+    popad
+    je .off
+    clc
+    ret
+.off:
+    stc
+    ret
+
+A20Error:
+    mov ah, 0x13
+    mov al, 1
+    mov bx, 0x0A
+    xor dx, dx
+    mov bp, MsgNoA20
+    mov cx, MsgNoA20L
+    int 0x10
+    jmp End
+
+BadKernel:
+    mov ah, 0x13
+    mov al, 1
+    mov bx, 0x0A
+    xor dx, dx
+    mov bp, MsgBadKernel
+    mov cx, MsgBadKernelL
+    int 0x10
+    jmp End
+
 NotSupported:
     mov ah, 0x13
     mov al, 1
@@ -107,11 +375,42 @@ MsgSuccess:     db "Successfully Loaded Kernel", 0x0A, 0x0D, 0
 MsgSuccessL:    equ $-MsgSuccess
 MsgNoSupport:   db "LBA extension support check failed", 0x0A, 0x0D, 0
 MsgNoSupportL:  equ $-MsgNoSupport
+MsgNoA20:       db "Cannot enable A20", 0x0A, 0x0D, 0
+MsgNoA20L:      equ $-MsgNoA20
+MsgBadKernel:   db "Bad kernel header", 0x0A, 0x0D, 0
+MsgBadKernelL:  equ $-MsgBadKernel
 
 
 ReadPacket:     times 16 db 0
 memmap_count:   dw 0
 
+kernel_load:    dd 0
+kernel_load_end: dd 0
+kernel_bss_end: dd 0
+kernel_entry:   dd 0
+kernel_dest:    dd 0            ; Next address to copy to
+kernel_lba:     dd 0            ; Next sector to read
+kernel_sectors: dd 0            ; Sectors left to read
+
+; Always 80x25 text (SetVideoMode); the rest is filled in as we go
+BootInfo:
+    dd BOOT_INFO_MAGIC
+    dw BOOT_INFO_VERSION
+    dw BI_SIZE
+    dd BOOT_INFO_VIDEO_MODE | BOOT_INFO_FRAMEBUFFER | BOOT_INFO_TSC    ; flags
+    dd 0, 0                     ; kernel_start, kernel_end
+    dd 0, 0                     ; mmap_addr, mmap_count
+    dd 0                        ; boot_drive
+    dd 0x03                     ; video_mode
+    dd 0                        ; acpi_rsdp
+    dd 0                        ; cmdline
+    dq 0xB8000                  ; fb.addr
+    dd 160                      ; fb.pitch
+    dd 80, 25                   ; fb.width, fb.height
+    db 16, 2                    ; fb.bpp, fb.type (EGA text)
+    dw 0
+    dq 0, 0, 0                  ; tsc_stage2, tsc_loaded, tsc_handoff
+
 ; Global Descriptor Table
 GDT32:
     dq 0                ; First entry (8 bytes) is always null
@@ -157,6 +456,16 @@ PMEntry:
 
     ; mov esp, 0x7c00     ; kernel entry will set up stack pointer
 
-    jmp 0x08:0x10000
+    ; kernel_main(BOOT_INFO_MAGIC, &BootInfo), see _start
+    mov ecx, [kernel_entry]
+    mov eax, BOOT_INFO_MAGIC
+    mov ebx, BootInfo
+    jmp ecx
     jmp $
 
+%ifndef ELF_BUILD
+; stage1 loads exactly 8 sectors (LBA 1-8) and the kernel starts at KERNEL_LBA
+%if ($-$$) > 8*512
+%error stage2 exceeds 8 sectors
+%endif
+%endif
@@ -0,0 +1,191 @@
+#include "arch/x86/acpi.h"
+#include "memory_map.h"
+#include "boot_info.h"
+#include "paging.h"
+#include "printk.h"
+
+struct acpi_madt_info acpi_madt;
+
+static acpi_rsdp_t *rsdp;
+static acpi_sdt_header_t *rsdt;
+
+static uint8_t acpi_checksum(const void *ptr, uint32_t len)
+{
+    const uint8_t *p = ptr;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+static int sig_equal(const char *a, const char *b, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (a[i] != b[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static acpi_rsdp_t* rsdp_scan(uint32_t start, uint32_t end)
+{
+    for (uint32_t addr = start; addr + 20 <= end; addr += 16) {
+        acpi_rsdp_t *candidate = (acpi_rsdp_t*)addr;
+        if (sig_equal(candidate->signature, ACPI_RSDP_SIG, 8) &&
+            acpi_checksum(candidate, 20) == 0) {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+// Map a table header, then the whole table once its length is known
+static acpi_sdt_header_t* acpi_map_table(uint32_t phys)
+{
+    acpi_sdt_header_t *hdr = paging_map_identity(phys, sizeof(acpi_sdt_header_t), PAGE_PRESENT);
+    paging_map_identity(phys, hdr->length, PAGE_PRESENT);
+    return hdr;
+}
+
+acpi_sdt_header_t* acpi_find_table(const char *signature)
+{
+    if (!rsdt) {
+        return NULL;
+    }
+
+    // The RSDT is the 32-bit table list; that is all an i386 kernel can
+    // reach, so the XSDT is not used even on ACPI 2.0+ firmware
+    uint32_t entries = (rsdt->length - sizeof(acpi_sdt_header_t)) / sizeof(uint32_t);
+    uint32_t *table = (uint32_t*)(rsdt + 1);
+
+    for (uint32_t i = 0; i < entries; i++) {
+        acpi_sdt_header_t *hdr = acpi_map_table(table[i]);
+        if (sig_equal(hdr->signature, signature, 4)) {
+            if (acpi_checksum(hdr, hdr->length) != 0) {
+                pr_warn("[ACPI] %.4s checksum mismatch, ignoring\n", signature);
+                return NULL;
+            }
+            return hdr;
+        }
+    }
+    return NULL;
+}
+
+static void madt_parse(acpi_madt_t *madt)
+{
+    struct acpi_madt_info *info = &acpi_madt;
+    uint8_t *p = madt->entries;
+    uint8_t *end = (uint8_t*)madt + madt->header.length;
+
+    info->lapic_address = madt->lapic_address;
+    info->flags = madt->flags;
+
+    // Identity routing unless an override says otherwise
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        info->isa[irq].gsi = irq;
+        info->isa[irq].flags = 0;
+    }
+
+    // Every entry starts with {type, length}
+    while (p + 2 <= end && p[1] >= 2) {
+        uint8_t type = p[0];
+
+        switch (type) {
+        case MADT_LAPIC:
+            // {acpi_id, apic_id, flags(32)}
+            if ((*(uint32_t*)(p + 4) & MADT_LAPIC_ENABLED) && info->cpu_count < NR_CPUS) {
+                info->cpus[info->cpu_count].acpi_id = p[2];
+                info->cpus[info->cpu_count].apic_id = p[3];
+                info->cpu_count++;
+            }
+            break;
+        case MADT_IOAPIC:
+            // {id, reserved, address(32), gsi_base(32)}
+            if (info->ioapic_count < ACPI_MAX_IOAPICS) {
+                struct acpi_ioapic *io = &info->ioapics[info->ioapic_count++];
+                io->id = p[2];
+                io->address = *(uint32_t*)(p + 4);
+                io->gsi_base = *(uint32_t*)(p + 8);
+            }
+            break;
+        case MADT_ISO:
+            // {bus, source irq, gsi(32), flags(16)}
+            if (p[3] < ACPI_ISA_IRQS) {
+                info->isa[p[3]].gsi = *(uint32_t*)(p + 4);
+                info->isa[p[3]].flags = *(uint16_t*)(p + 8);
+            }
+            break;
+        case MADT_LAPIC_ADDR: {
+            uint64_t addr = *(uint64_t*)(p + 4);
+            if (addr >> 32) {
+                pr_warn("[ACPI] LAPIC above 4GB ignored\n");
+            } else {
+                info->lapic_address = (uint32_t)addr;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        p += p[1];
+    }
+
+    info->valid = 1;
+}
+
+int acpi_init(void)
+{
+    // EBDA segment is stored in the BIOS data area
+    uint32_t ebda = (uint32_t)(*(uint16_t*)ACPI_EBDA_SEG_PTR) << 4;
+
+    // The loader may have found it already; check it like a scan hit
+    rsdp = NULL;
+    if (boot_info.flags & BOOT_INFO_ACPI_RSDP) {
+        rsdp = rsdp_scan(boot_info.acpi_rsdp, boot_info.acpi_rsdp + 20);
+    }
+    if (!rsdp && ebda >= 0x80000 && ebda < 0xA0000) {
+        rsdp = rsdp_scan(ebda, ebda + 1024);
+    }
+    if (!rsdp) {
+        rsdp = rsdp_scan(ACPI_BIOS_AREA_START, ACPI_BIOS_AREA_END);
+    }
+    if (!rsdp) {
+        pr_warn("[ACPI] RSDP not found\n");
+        return -1;
+    }
+
+    pr_info("[ACPI] RSDP at %p, revision %u, OEM %.6s\n", rsdp, rsdp->revision, rsdp->oem_id);
+
+    rsdt = acpi_map_table(rsdp->rsdt_address);
+    if (!sig_equal(rsdt->signature, "RSDT", 4) || acpi_checksum(rsdt, rsdt->length) != 0) {
+        pr_warn("[ACPI] Invalid RSDT at 0x%08x\n", rsdp->rsdt_address);
+        rsdt = NULL;
+        return -1;
+    }
+    pr_debug("[ACPI] RSDT at 0x%08x in E820 type %u\n", rsdp->rsdt_address,
+             e820_lookup_type(rsdp->rsdt_address));
+
+    acpi_madt_t *madt = (acpi_madt_t*)acpi_find_table("APIC");
+    if (!madt) {
+        pr_warn("[ACPI] No MADT\n");
+        return -1;
+    }
+
+    madt_parse(madt);
+    pr_info("[ACPI] MADT: LAPIC at 0x%08x, %d CPU(s), %d IOAPIC(s)%s\n",
+            acpi_madt.lapic_address, acpi_madt.cpu_count, acpi_madt.ioapic_count,
+            (acpi_madt.flags & MADT_FLAG_PCAT_COMPAT) ? ", 8259 present" : "");
+    for (int i = 0; i < acpi_madt.ioapic_count; i++) {
+        pr_info("[ACPI]   IOAPIC %u at 0x%08x, GSI base %u\n", acpi_madt.ioapics[i].id,
+                acpi_madt.ioapics[i].address, acpi_madt.ioapics[i].gsi_base);
+    }
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        if (acpi_madt.isa[irq].gsi != (uint32_t)irq || acpi_madt.isa[irq].flags) {
+            pr_debug("[ACPI]   ISA IRQ %d -> GSI %u flags 0x%x\n", irq,
+                     acpi_madt.isa[irq].gsi, acpi_madt.isa[irq].flags);
+        }
+    }
+    return 0;
+}
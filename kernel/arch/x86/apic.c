@@ -0,0 +1,388 @@
+#include "arch/x86/apic.h"
+#include "arch/x86/acpi.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/io.h"
+#include "arch/x86/div64.h"
+#include "paging.h"
+#include "printk.h"
+
+// Marks a controller line with no IOAPIC input
+#define APIC_NO_GSI 0xFFFFFFFF
+
+static volatile uint32_t *lapic_base;
+static int apic_usable;
+
+// Total IOAPIC inputs across all IOAPICs
+static uint32_t gsi_count;
+
+// Per IOAPIC mapping and number of redirection entries
+static volatile uint32_t *ioapic_base[ACPI_MAX_IOAPICS];
+static uint32_t ioapic_entries[ACPI_MAX_IOAPICS];
+
+uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_base[reg / 4];
+}
+
+void lapic_write(uint32_t reg, uint32_t val)
+{
+    lapic_base[reg / 4] = val;
+}
+
+uint8_t lapic_id(void)
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint32_t icr_low)
+{
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    // Writing the low dword sends the IPI
+    lapic_write(LAPIC_ICR_LOW, icr_low);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        cpu_relax();
+    }
+}
+
+static void lapic_error_handler(interrupt_frame_t *frame, void *ctx)
+{
+    (void)frame;
+    (void)ctx;
+
+    // ESR must be written before it is read to latch the current errors
+    lapic_write(LAPIC_ESR, 0);
+    pr_err_ratelimited("[APIC] LAPIC error, ESR=0x%x\n", lapic_read(LAPIC_ESR));
+}
+
+void lapic_init_cpu(void)
+{
+    uint64_t msr = rdmsr(MSR_IA32_APIC_BASE);
+    wrmsr(MSR_IA32_APIC_BASE, msr | APIC_BASE_ENABLE);
+
+    // Accept every priority class
+    lapic_write(LAPIC_TPR, 0);
+
+    // Local interrupts: nothing through LINT0 (the 8259 is not used),
+    // LINT1 is the NMI pin on PC hardware
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_ERROR_VECTOR);
+
+    // Clear errors left over from before (back to back writes)
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+
+    // Software enable with the spurious vector, then drop anything pending
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_eoi();
+}
+
+/*
+LAPIC timer
+*/
+static uint32_t lapic_timer_khz;
+
+int lapic_timer_calibrate(void)
+{
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    udelay(TSC_CALIBRATE_MS * 1000);
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    lapic_timer_khz = elapsed / TSC_CALIBRATE_MS;
+    if (lapic_timer_khz == 0) {
+        pr_warn("[APIC] LAPIC timer does not count\n");
+        return -1;
+    }
+
+    // Longest countdown: 2^32 - 1 counts
+    uint64_t max_ns = 0xFFFFFFFFULL * 1000;
+    do_div_u64(&max_ns, lapic_timer_khz);
+    max_ns *= 1000;
+    lapic_clockevent.max_delta_ns = max_ns;
+
+    pr_info("[APIC] LAPIC timer %u kHz (bus clock / 16)\n", lapic_timer_khz);
+    return 0;
+}
+
+static void lapic_timer_set_periodic(uint32_t hz)
+{
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, lapic_timer_khz * 1000 / hz);
+}
+
+static void lapic_timer_set_next_event(uint64_t delta_ns)
+{
+    uint64_t count = delta_ns * lapic_timer_khz;
+    do_div_u64(&count, 1000000);
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > 0xFFFFFFFF) {
+        count = 0xFFFFFFFF;
+    }
+
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, (uint32_t)count);
+}
+
+static void lapic_timer_shutdown(void)
+{
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+static void lapic_timer_handler(interrupt_frame_t *frame, void *ctx)
+{
+    struct clock_event_device *dev = ctx;
+    if (dev->event_handler) {
+        dev->event_handler(dev, frame);
+    }
+}
+
+static int lapic_timer_enable(void)
+{
+    return irq_register_handler(LAPIC_TIMER_VECTOR, lapic_timer_handler, &lapic_clockevent);
+}
+
+// Divider and LVT are banked per CPU; calibration only set the BSP's
+static void lapic_timer_enable_cpu(void)
+{
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_timer_shutdown();
+}
+
+struct clock_event_device lapic_clockevent = {
+    .name = "lapic",
+    .features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT | CLOCK_EVT_FEAT_PERCPU,
+    .rating = 200,
+    .min_delta_ns = 1000,
+    .max_delta_ns = 0,      // Set by lapic_timer_calibrate()
+    .enable = lapic_timer_enable,
+    .enable_cpu = lapic_timer_enable_cpu,
+    .set_periodic = lapic_timer_set_periodic,
+    .set_next_event = lapic_timer_set_next_event,
+    .shutdown = lapic_timer_shutdown,
+};
+
+static uint32_t ioapic_read(int idx, uint8_t reg)
+{
+    ioapic_base[idx][IOAPIC_REGSEL / 4] = reg;
+    return ioapic_base[idx][IOAPIC_WIN / 4];
+}
+
+static void ioapic_write(int idx, uint8_t reg, uint32_t val)
+{
+    ioapic_base[idx][IOAPIC_REGSEL / 4] = reg;
+    ioapic_base[idx][IOAPIC_WIN / 4] = val;
+}
+
+// Find the IOAPIC serving a GSI, returns its index and the input number
+static int ioapic_for_gsi(uint32_t gsi, uint32_t *pin)
+{
+    if (gsi == APIC_NO_GSI) {
+        return -1;
+    }
+    for (int i = 0; i < acpi_madt.ioapic_count; i++) {
+        uint32_t base = acpi_madt.ioapics[i].gsi_base;
+        if (gsi >= base && gsi < base + ioapic_entries[i]) {
+            *pin = gsi - base;
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t ioapic_read_redirection(uint32_t gsi)
+{
+    uint32_t pin;
+    int idx = ioapic_for_gsi(gsi, &pin);
+    if (idx < 0) {
+        return 0;
+    }
+    uint32_t lo = ioapic_read(idx, IOAPIC_REG_REDTBL(pin));
+    uint32_t hi = ioapic_read(idx, IOAPIC_REG_REDTBL(pin) + 1);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Controller line -> GSI and redirection flags.
+ * Lines 0-15 are ISA IRQs and follow the MADT source overrides (QEMU wires
+ * the PIT, IRQ0, to GSI 2); ISA defaults to edge/active high. Lines above
+ * 15 are PCI-style GSIs: level triggered, active low.
+ * A line whose GSI was taken over by another ISA IRQ has no input
+ * (APIC_NO_GSI), otherwise it would steal that IRQ's redirection entry.
+ */
+static uint32_t apic_line_to_gsi(uint8_t line, uint32_t *flags)
+{
+    if (line >= ACPI_ISA_IRQS) {
+        *flags = IOAPIC_LEVEL | IOAPIC_ACTIVE_LOW;
+        return line;
+    }
+
+    uint32_t gsi = acpi_madt.isa[line].gsi;
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        if (irq != line && gsi == line && acpi_madt.isa[irq].gsi == gsi) {
+            return APIC_NO_GSI;
+        }
+    }
+
+    uint16_t mps = acpi_madt.isa[line].flags;
+    *flags = 0;
+    if ((mps & MPS_POLARITY_MASK) == MPS_POLARITY_LOW) {
+        *flags |= IOAPIC_ACTIVE_LOW;
+    }
+    if ((mps & MPS_TRIGGER_MASK) == MPS_TRIGGER_LEVEL) {
+        *flags |= IOAPIC_LEVEL;
+    }
+    return gsi;
+}
+
+static void apic_set_masked(uint8_t line, int masked)
+{
+    uint32_t flags, pin;
+    uint32_t gsi = apic_line_to_gsi(line, &flags);
+    int idx = ioapic_for_gsi(gsi, &pin);
+    if (idx < 0) {
+        return;
+    }
+
+    uint32_t irqflags = irq_save();
+    uint32_t lo = ioapic_read(idx, IOAPIC_REG_REDTBL(pin));
+    lo = masked ? (lo | IOAPIC_MASKED) : (lo & ~IOAPIC_MASKED);
+    ioapic_write(idx, IOAPIC_REG_REDTBL(pin), lo);
+    irq_restore(irqflags);
+}
+
+static void apic_mask(uint8_t line)
+{
+    apic_set_masked(line, 1);
+}
+
+static void apic_unmask(uint8_t line)
+{
+    apic_set_masked(line, 0);
+}
+
+static void apic_disable(void)
+{
+    for (int i = 0; i < acpi_madt.ioapic_count; i++) {
+        for (uint32_t pin = 0; pin < ioapic_entries[i]; pin++) {
+            ioapic_write(i, IOAPIC_REG_REDTBL(pin), IOAPIC_MASKED);
+        }
+    }
+}
+
+static void apic_chip_init(void)
+{
+    // Boards that start in PIC mode route INTR through the IMCR; switch it
+    // so the 8259 no longer drives the CPU directly
+    if (acpi_madt.flags & MADT_FLAG_PCAT_COMPAT) {
+        outb(IMCR_SELECT, 0x70);
+        outb(IMCR_DATA, 0x01);
+    }
+
+    lapic_init_cpu();
+    irq_register_handler(LAPIC_ERROR_VECTOR, lapic_error_handler, NULL);
+
+    // Every line starts masked and routed to the BSP
+    apic_disable();
+    uint8_t bsp = lapic_id();
+    for (uint8_t line = 0; line < apic_chip.nr_lines; line++) {
+        uint32_t flags, pin;
+        uint32_t gsi = apic_line_to_gsi(line, &flags);
+        int idx = ioapic_for_gsi(gsi, &pin);
+        if (idx < 0) {
+            continue;
+        }
+        ioapic_write(idx, IOAPIC_REG_REDTBL(pin) + 1, (uint32_t)bsp << 24);
+        ioapic_write(idx, IOAPIC_REG_REDTBL(pin), IOAPIC_MASKED | flags | IRQ_VECTOR(line));
+    }
+}
+
+static int apic_is_spurious(uint8_t vector)
+{
+    // The LAPIC does not set an in-service bit for it, so no EOI either
+    return vector == LAPIC_SPURIOUS_VECTOR;
+}
+
+static void apic_eoi(uint8_t vector)
+{
+    // Device lines and LAPIC local vectors are in service at the LAPIC;
+    // software `int n` vectors are not
+    if (vector < IRQ_VECTOR(apic_chip.nr_lines) || vector >= LAPIC_LOCAL_VECTOR_BASE) {
+        lapic_eoi();
+    }
+}
+
+struct irq_chip apic_chip = {
+    .name = "IOAPIC",
+    .nr_lines = ACPI_ISA_IRQS,
+    .init = apic_chip_init,
+    .disable = apic_disable,
+    .mask = apic_mask,
+    .unmask = apic_unmask,
+    .is_spurious = apic_is_spurious,
+    .eoi = apic_eoi,
+};
+
+int apic_available(void)
+{
+    return apic_usable;
+}
+
+int apic_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEAT_EDX_APIC) || !(edx & CPUID_FEAT_EDX_MSR)) {
+        pr_info("[APIC] CPU has no APIC\n");
+        return -1;
+    }
+    if (!acpi_madt.valid || acpi_madt.ioapic_count == 0) {
+        pr_info("[APIC] No IOAPIC described by ACPI\n");
+        return -1;
+    }
+
+    uint32_t base = (uint32_t)rdmsr(MSR_IA32_APIC_BASE) & APIC_BASE_ADDR_MASK;
+    if (base != acpi_madt.lapic_address) {
+        pr_warn("[APIC] MSR base 0x%08x differs from MADT 0x%08x, using MSR\n",
+                base, acpi_madt.lapic_address);
+    }
+    lapic_base = paging_map_identity(base, PAGE_SIZE, PAGE_MMIO);
+
+    gsi_count = 0;
+    for (int i = 0; i < acpi_madt.ioapic_count; i++) {
+        ioapic_base[i] = paging_map_identity(acpi_madt.ioapics[i].address, PAGE_SIZE, PAGE_MMIO);
+        // VER bits 16-23: index of the last redirection entry
+        ioapic_entries[i] = ((ioapic_read(i, IOAPIC_REG_VER) >> 16) & 0xFF) + 1;
+        uint32_t end = acpi_madt.ioapics[i].gsi_base + ioapic_entries[i];
+        if (end > gsi_count) {
+            gsi_count = end;
+        }
+    }
+
+    // Device lines must stay below the LAPIC local vectors
+    uint32_t lines = gsi_count;
+    if (lines > LAPIC_LOCAL_VECTOR_BASE - IRQ_VECTOR_BASE) {
+        lines = LAPIC_LOCAL_VECTOR_BASE - IRQ_VECTOR_BASE;
+    }
+    if (lines > apic_chip.nr_lines) {
+        apic_chip.nr_lines = lines;
+    }
+
+    pr_info("[APIC] LAPIC id %u version 0x%x at 0x%08x, %u IOAPIC inputs\n",
+            lapic_id(), lapic_read(LAPIC_VERSION) & 0xFF, base, gsi_count);
+
+    apic_usable = 1;
+    return 0;
+}
@@ -3,20 +3,17 @@ BITS 32
 SECTION .text
 
 global double_fault_handler
+extern pstore_save_double_fault
 
+; Entered through the #DF task gate on double_fault_stack.
+; The CPU saved the faulting kernel task into tss_main during the switch.
 double_fault_handler:
     ; Disable interrupts immediately
     cli
-    
-    ; Write multiple magic values to different memory locations for debugging
-    mov eax, 0xDEADBEEF
-    mov [0x15000], eax     ; Magic value 1
-    
-    mov eax, 0xCAFEBABE  
-    mov [0x15004], eax     ; Magic value 2
-    
-    mov eax, 0x12345678
-    mov [0x15008], eax     ; Magic value 3
+
+    ; Save registers, backtrace and log tail into the persistent crash
+    ; record so the next boot can report what happened
+    call pstore_save_double_fault
     
     ; Try to write to VGA memory as well (since we know it's mapped)
     mov word [0xB8000], 0x4F44  ; 'D' with white on red
@@ -25,4 +22,4 @@ double_fault_handler:
     ; Safe infinite loop
 .safe_halt:
     hlt
-    jmp .safe_halt
\ No newline at end of file
+    jmp .safe_halt
@@ -1,37 +1,44 @@
 #include "arch/x86/gdt.h"
 #include "arch/x86/tss.h" // for your tss_entry and extern tss_df
+#include "smp.h"
 #include <stdint.h>
 
-#define GDT_ENTRIES 4
-struct gdt_entry gdt[GDT_ENTRIES];
-struct gdt_ptr   gdtp;
+struct gdt_entry gdt[NR_CPUS][GDT_ENTRIES];
+static struct gdt_ptr gdtp[NR_CPUS];
 
 extern void gdt_flush(uint32_t);
 
-static void set_gdt_entry(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
-    gdt[num].limit_low    = (limit & 0xFFFF);
-    gdt[num].base_low     = (base & 0xFFFF);
-    gdt[num].base_middle  = (base >> 16) & 0xFF;
-    gdt[num].access       = access;
-    gdt[num].granularity  = ((limit >> 16) & 0x0F) | (gran & 0xF0);
-    gdt[num].base_high    = (base >> 24) & 0xFF;
+static void set_gdt_entry(struct gdt_entry *table, int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
+    table[num].limit_low    = (limit & 0xFFFF);
+    table[num].base_low     = (base & 0xFFFF);
+    table[num].base_middle  = (base >> 16) & 0xFF;
+    table[num].access       = access;
+    table[num].granularity  = ((limit >> 16) & 0x0F) | (gran & 0xF0);
+    table[num].base_high    = (base >> 24) & 0xFF;
 }
 
-void gdt_init(void) {
-    set_gdt_entry(0, 0, 0, 0, 0);                    // Null
-    set_gdt_entry(1, 0, 0xFFFFF, 0x9A, 0xCF);        // Code seg (0x08)
-    set_gdt_entry(2, 0, 0xFFFFF, 0x92, 0xCF);        // Data seg (0x10)
-    set_gdt_entry(3, (uint32_t)&tss_df, sizeof(struct tss_entry)-1, 0x89, 0x40); // TSS (0x18)
-
-    gdtp.limit = sizeof(gdt) - 1;
-    gdtp.base  = (uint32_t)&gdt;
-    gdt_flush((uint32_t)&gdtp);
-
-    // Load TSS selector (0x18, 3rd entry)
-    __asm__ volatile("ltr %%ax" : : "a"(0x18));
-    
-    // VERIFY TSS IS LOADED
-    uint16_t current_tr;
-    __asm__ volatile("str %0" : "=r"(current_tr));
-    printk("Current Task Register: 0x%04x (should be 0x18)\n", current_tr);
+void gdt_init_cpu(int cpu) {
+    struct gdt_entry *table = gdt[cpu];
+
+    set_gdt_entry(table, 0, 0, 0, 0, 0);                    // Null
+    set_gdt_entry(table, 1, 0, 0xFFFFF, 0x9A, 0xCF);        // Code seg (0x08)
+    set_gdt_entry(table, 2, 0, 0xFFFFF, 0x92, 0xCF);        // Data seg (0x10)
+    set_gdt_entry(table, 3, (uint32_t)&tss_df[cpu], sizeof(struct tss_entry)-1, 0x89, 0x40); // TSS (0x18)
+    set_gdt_entry(table, 4, (uint32_t)&tss_main[cpu], sizeof(struct tss_entry)-1, 0x89, 0x40); // TSS (0x20)
+    set_gdt_entry(table, 5, (uint32_t)&cpu_data[cpu], sizeof(struct cpu_data)-1, 0x92, 0x40); // Per-CPU data (0x28)
+
+    gdtp[cpu].limit = sizeof(gdt[cpu]) - 1;
+    gdtp[cpu].base  = (uint32_t)table;
+    gdt_flush((uint32_t)&gdtp[cpu]);
+
+    // Load the kernel task TSS (0x20, 4th entry).
+    // The double fault TSS must NOT be the current task: the #DF task gate
+    // switches to it, and switching to a busy TSS raises #GP -> triple fault.
+    // On the switch the CPU saves the faulting state into tss_main.
+    // Both selectors are the same on every CPU; each GDT points them at
+    // that CPU's own TSS, so the shared IDT task gate works everywhere.
+    __asm__ volatile("ltr %%ax" : : "a"(GDT_TSS_MAIN_SEL));
+
+    // smp_processor_id() and friends read through %fs from here on
+    __asm__ volatile("mov %%ax, %%fs" : : "a"(GDT_PERCPU_SEL));
 }
@@ -0,0 +1,86 @@
+#include "arch/x86/hpet.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/div64.h"
+#include "paging.h"
+#include "printk.h"
+
+static volatile uint32_t *hpet_base;
+static uint32_t hpet_period;
+
+static uint32_t hpet_read(uint32_t reg)
+{
+    return hpet_base[reg / 4];
+}
+
+static void hpet_write(uint32_t reg, uint32_t val)
+{
+    hpet_base[reg / 4] = val;
+}
+
+int hpet_available(void)
+{
+    return hpet_base != NULL;
+}
+
+uint32_t hpet_period_fs(void)
+{
+    return hpet_period;
+}
+
+// Low 32 bits are enough for deltas; wraps after ~7 minutes at 10 MHz
+uint32_t hpet_read_counter(void)
+{
+    return hpet_read(HPET_REG_COUNTER);
+}
+
+int hpet_init(void)
+{
+    acpi_hpet_t *table = (acpi_hpet_t*)acpi_find_table("HPET");
+    if (!table) {
+        return -1;
+    }
+    if (table->address_space != 0 || (table->address >> 32)) {
+        pr_warn("[HPET] Unsupported register block\n");
+        return -1;
+    }
+
+    volatile uint32_t *base = paging_map_identity((uint32_t)table->address, PAGE_SIZE, PAGE_MMIO);
+    uint32_t period = base[HPET_REG_CAPS / 4 + 1];
+    if (period == 0 || period > HPET_MAX_PERIOD_FS) {
+        pr_warn("[HPET] Bogus period %u fs\n", period);
+        return -1;
+    }
+
+    hpet_base = base;
+    hpet_period = period;
+    hpet_write(HPET_REG_CONFIG, hpet_read(HPET_REG_CONFIG) | HPET_CONFIG_ENABLE);
+
+    uint64_t khz = 1000000000000ULL;
+    do_div_u64(&khz, period);
+    pr_info("[HPET] at 0x%08x, period %u fs (%u kHz)\n", (uint32_t)table->address, period, (uint32_t)khz);
+    return 0;
+}
+
+uint32_t hpet_calibrate_tsc(uint32_t ms)
+{
+    // HPET ticks in `ms`: ms * 1e12 fs / period
+    uint64_t ticks = (uint64_t)ms * 1000000000000ULL;
+    do_div_u64(&ticks, hpet_period);
+
+    uint32_t h0 = hpet_read_counter();
+    uint64_t t0 = rdtsc();
+    uint32_t elapsed;
+    do {
+        cpu_relax();
+        elapsed = hpet_read_counter() - h0;
+    } while (elapsed < ticks);
+    uint64_t cycles = rdtsc() - t0;
+
+    // Measured time in microseconds, from the ticks that actually passed
+    uint64_t us = (uint64_t)elapsed * hpet_period;
+    do_div_u64(&us, 1000000000);
+
+    uint64_t khz = cycles * 1000;
+    do_div_u64(&khz, (uint32_t)us);
+    return (uint32_t)khz;
+}
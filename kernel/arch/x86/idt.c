@@ -1,7 +1,10 @@
 #include "idt.h"
-#include <string.h>
 #include <stdint.h>
+#include "printk.h"
+#include "page_fault.h"
 #include "arch/x86/tss.h"
+#include "arch/x86/gdt.h"
+#include "arch/x86/interrupt.h"
 
 extern void idt_flush(uint32_t);
 
@@ -53,13 +56,26 @@ void idt_init ()
         idt[i].flags     = 0;
     }
 
+    // Every vector enters through its stub in isr_stubs.asm and reaches
+    // interrupt_dispatch() with a common interrupt_frame_t
+    // P=1(Present), DPL=0(Kernel only access), Type=0xE(Interrupt Gate)
+    extern uint32_t isr_stub_table[IDT_ENTRIES];
+    for (int i = 0; i < IDT_ENTRIES; i++) {
+        idt_set_gate(i, isr_stub_table[i], GDT_KERNEL_CODE_SEL, 0x8E);
+    }
+
     // Set up double fault as task gate (TSS selector is 0x18 - 3rd entry in GDT)
-    set_task_gate(8, 0x18);
+    // so it runs on a known good stack even when the kernel stack is gone
+    set_task_gate(VECTOR_DOUBLE_FAULT, GDT_TSS_DF_SEL);
 
-    extern void isr_page_fault();
-    // add entry for page fault handler in idt
-    // P=1(Present), DPL=0(Kernel only access), Type=0xE(Interrupt Gate)
-    idt_set_gate(14, (uint32_t)isr_page_fault, 0x08, 0x8E); 
+    interrupt_init();
+    irq_register_handler(VECTOR_PAGE_FAULT, page_fault_handler, NULL);
 
     idt_flush((uint32_t)&idt_ptr);
 }
+
+// Load the (shared) IDT on an application processor
+void idt_load(void)
+{
+    idt_flush((uint32_t)&idt_ptr);
+}
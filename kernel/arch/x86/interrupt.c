@@ -0,0 +1,105 @@
+#include "arch/x86/interrupt.h"
+#include "arch/x86/irq.h"
+#include "idt.h"
+#include "printk.h"
+#include "panik.h"
+#include "backtrace.h"
+#include "ksyms.h"
+#include "console.h"
+#include "smp.h"
+
+// O(1) dispatch: indexed directly by vector number
+static struct irq_desc irq_table[IDT_ENTRIES];
+
+// Per CPU: the frame interrupt_dispatch() is handling (see profile.c)
+static interrupt_frame_t *irq_frames[NR_CPUS];
+
+static const char* exception_names[EXCEPTION_VECTORS] = {
+    "Divide Error", "Debug", "NMI", "Breakpoint",
+    "Overflow", "BOUND Range Exceeded", "Invalid Opcode", "Device Not Available",
+    "Double Fault", "Coprocessor Segment Overrun", "Invalid TSS", "Segment Not Present",
+    "Stack-Segment Fault", "General Protection", "Page Fault", "Reserved",
+    "x87 FPU Error", "Alignment Check", "Machine Check", "SIMD Exception",
+    "Virtualization Exception", "Control Protection", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Reserved", "Reserved",
+    "Hypervisor Injection", "VMM Communication", "Security Exception", "Reserved",
+};
+
+void interrupt_init(void)
+{
+    for (int i = 0; i < IDT_ENTRIES; i++) {
+        irq_table[i].handler = NULL;
+        irq_table[i].ctx = NULL;
+        irq_table[i].count = 0;
+    }
+}
+
+int irq_register_handler(uint8_t vector, irq_handler_t fn, void *ctx)
+{
+    if (irq_table[vector].handler) {
+        pr_err("[IRQ] Vector %u already has a handler\n", vector);
+        return -1;
+    }
+    irq_table[vector].ctx = ctx;
+    irq_table[vector].handler = fn;
+    return 0;
+}
+
+void irq_unregister_handler(uint8_t vector)
+{
+    irq_table[vector].handler = NULL;
+    irq_table[vector].ctx = NULL;
+}
+
+uint32_t irq_get_count(uint8_t vector)
+{
+    return irq_table[vector].count;
+}
+
+static void unhandled_interrupt(interrupt_frame_t *frame)
+{
+    if (frame->vector < EXCEPTION_VECTORS) {
+        char where[64];
+        ksym_snprint(where, sizeof(where), frame->eip);
+
+        // panik()'s own trace starts in the handler; this one starts at the fault
+        backtrace_print_context(CONSOLE_ALL, frame->eip, frame->ebp);
+        panik("Unhandled exception %u (%s): err=0x%x eip=0x%08x (%s) cs=0x%x eflags=0x%08x",
+              frame->vector, exception_names[frame->vector], frame->error_code,
+              frame->eip, where, frame->cs, frame->eflags);
+        return;
+    }
+
+    pr_warn_ratelimited("[IRQ] Unhandled interrupt vector %u\n", frame->vector);
+}
+
+void interrupt_dispatch(interrupt_frame_t *frame)
+{
+    uint8_t vector = frame->vector & 0xFF;
+    struct irq_desc *desc = &irq_table[vector];
+
+    // Spurious controller interrupts are dropped without an EOI
+    if (!irq_chip_begin(vector)) {
+        return;
+    }
+
+    desc->count++;
+
+    int cpu = smp_processor_id();
+    interrupt_frame_t *outer = irq_frames[cpu];
+    irq_frames[cpu] = frame;
+
+    if (desc->handler) {
+        desc->handler(frame, desc->ctx);
+    } else {
+        unhandled_interrupt(frame);
+    }
+
+    irq_frames[cpu] = outer;
+    irq_chip_end(vector);
+}
+
+interrupt_frame_t* interrupt_current_frame(void)
+{
+    return irq_frames[smp_processor_id()];
+}
@@ -0,0 +1,84 @@
+#include "arch/x86/irq.h"
+#include "printk.h"
+
+static struct irq_chip *irq_chip;
+static uint32_t spurious_count;
+
+void irq_chip_install(struct irq_chip *chip)
+{
+    uint32_t flags = irq_save();
+
+    if (irq_chip && irq_chip->disable) {
+        irq_chip->disable();
+    }
+    irq_chip = chip;
+    if (chip->init) {
+        chip->init();
+    }
+
+    irq_restore(flags);
+    pr_info("[IRQ] Using %s, %u lines at vectors %u-%u\n", chip->name, chip->nr_lines,
+            IRQ_VECTOR_BASE, IRQ_VECTOR_BASE + chip->nr_lines - 1);
+}
+
+struct irq_chip *irq_chip_get(void)
+{
+    return irq_chip;
+}
+
+void irq_mask(uint8_t line)
+{
+    if (irq_chip && line < irq_chip->nr_lines) {
+        irq_chip->mask(line);
+    }
+}
+
+void irq_unmask(uint8_t line)
+{
+    if (irq_chip && line < irq_chip->nr_lines) {
+        irq_chip->unmask(line);
+    }
+}
+
+int irq_request(uint8_t line, irq_handler_t fn, void *ctx)
+{
+    if (!irq_chip || line >= irq_chip->nr_lines) {
+        pr_err("[IRQ] No controller line %u\n", line);
+        return -1;
+    }
+    if (irq_register_handler(IRQ_VECTOR(line), fn, ctx) < 0) {
+        return -1;
+    }
+    irq_unmask(line);
+    return 0;
+}
+
+void irq_free(uint8_t line)
+{
+    irq_mask(line);
+    irq_unregister_handler(IRQ_VECTOR(line));
+}
+
+uint32_t irq_get_spurious_count(void)
+{
+    return spurious_count;
+}
+
+int irq_chip_begin(uint8_t vector)
+{
+    if (vector < IRQ_VECTOR_BASE || !irq_chip) {
+        return 1;
+    }
+    if (irq_chip->is_spurious && irq_chip->is_spurious(vector)) {
+        spurious_count++;
+        return 0;
+    }
+    return 1;
+}
+
+void irq_chip_end(uint8_t vector)
+{
+    if (vector >= IRQ_VECTOR_BASE && irq_chip) {
+        irq_chip->eoi(vector);
+    }
+}
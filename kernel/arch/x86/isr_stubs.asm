@@ -0,0 +1,82 @@
+BITS 32
+SECTION .text
+
+global isr_stub_table
+extern interrupt_dispatch
+extern preempt_schedule_irq
+
+PERCPU_NEED_RESCHED equ 12      ; offsetof(struct cpu_data, need_resched), see smp.h
+
+; Entry stubs for all 256 IDT vectors.
+; The CPU pushes an error code only for some exceptions; the other stubs push
+; a dummy 0 so every vector reaches isr_common with the same frame layout:
+;
+;   [ gs, fs, es, ds ]              16 bytes                    <---- esp
+;   [ edi ... eax ]                 32 bytes from pusha
+;   [ vector ]                      pushed by the stub
+;   [ error code ]                  pushed by the CPU or the stub
+;   [ eip, cs, eflags ]             pushed by the CPU
+;   [ user esp, ss ]                only on a privilege change
+;
+; This is interrupt_frame_t in arch/x86/interrupt.h
+
+; Exceptions that push an error code: 8, 10-14, 17, 21, 29, 30
+%assign vec 0
+%rep 256
+isr_stub_%+vec:
+%if vec = 8 || (vec >= 10 && vec <= 14) || vec = 17 || vec = 21 || vec = 29 || vec = 30
+    ; error code already pushed by the CPU
+%else
+    push dword 0            ; dummy error code
+%endif
+    push dword vec          ; vector number
+    jmp isr_common
+%assign vec vec + 1
+%endrep
+
+isr_common:
+    pusha                   ; Save all general-purpose registers
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10            ; Kernel data segment
+    mov ds, ax
+    mov es, ax
+    mov gs, ax
+    mov ax, 0x28            ; This CPU's per-CPU area (GDT_PERCPU_SEL)
+    mov fs, ax
+
+    push esp                ; interrupt_frame_t* argument
+    call interrupt_dispatch
+
+    ; Preemption point: one compare of this CPU's need_resched on the way
+    ; out. The frame argument is still on the stack for preempt_schedule_irq.
+    cmp dword [fs:PERCPU_NEED_RESCHED], 0
+    jne .resched
+.resched_done:
+    add esp, 4
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa                    ; Restore all general-purpose registers
+
+    add esp, 8              ; Drop vector and error code
+    iret
+
+.resched:
+    call preempt_schedule_irq
+    jmp .resched_done
+
+SECTION .rodata
+
+; Table of stub addresses, indexed by vector (used by idt_init)
+isr_stub_table:
+%assign vec 0
+%rep 256
+    dd isr_stub_%+vec
+%assign vec vec + 1
+%endrep
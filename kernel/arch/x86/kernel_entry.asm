@@ -2,9 +2,44 @@ BITS 32
 
 global _start       ; export this label for bootloader to know the kernel entry point
 extern kernel_main
+extern kernel_start, __load_end, kernel_end
 
+; First bytes of the image (kernel.ld puts this section first). stage2 reads
+; the header to learn how much to load, where, and where to jump; the jmp
+; keeps the load address itself a valid entry point.
+section .boot_header progbits alloc exec nowrite align=8
+    jmp _start
+align 8
+kernel_header:                  ; stage2.asm KERNEL_HDR_OFFSET
+    dd 'KVHD'                   ; magic
+    dd kernel_start             ; physical load address
+    dd __load_end               ; end of the file image
+    dd kernel_end               ; end of .bss
+    dd _start                   ; entry point
+
+; Multiboot (v1) header, so `qemu -kernel build/kernel.elf` and GRUB can
+; load the ELF directly. Must sit in the first 8KiB of the file.
+MULTIBOOT_MAGIC     equ 0x1BADB002
+MULTIBOOT_MEMINFO   equ 1 << 1      ; Ask for mem_* and the memory map
+align 4
+multiboot_header:
+    dd MULTIBOOT_MAGIC
+    dd MULTIBOOT_MEMINFO
+    dd -(MULTIBOOT_MAGIC + MULTIBOOT_MEMINFO)
+
+section .bss
+alignb 16
+boot_stack:
+    resb 16384                  ; Until kernel_main switches to the high stack
+boot_stack_top:
+
+section .text
+
+; eax = boot magic, ebx = boot information (boot_info.h)
 _start:
-    mov esp, 0x9FB00
+    mov esp, boot_stack_top
+    push ebx
+    push eax
     call kernel_main
 
 global switch_to_high_stack
@@ -0,0 +1,128 @@
+#include "arch/x86/pic.h"
+#include "arch/x86/io.h"
+
+// Cached mask so mask/unmask do not need to read the IMR back
+static uint16_t pic_mask_cache = 0xFFFF;
+
+static void pic_write_mask(void)
+{
+    outb(PIC1_DATA, pic_mask_cache & 0xFF);
+    outb(PIC2_DATA, pic_mask_cache >> 8);
+}
+
+/**
+ * Remap both PICs to IRQ_VECTOR_BASE and mask every line except the
+ * cascade. Lines are unmasked by drivers through irq_request().
+ */
+static void pic_init(void)
+{
+    // ICW1: start init, expect ICW4 (edge triggered, cascade mode)
+    outb(PIC1_CMD, ICW1_INIT | ICW1_ICW4);
+    io_wait();
+    outb(PIC2_CMD, ICW1_INIT | ICW1_ICW4);
+    io_wait();
+
+    // ICW2: vector offsets
+    outb(PIC1_DATA, IRQ_VECTOR_BASE);
+    io_wait();
+    outb(PIC2_DATA, IRQ_VECTOR_BASE + 8);
+    io_wait();
+
+    // ICW3: slave on master IRQ2, slave cascade identity 2
+    outb(PIC1_DATA, 1 << IRQ_CASCADE);
+    io_wait();
+    outb(PIC2_DATA, IRQ_CASCADE);
+    io_wait();
+
+    // ICW4: 8086 mode, normal (non-automatic) EOI
+    outb(PIC1_DATA, ICW4_8086);
+    io_wait();
+    outb(PIC2_DATA, ICW4_8086);
+    io_wait();
+
+    pic_mask_cache = 0xFFFF & ~(1 << IRQ_CASCADE);
+    pic_write_mask();
+}
+
+static void pic_disable(void)
+{
+    pic_mask_cache = 0xFFFF;
+    pic_write_mask();
+}
+
+static void pic_mask(uint8_t line)
+{
+    uint32_t flags = irq_save();
+    pic_mask_cache |= (1 << line);
+    pic_write_mask();
+    irq_restore(flags);
+}
+
+static void pic_unmask(uint8_t line)
+{
+    uint32_t flags = irq_save();
+    pic_mask_cache &= ~(1 << line);
+    pic_write_mask();
+    irq_restore(flags);
+}
+
+uint16_t pic_get_mask(void)
+{
+    return (inb(PIC2_DATA) << 8) | inb(PIC1_DATA);
+}
+
+uint16_t pic_get_isr(void)
+{
+    outb(PIC1_CMD, OCW3_READ_ISR);
+    outb(PIC2_CMD, OCW3_READ_ISR);
+    return (inb(PIC2_CMD) << 8) | inb(PIC1_CMD);
+}
+
+/**
+ * IRQ7 and IRQ15 are what a PIC reports when a line drops before the CPU
+ * acknowledges it. A real one has its bit set in the in-service register.
+ * A spurious IRQ7 gets no EOI at all; a spurious IRQ15 still came through
+ * the master's cascade line, so the master needs its EOI.
+ */
+static int pic_is_spurious(uint8_t vector)
+{
+    if (vector == IRQ_VECTOR(7)) {
+        outb(PIC1_CMD, OCW3_READ_ISR);
+        return !(inb(PIC1_CMD) & (1 << 7));
+    }
+    if (vector == IRQ_VECTOR(15)) {
+        outb(PIC2_CMD, OCW3_READ_ISR);
+        if (!(inb(PIC2_CMD) & (1 << 7))) {
+            outb(PIC1_CMD, OCW2_SPECIFIC_EOI | IRQ_CASCADE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Specific EOI: clear exactly this line's in-service bit
+static void pic_eoi(uint8_t vector)
+{
+    if (vector < IRQ_VECTOR_BASE || vector >= IRQ_VECTOR(PIC_LINES)) {
+        return;
+    }
+
+    uint8_t line = vector - IRQ_VECTOR_BASE;
+    if (line >= 8) {
+        outb(PIC2_CMD, OCW2_SPECIFIC_EOI | (line - 8));
+        outb(PIC1_CMD, OCW2_SPECIFIC_EOI | IRQ_CASCADE);
+    } else {
+        outb(PIC1_CMD, OCW2_SPECIFIC_EOI | line);
+    }
+}
+
+struct irq_chip pic_8259_chip = {
+    .name = "8259 PIC",
+    .nr_lines = PIC_LINES,
+    .init = pic_init,
+    .disable = pic_disable,
+    .mask = pic_mask,
+    .unmask = pic_unmask,
+    .is_spurious = pic_is_spurious,
+    .eoi = pic_eoi,
+};
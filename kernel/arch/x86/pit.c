@@ -0,0 +1,98 @@
+#include "arch/x86/pit.h"
+#include "arch/x86/io.h"
+#include "arch/x86/irq.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/div64.h"
+
+static void pit_load_channel0(uint8_t mode, uint16_t count)
+{
+    outb(PIT_COMMAND, PIT_SEL_CHANNEL0 | PIT_ACCESS_LOHI | mode);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, count >> 8);
+}
+
+/**
+ * Count TSC cycles while channel 2 counts down `ms` milliseconds.
+ * The gate is opened with the speaker off; OUT2 goes high at terminal count.
+ */
+uint32_t pit_calibrate_tsc(uint32_t ms)
+{
+    uint32_t latch = PIT_HZ * ms / 1000;
+
+    uint8_t gate = inb(PIT_GATE_PORT);
+    outb(PIT_GATE_PORT, (gate & ~0x02) | 0x01);
+
+    outb(PIT_COMMAND, PIT_SEL_CHANNEL2 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    outb(PIT_CHANNEL2, latch & 0xFF);
+    outb(PIT_CHANNEL2, latch >> 8);
+
+    uint64_t start = rdtsc();
+    while (!(inb(PIT_GATE_PORT) & 0x20)) {
+        cpu_relax();
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    outb(PIT_GATE_PORT, gate);
+
+    // cycles / (latch / PIT_HZ seconds) / 1000 = kHz
+    uint64_t khz = cycles * PIT_HZ;
+    do_div_u64(&khz, latch * 1000);
+    return (uint32_t)khz;
+}
+
+static void pit_set_periodic(uint32_t hz)
+{
+    uint32_t divisor = PIT_HZ / hz;
+    if (divisor > 0xFFFF) {
+        divisor = 0xFFFF;
+    }
+    pit_load_channel0(PIT_MODE_RATE, divisor);
+}
+
+static void pit_set_next_event(uint64_t delta_ns)
+{
+    uint64_t count = delta_ns * PIT_HZ;
+    do_div_u64(&count, NSEC_PER_SEC);
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > 0xFFFF) {
+        count = 0xFFFF;
+    }
+    pit_load_channel0(PIT_MODE_ONESHOT, count);
+}
+
+static void pit_shutdown(void)
+{
+    irq_mask(IRQ_TIMER);
+    // Mode 0 with no count loaded: OUT0 stays low, no more edges
+    outb(PIT_COMMAND, PIT_SEL_CHANNEL0 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+}
+
+static void pit_irq_handler(interrupt_frame_t *frame, void *ctx)
+{
+    struct clock_event_device *dev = ctx;
+    if (dev->event_handler) {
+        dev->event_handler(dev, frame);
+    }
+}
+
+static int pit_enable(void)
+{
+    // Stop the BIOS 18.2 Hz square wave before the line is unmasked
+    outb(PIT_COMMAND, PIT_SEL_CHANNEL0 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    return irq_request(IRQ_TIMER, pit_irq_handler, &pit_clockevent);
+}
+
+struct clock_event_device pit_clockevent = {
+    .name = "pit",
+    .features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT,
+    .rating = 100,
+    // 1 count, and the longest 16-bit countdown (~54.9ms)
+    .min_delta_ns = 1000,
+    .max_delta_ns = 0xFFFFULL * NSEC_PER_SEC / PIT_HZ,
+    .enable = pit_enable,
+    .set_periodic = pit_set_periodic,
+    .set_next_event = pit_set_next_event,
+    .shutdown = pit_shutdown,
+};
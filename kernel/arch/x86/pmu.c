@@ -0,0 +1,137 @@
+#include "arch/x86/pmu.h"
+#include "printk.h"
+
+struct pmu_info pmu;
+
+static const struct pmu_event_desc {
+    const char *name;
+    uint8_t event;
+    uint8_t umask;
+    int8_t arch_bit;        // CPUID.0AH:EBX bit (set = not available), -1 if not architectural
+    int8_t fixed;           // Fixed counter that counts it, -1 if none
+} pmu_events[PMU_NR_EVENTS] = {
+    [PMU_EV_CYCLES]         = { "cycles",        0x3C, 0x00,  0,  1 },
+    [PMU_EV_INSTRUCTIONS]   = { "instructions",  0xC0, 0x00,  1,  0 },
+    [PMU_EV_LLC_MISSES]     = { "llc_misses",    0x2E, 0x41,  4, -1 },
+    [PMU_EV_BRANCH_MISSES]  = { "branch_misses", 0xC5, 0x00,  6, -1 },
+    [PMU_EV_DTLB_MISSES]    = { "dtlb_misses",   0x08, 0x01, -1, -1 },
+};
+
+const char* pmu_event_name(enum pmu_event ev)
+{
+    return pmu_events[ev].name;
+}
+
+// The model-specific events assume a family 6 Intel core
+static int pmu_is_intel_family6(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    // "GenuineIntel"
+    if (ebx != 0x756E6547 || edx != 0x49656E69 || ecx != 0x6C65746E) {
+        return 0;
+    }
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return ((eax >> 8) & 0xF) == 6;
+}
+
+void pmu_init_cpu(void)
+{
+    if (!pmu.events) {
+        return;
+    }
+
+    // Stop everything while reprogramming
+    if (pmu.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 0);
+    }
+    for (uint32_t i = 0; i < pmu.nr_evtsel; i++) {
+        wrmsr(MSR_IA32_PERFEVTSEL0 + i, pmu.evtsel[i]);
+        wrmsr(MSR_IA32_PMC0 + i, 0);
+    }
+    if (pmu.fixed_ctrl) {
+        for (uint32_t i = 0; i < pmu.nr_fixed; i++) {
+            wrmsr(MSR_IA32_FIXED_CTR0 + i, 0);
+        }
+        wrmsr(MSR_IA32_FIXED_CTR_CTRL, pmu.fixed_ctrl);
+    }
+    if (pmu.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, pmu.global_ctrl);
+    }
+}
+
+int pmu_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < CPUID_LEAF_PERFMON) {
+        pr_info("[PMU] No architectural perfmon\n");
+        return -1;
+    }
+
+    cpuid(CPUID_LEAF_PERFMON, &eax, &ebx, &ecx, &edx);
+    pmu.version = eax & 0xFF;
+    if (pmu.version == 0) {
+        pr_info("[PMU] No architectural perfmon\n");
+        return -1;
+    }
+
+    uint32_t gp_width = (eax >> 16) & 0xFF;
+    uint32_t ebx_len = (eax >> 24) & 0xFF;
+    uint32_t fixed_width = 0;
+    pmu.nr_gp = (eax >> 8) & 0xFF;
+    pmu.nr_fixed = 0;
+    if (pmu.version >= 2) {
+        pmu.nr_fixed = edx & 0x1F;
+        fixed_width = (edx >> 5) & 0xFF;
+    }
+    if (pmu.nr_gp > PMU_MAX_GP) {
+        pmu.nr_gp = PMU_MAX_GP;
+    }
+    if (pmu.nr_fixed > PMU_MAX_FIXED) {
+        pmu.nr_fixed = PMU_MAX_FIXED;
+    }
+
+    int intel6 = pmu_is_intel_family6();
+
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        const struct pmu_event_desc *desc = &pmu_events[ev];
+
+        if (desc->fixed >= 0 && (uint32_t)desc->fixed < pmu.nr_fixed && fixed_width) {
+            pmu.counter[ev] = RDPMC_FIXED | desc->fixed;
+            pmu.mask[ev] = (1ULL << fixed_width) - 1;
+            pmu.fixed_ctrl |= FIXED_CTR_CTRL_EN(desc->fixed);
+            pmu.global_ctrl |= 1ULL << (32 + desc->fixed);
+            pmu.events |= 1u << ev;
+            continue;
+        }
+
+        int available = desc->arch_bit >= 0
+            ? (uint32_t)desc->arch_bit < ebx_len && !(ebx & (1u << desc->arch_bit))
+            : intel6;
+        if (!available || pmu.nr_evtsel >= pmu.nr_gp || !gp_width) {
+            continue;
+        }
+
+        uint32_t idx = pmu.nr_evtsel++;
+        pmu.evtsel[idx] = PERFEVTSEL(desc->event, desc->umask);
+        pmu.counter[ev] = idx;
+        pmu.mask[ev] = (1ULL << gp_width) - 1;
+        pmu.global_ctrl |= 1ULL << idx;
+        pmu.events |= 1u << ev;
+    }
+
+    pr_info("[PMU] Perfmon v%u: %u general purpose (%u bit), %u fixed (%u bit) counters\n",
+            pmu.version, pmu.nr_gp, gp_width, pmu.nr_fixed, fixed_width);
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        if (pmu.events & (1u << ev)) {
+            pr_debug("[PMU]   %-14s counter 0x%08x\n", pmu_events[ev].name, pmu.counter[ev]);
+        } else {
+            pr_info("[PMU]   %-14s not counted\n", pmu_events[ev].name);
+        }
+    }
+
+    pmu_init_cpu();
+    return pmu.events ? 0 : -1;
+}
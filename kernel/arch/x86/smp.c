@@ -0,0 +1,160 @@
+#include "smp.h"
+#include "task.h"
+#include "idt.h"
+#include "printk.h"
+#include "clock.h"
+#include "arch/x86/gdt.h"
+#include "arch/x86/tss.h"
+#include "arch/x86/acpi.h"
+#include "arch/x86/apic.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/pmu.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/trampoline.h"
+#include <stddef.h>
+
+struct cpu_data cpu_data[NR_CPUS];
+
+static int nr_cpus_online = 1;
+
+_Static_assert(offsetof(struct cpu_data, self) == PERCPU_SELF_OFFSET, "smp.h offsets");
+_Static_assert(offsetof(struct cpu_data, cpu_id) == PERCPU_CPU_ID_OFFSET, "smp.h offsets");
+_Static_assert(offsetof(struct cpu_data, current) == PERCPU_CURRENT_OFFSET, "smp.h offsets");
+_Static_assert(offsetof(struct cpu_data, need_resched) == PERCPU_NEED_RESCHED_OFFSET, "smp.h offsets");
+
+// How long an AP gets to show up after its STARTUP IPIs
+#define AP_BOOT_TIMEOUT_MS  100
+
+int smp_num_cpus(void)
+{
+    return nr_cpus_online;
+}
+
+// TSS, GDT and %fs of one CPU; runs on that CPU
+static void smp_cpu_setup(int cpu)
+{
+    cpu_data[cpu].self = &cpu_data[cpu];
+    cpu_data[cpu].cpu_id = cpu;
+
+    init_tss_cpu(cpu);
+    gdt_init_cpu(cpu);
+}
+
+void smp_prepare_boot_cpu(void)
+{
+    smp_cpu_setup(0);
+    cpu_data[0].online = 1;
+}
+
+/**
+ * C entry of an application processor, called by the trampoline on its idle
+ * task's stack with paging already on. Mirrors what kernel_main does for
+ * the boot CPU, minus everything that is shared.
+ */
+void ap_start(int cpu)
+{
+    struct cpu_data *cd = &cpu_data[cpu];
+
+    smp_cpu_setup(cpu);
+    idt_load();
+    lapic_init_cpu();
+    pmu_init_cpu();
+
+    cd->idle->state = TASK_RUNNING;
+    cd->idle->exec_start = ktime_get_ns();
+    cd->idle->on_cpu = 1;
+    cd->current = cd->idle;
+
+    // Slices and sleeps need this CPU's own timer wheel; without one it
+    // only idles and never takes tasks
+    int sched = clock_init_cpu() == 0;
+    if (sched) {
+        sched_init_cpu();
+    }
+
+    pr_info("[SMP] CPU%d online, APIC ID %u%s\n", cpu, lapic_id(),
+            sched ? "" : ", no local timer: not scheduling");
+    __atomic_store_n(&cd->online, 1, __ATOMIC_RELEASE);
+
+    irq_enable();
+    sched_idle(NULL);
+}
+
+static int smp_boot_ap(int cpu, uint8_t apic_id)
+{
+    struct cpu_data *cd = &cpu_data[cpu];
+    struct trampoline_params *params = (struct trampoline_params*)
+        (TRAMPOLINE_ADDR + (trampoline_params - trampoline_start));
+
+    cd->apic_id = apic_id;
+    cd->idle = task_create_idle(cpu);
+    if (!cd->idle) {
+        return -1;
+    }
+
+    uint32_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    params->cr3 = cr3;
+    params->esp = cd->idle->stack_top;
+    params->entry = (uint32_t)ap_start;
+    params->cpu = cpu;
+
+    // INIT, then two STARTUP IPIs as the MP spec asks for (the second one
+    // is ignored by a CPU that is already running)
+    lapic_send_ipi(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+    mdelay(10);
+    for (int i = 0; i < 2 && !__atomic_load_n(&cd->online, __ATOMIC_ACQUIRE); i++) {
+        lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | (TRAMPOLINE_ADDR >> 12));
+        udelay(200);
+    }
+
+    uint64_t deadline = ktime_get_ns() + AP_BOOT_TIMEOUT_MS * NSEC_PER_MSEC;
+    while (!__atomic_load_n(&cd->online, __ATOMIC_ACQUIRE)) {
+        if (ktime_get_ns() > deadline) {
+            // Its stack stays reserved: the CPU might still wake up on it
+            pr_err("[SMP] CPU%d (APIC ID %u) did not start\n", cpu, apic_id);
+            return -1;
+        }
+        cpu_relax();
+    }
+    return 0;
+}
+
+void smp_boot_aps(void)
+{
+    if (!apic_available() || acpi_madt.cpu_count < 2) {
+        pr_info("[SMP] Single CPU\n");
+        return;
+    }
+
+    // The trampoline runs in real mode: copy it below 1MiB. That memory is
+    // reserved (RESERVED_TYPE_INIT) and identity mapped.
+    uint32_t size = (uint32_t)(trampoline_end - trampoline_start);
+    uint8_t *dst = (uint8_t*)TRAMPOLINE_ADDR;
+    for (uint32_t i = 0; i < size; i++) {
+        dst[i] = trampoline_start[i];
+    }
+
+    uint8_t bsp_id = lapic_id();
+    cpu_data[0].apic_id = bsp_id;
+
+    int cpu = 1;
+    for (int i = 0; i < acpi_madt.cpu_count && cpu < NR_CPUS; i++) {
+        uint8_t apic_id = acpi_madt.cpus[i].apic_id;
+        if (apic_id == bsp_id) {
+            continue;
+        }
+        // All APs start from the one trampoline_params block. A CPU that
+        // timed out may still read it late, so it must not be rewritten for
+        // the next CPU: stop here, the late CPU then comes up on its own
+        // stack and cpu_data slot
+        if (smp_boot_ap(cpu, apic_id) != 0) {
+            pr_warn("[SMP] Not starting the remaining CPUs\n");
+            break;
+        }
+        nr_cpus_online++;
+        cpu++;
+    }
+
+    pr_info("[SMP] %d CPU(s) online\n", nr_cpus_online);
+}
@@ -0,0 +1,41 @@
+BITS 32
+SECTION .text
+
+global switch_to
+global kthread_start
+extern kthread_entry
+
+; struct task* switch_to(struct task *prev, struct task *next)
+;
+; Saves the callee-saved registers (ebp, ebx, esi, edi) on prev's stack and
+; stores esp in prev->esp (offset 0), then loads next->esp and restores
+; next's registers from its stack. The `ret` returns wherever next was
+; switched out, or into kthread_start for a new thread.
+; eax is not touched after loading prev, so the resumed side gets the task
+; it was switched in from as the return value.
+switch_to:
+    mov eax, [esp+4]        ; prev
+    mov edx, [esp+8]        ; next
+
+    push ebp
+    push ebx
+    push esi
+    push edi
+
+    mov [eax], esp          ; prev->esp = esp
+    mov esp, [edx]          ; esp = next->esp
+
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
+
+; First return of a new thread: hand the previous task (eax) to C
+kthread_start:
+    push eax
+    call kthread_entry
+.hang:                      ; kthread_entry does not return
+    cli
+    hlt
+    jmp .hang
@@ -0,0 +1,85 @@
+; Application processor startup trampoline.
+;
+; A STARTUP IPI starts the AP in real mode at CS:IP = (vector << 8):0000, so
+; this code is copied below 1MiB (TRAMPOLINE_ADDR) before the APs are woken.
+; It does what stage2 does for the boot CPU - flat GDT, CR0.PE, far jump -
+; then turns on paging with the kernel page directory and calls into C on a
+; stack prepared by the boot CPU.
+;
+; Everything is addressed through TR() since the code runs at
+; TRAMPOLINE_ADDR, not where the kernel was linked.
+
+BITS 16
+SECTION .text
+
+global trampoline_start
+global trampoline_end
+global trampoline_params
+
+%define TRAMPOLINE_ADDR 0x8000          ; Must match arch/x86/trampoline.h
+%define TR(label) ((label) - trampoline_start + TRAMPOLINE_ADDR)
+
+trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+
+    lgdt [TR(tramp_gdt_ptr)]
+
+    mov eax, cr0
+    or eax, 0x01                        ; Protection enable
+    mov cr0, eax
+
+    jmp dword 0x08:TR(tramp_pmode)
+
+BITS 32
+tramp_pmode:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; Same address space as the boot CPU
+    mov eax, [TR(tp_cr3)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000                  ; Paging enable
+    mov cr0, eax
+
+    ; ap_start(cpu) on the stack of this CPU's idle task
+    mov esp, [TR(tp_esp)]
+    push dword [TR(tp_cpu)]
+    mov eax, [TR(tp_entry)]
+    call eax
+
+.hang:                                  ; ap_start does not return
+    cli
+    hlt
+    jmp .hang
+
+; Flat 4GiB code and data, same layout as stage2's GDT32
+align 8
+tramp_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF               ; 0x08 code
+    dq 0x00CF92000000FFFF               ; 0x10 data
+tramp_gdt_end:
+
+tramp_gdt_ptr:
+    dw tramp_gdt_end - tramp_gdt - 1
+    dd TR(tramp_gdt)
+
+; Filled in by the boot CPU for each AP (struct trampoline_params)
+align 4
+trampoline_params:
+tp_cr3:     dd 0
+tp_esp:     dd 0
+tp_entry:   dd 0
+tp_cpu:     dd 0
+
+trampoline_end:
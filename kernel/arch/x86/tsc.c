@@ -0,0 +1,85 @@
+#include "arch/x86/tsc.h"
+#include "arch/x86/hpet.h"
+#include "arch/x86/pit.h"
+#include "printk.h"
+
+uint32_t tsc_khz;
+uint32_t tsc_mult;
+uint32_t tsc_shift;
+
+static int tsc_is_invariant(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_EXT_MAX, &eax, &ebx, &ecx, &edx);
+    if (eax < CPUID_EXT_POWER) {
+        return 0;
+    }
+    cpuid(CPUID_EXT_POWER, &eax, &ebx, &ecx, &edx);
+    return (edx & CPUID_POWER_INVARIANT_TSC) != 0;
+}
+
+// Median of the runs: a run hit by an SMI or a VM exit is an outlier
+static uint32_t median(uint32_t *v, int n)
+{
+    for (int i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+    return v[n / 2];
+}
+
+// Largest shift (<= 32) whose mult = (1e6 << shift) / khz still fits in 32 bits
+static void tsc_set_scale(uint32_t khz)
+{
+    uint32_t shift = 32;
+    uint64_t mult;
+
+    for (;;) {
+        mult = 1000000ULL << shift;
+        do_div_u64(&mult, khz);
+        if (mult <= 0xFFFFFFFF || shift == 0) {
+            break;
+        }
+        shift--;
+    }
+
+    tsc_khz = khz;
+    tsc_shift = shift;
+    tsc_mult = (uint32_t)mult;
+}
+
+int tsc_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_FEAT_EDX_TSC)) {
+        pr_err("[TSC] CPU has no TSC\n");
+        return -1;
+    }
+
+    const char *ref = hpet_init() == 0 ? "HPET" : "PIT";
+    uint32_t runs[TSC_CALIBRATE_RUNS];
+    for (int i = 0; i < TSC_CALIBRATE_RUNS; i++) {
+        runs[i] = hpet_available() ? hpet_calibrate_tsc(TSC_CALIBRATE_MS)
+                                   : pit_calibrate_tsc(TSC_CALIBRATE_MS);
+    }
+    uint32_t khz = median(runs, TSC_CALIBRATE_RUNS);
+    if (khz == 0) {
+        pr_err("[TSC] Calibration against the %s failed\n", ref);
+        return -1;
+    }
+
+    tsc_set_scale(khz);
+
+    pr_info("[TSC] %u.%03u MHz (calibrated against the %s, spread %u kHz), mult %u shift %u\n",
+            khz / 1000, khz % 1000, ref, runs[TSC_CALIBRATE_RUNS - 1] - runs[0], tsc_mult, tsc_shift);
+    if (!tsc_is_invariant()) {
+        pr_warn("[TSC] Not invariant: ktime may drift with frequency changes\n");
+    }
+    return 0;
+}
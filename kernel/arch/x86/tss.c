@@ -1,36 +1,55 @@
 #include "arch/x86/tss.h"
+#include "arch/x86/gdt.h"
 
-// Define the double fault stack
-uint8_t double_fault_stack[DOUBLE_FAULT_STACK_SIZE];
+// Define the double fault stacks, one per CPU
+uint8_t double_fault_stack[NR_CPUS][DOUBLE_FAULT_STACK_SIZE];
 
-// Double fault TSS instance
-struct tss_entry tss_df;
+// Double fault TSS instances
+struct tss_entry tss_df[NR_CPUS];
+
+// TSS of the normal kernel task (loaded in TR)
+struct tss_entry tss_main[NR_CPUS];
 
 // Declare the external assembly handler
 extern void double_fault_handler(void);
 
-void init_tss() {
+void init_tss_cpu(int cpu) {
+    struct tss_entry *df = &tss_df[cpu];
+    struct tss_entry *kt = &tss_main[cpu];
+
     // Clear TSS
     for (int i = 0; i < sizeof(struct tss_entry); i++) {
-        ((uint8_t*)&tss_df)[i] = 0;
+        ((uint8_t*)df)[i] = 0;
     }
 
-    // Get current CR3 value (page directory) - THIS WILL BE ZERO!
+    // Get current CR3 value (page directory) - zero on the boot CPU until
+    // paging is on, see update_tss_cr3()
     uint32_t current_cr3;
     __asm__ volatile("mov %%cr3, %0" : "=r"(current_cr3));
     
     // Set up double fault TSS
-    tss_df.ss = 0x10;   // Data segment
-    tss_df.esp = (uint32_t)(double_fault_stack + DOUBLE_FAULT_STACK_SIZE); // FRESH STACK!
-    tss_df.cs = 0x08;   // Code segment
-    tss_df.eip = (uint32_t)double_fault_handler;
-    tss_df.eflags = 0x202;
-    tss_df.cr3 = current_cr3; // This will be updated later
-    tss_df.ds = tss_df.es = tss_df.fs = tss_df.gs = 0x10;
+    df->ss = GDT_KERNEL_DATA_SEL;
+    df->esp = (uint32_t)(double_fault_stack[cpu] + DOUBLE_FAULT_STACK_SIZE); // FRESH STACK!
+    df->cs = GDT_KERNEL_CODE_SEL;
+    df->eip = (uint32_t)double_fault_handler;
+    df->eflags = 0x202;
+    df->cr3 = current_cr3;
+    df->ds = df->es = df->gs = GDT_KERNEL_DATA_SEL;
+    df->fs = GDT_PERCPU_SEL;    // The handler can still tell which CPU it is on
+    df->iomap_base = sizeof(struct tss_entry);
+
+    // Kernel task TSS: the CPU fills it in when it switches away to #DF
+    for (int i = 0; i < sizeof(struct tss_entry); i++) {
+        ((uint8_t*)kt)[i] = 0;
+    }
+    kt->ss0 = GDT_KERNEL_DATA_SEL;
+    kt->iomap_base = sizeof(struct tss_entry);
 }
 
 void update_tss_cr3(void) {
     uint32_t current_cr3;
     __asm__ volatile("mov %%cr3, %0" : "=r"(current_cr3));
-    tss_df.cr3 = current_cr3;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        tss_df[cpu].cr3 = current_cr3;
+    }
 }
@@ -0,0 +1,67 @@
+#include "drivers/serial.h"
+#include "arch/x86/io.h"
+
+static int serial_ready = 0;
+
+/**
+ * Initialize COM1: 115200 baud, 8N1, FIFO enabled, interrupts off.
+ * Returns 0 on success, -1 if no UART answered the loopback test.
+ */
+int serial_init(void) {
+    uint16_t port = SERIAL_COM1_PORT;
+
+    outb(port + SERIAL_INT_ENABLE, 0x00);               // Disable UART interrupts
+    outb(port + SERIAL_LINE_CTRL, 0x80);                // DLAB=1 to set the divisor
+    outb(port + SERIAL_DATA, SERIAL_BAUD_DIVISOR & 0xff);
+    outb(port + SERIAL_INT_ENABLE, (SERIAL_BAUD_DIVISOR >> 8) & 0xff);
+    outb(port + SERIAL_LINE_CTRL, 0x03);                // DLAB=0, 8 bits, no parity, 1 stop
+    outb(port + SERIAL_FIFO_CTRL, 0xC7);                // Enable + clear FIFOs, 14 byte threshold
+
+    // Loopback self test: what we send must come back
+    outb(port + SERIAL_MODEM_CTRL, 0x1E);
+    outb(port + SERIAL_DATA, 0xAE);
+    if (inb(port + SERIAL_DATA) != 0xAE) {
+        serial_ready = 0;
+        return -1;
+    }
+
+    // Normal operation: DTR, RTS, OUT1, OUT2
+    outb(port + SERIAL_MODEM_CTRL, 0x0F);
+    serial_ready = 1;
+    return 0;
+}
+
+int serial_is_ready(void) {
+    return serial_ready;
+}
+
+/**
+ * Write one character, busy waiting for the transmit register.
+ * '\n' is sent as "\r\n" so terminals on the host render lines correctly.
+ */
+void serial_putc(char c) {
+    if (!serial_ready) {
+        return;
+    }
+
+    if (c == '\n') {
+        serial_putc('\r');
+    }
+
+    while (!(inb(SERIAL_COM1_PORT + SERIAL_LINE_STATUS) & SERIAL_LSR_THR_EMPTY)) {
+        // spin
+    }
+    outb(SERIAL_COM1_PORT + SERIAL_DATA, (uint8_t)c);
+}
+
+void serial_write(const char* str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        serial_putc(str[i]);
+    }
+}
+
+void serial_print_string(const char* str) {
+    while (*str) {
+        serial_putc(*str++);
+    }
+}
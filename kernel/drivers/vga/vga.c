@@ -1,13 +1,15 @@
 #include "drivers/vga.h"
+#include "arch/x86/io.h"
+#include "spinlock.h"
 
 // Global cursor position
 static int cursor_row = 0;
 static int cursor_col = 0;
 
-// Inline function to write to I/O ports
-static inline void outb(uint16_t port, uint8_t val) {
-    __asm__ volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
-}
+// Cursor, screen contents and the CRTC index/data port pair; the helpers
+// below that take no lock expect the caller to hold it
+static DEFINE_SPINLOCK(vga_lock);
+
 
 /**
  * Initialize VGA driver
@@ -24,6 +26,7 @@ void vga_init(void) {
  */
 void vga_clear_screen(void) {
     volatile unsigned char* vga = (unsigned char*)VGA_ADDRESS;
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
     
     for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
         vga[i * 2] = ' ';           // Character
@@ -33,6 +36,7 @@ void vga_clear_screen(void) {
     cursor_row = 0;
     cursor_col = 0;
     vga_move_cursor();
+    spin_unlock_irqrestore(&vga_lock, flags);
 }
 
 /**
@@ -40,9 +44,11 @@ void vga_clear_screen(void) {
  */
 void vga_set_cursor_position(int row, int col) {
     if (row >= 0 && row < VGA_HEIGHT && col >= 0 && col < VGA_WIDTH) {
+        uint32_t flags = spin_lock_irqsave(&vga_lock);
         cursor_row = row;
         cursor_col = col;
         vga_move_cursor();
+        spin_unlock_irqrestore(&vga_lock, flags);
     }
 }
 
@@ -50,8 +56,10 @@ void vga_set_cursor_position(int row, int col) {
  * Get current cursor position
  */
 void vga_get_cursor_position(int* row, int* col) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
     if (row) *row = cursor_row;
     if (col) *col = cursor_col;
+    spin_unlock_irqrestore(&vga_lock, flags);
 }
 
 /**
@@ -110,6 +118,7 @@ void vga_scroll_up(void) {
  * Print a string to the screen with automatic line wrapping and scrolling
  */
 void vga_print_string(const char* str, char color) {
+    uint32_t flags = spin_lock_irqsave(&vga_lock);
     while (*str) {
         if (*str == '\n') {
             cursor_row++;
@@ -135,4 +144,5 @@ void vga_print_string(const char* str, char color) {
         vga_move_cursor();
         str++;
     }
+    spin_unlock_irqrestore(&vga_lock, flags);
 }
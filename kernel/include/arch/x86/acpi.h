@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include "smp.h"
+
+/*
+ACPI table discovery (just enough to configure the APICs).
+    The RSDP comes from boot_info when the loader found it, else from
+    scanning the first KiB of the EBDA and the BIOS area 0xE0000-0xFFFFF
+    on 16-byte boundaries. It points at the RSDT, whose entries are the
+    physical addresses of the other tables. The MADT ("APIC") lists the
+    local APICs (one per CPU), the IOAPICs, and how ISA IRQs are wired to
+    IOAPIC inputs.
+
+All tables are identity mapped on demand; they live in E820 ACPI
+reclaimable/NVS or reserved memory, which the PMM never hands out.
+*/
+
+#define ACPI_RSDP_SIG           "RSD PTR "
+#define ACPI_EBDA_SEG_PTR       0x40E
+#define ACPI_BIOS_AREA_START    0xE0000
+#define ACPI_BIOS_AREA_END      0x100000
+
+typedef struct {
+    char signature[8];
+    uint8_t checksum;           // Sum of the first 20 bytes must be 0
+    char oem_id[6];
+    uint8_t revision;           // 0 = ACPI 1.0, 2 = ACPI 2.0+ (XSDT fields valid)
+    uint32_t rsdt_address;
+    // ACPI 2.0+
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t ext_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;            // Whole table including this header
+    uint8_t revision;
+    uint8_t checksum;           // Sum of all `length` bytes must be 0
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;             // Bit 0: legacy 8259 pair present
+    uint8_t entries[];
+} __attribute__((packed)) acpi_madt_t;
+
+#define MADT_FLAG_PCAT_COMPAT   0x1
+
+// MADT entry types
+#define MADT_LAPIC              0
+#define MADT_IOAPIC             1
+#define MADT_ISO                2   // Interrupt Source Override
+#define MADT_LAPIC_NMI          4
+#define MADT_LAPIC_ADDR         5   // 64-bit LAPIC address override
+
+#define MADT_LAPIC_ENABLED      0x1
+
+// MPS INTI flags (interrupt source overrides)
+#define MPS_POLARITY_MASK       0x3
+#define MPS_POLARITY_LOW        0x3
+#define MPS_TRIGGER_MASK        0xC
+#define MPS_TRIGGER_LEVEL       0xC
+
+#define ACPI_MAX_IOAPICS        4
+#define ACPI_ISA_IRQS           16
+
+struct acpi_cpu {
+    uint8_t acpi_id;
+    uint8_t apic_id;
+};
+
+struct acpi_ioapic {
+    uint8_t id;
+    uint32_t address;
+    uint32_t gsi_base;          // First global system interrupt it serves
+};
+
+// ISA IRQ -> global system interrupt, with MPS polarity/trigger flags
+struct acpi_isa_route {
+    uint32_t gsi;
+    uint16_t flags;
+};
+
+// What the kernel needs from the MADT
+struct acpi_madt_info {
+    int valid;
+    uint32_t lapic_address;
+    uint32_t flags;
+    int cpu_count;
+    struct acpi_cpu cpus[NR_CPUS];
+    int ioapic_count;
+    struct acpi_ioapic ioapics[ACPI_MAX_IOAPICS];
+    struct acpi_isa_route isa[ACPI_ISA_IRQS];
+};
+
+extern struct acpi_madt_info acpi_madt;
+
+// Find the RSDP and parse the MADT. Returns 0 on success.
+int acpi_init(void);
+// Look up a table by its 4-character signature, NULL if absent
+acpi_sdt_header_t* acpi_find_table(const char *signature);
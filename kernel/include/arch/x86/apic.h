@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/irq.h"
+#include "clock.h"
+
+/*
+Local APIC + IOAPIC.
+    Every CPU has a Local APIC (LAPIC) at the physical address in the
+    IA32_APIC_BASE MSR; it receives interrupts for that CPU, has its own
+    timer and sends IPIs. IOAPICs take the device lines (global system
+    interrupts, GSIs) and route each one to a vector on a chosen LAPIC.
+
+Both are memory mapped; registers are 32 bits wide and must be accessed as
+whole dwords. An EOI is a single store to the LAPIC, not port I/O.
+*/
+
+// IA32_APIC_BASE MSR bits
+#define APIC_BASE_BSP           (1 << 8)
+#define APIC_BASE_ENABLE        (1 << 11)
+#define APIC_BASE_ADDR_MASK     0xFFFFF000
+
+// LAPIC register offsets
+#define LAPIC_ID                0x020
+#define LAPIC_VERSION           0x030
+#define LAPIC_TPR               0x080   // Task Priority
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0   // Spurious Interrupt Vector
+#define LAPIC_ESR               0x280   // Error Status
+#define LAPIC_ICR_LOW           0x300   // Interrupt Command
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_LVT_LINT0         0x350
+#define LAPIC_LVT_LINT1         0x360
+#define LAPIC_LVT_ERROR         0x370
+#define LAPIC_TIMER_INIT        0x380
+#define LAPIC_TIMER_CURRENT     0x390
+#define LAPIC_TIMER_DIV         0x3E0
+
+#define LAPIC_SVR_ENABLE        (1 << 8)
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_LVT_NMI           (4 << 8)
+#define LAPIC_TIMER_PERIODIC    (1 << 17)
+#define LAPIC_TIMER_DIV_16      0x3
+
+// ICR bits
+#define LAPIC_ICR_FIXED         (0 << 8)
+#define LAPIC_ICR_INIT          (5 << 8)
+#define LAPIC_ICR_STARTUP       (6 << 8)
+#define LAPIC_ICR_PENDING       (1 << 12)
+#define LAPIC_ICR_ASSERT        (1 << 14)
+#define LAPIC_ICR_LEVEL         (1 << 15)
+#define LAPIC_ICR_ALL_BUT_SELF  (3 << 18)
+
+// Vectors owned by the LAPIC itself, above the device lines
+#define LAPIC_LOCAL_VECTOR_BASE 0xF0
+#define LAPIC_TIMER_VECTOR      0xF0
+#define LAPIC_IPI_VECTOR        0xF1
+#define LAPIC_ERROR_VECTOR      0xFE
+#define LAPIC_SPURIOUS_VECTOR   0xFF    // Low 4 bits must be 1 on P6
+
+// IOAPIC registers (indirect through IOREGSEL/IOWIN)
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WIN              0x10
+#define IOAPIC_REG_ID           0x00
+#define IOAPIC_REG_VER          0x01
+#define IOAPIC_REG_REDTBL(n)    (0x10 + 2 * (n))
+
+// Redirection entry bits (low dword)
+#define IOAPIC_ACTIVE_LOW       (1 << 13)
+#define IOAPIC_LEVEL            (1 << 15)
+#define IOAPIC_MASKED           (1 << 16)
+
+// IMCR: switch a PIC-mode board to symmetric I/O mode
+#define IMCR_SELECT             0x22
+#define IMCR_DATA               0x23
+
+extern struct irq_chip apic_chip;
+
+// Probe CPUID and the MADT, map the LAPIC/IOAPICs. Returns 0 if usable.
+int apic_init(void);
+int apic_available(void);
+
+// Per-CPU LAPIC bring-up (the BSP runs it from apic_chip.init)
+void lapic_init_cpu(void);
+uint8_t lapic_id(void);
+void lapic_eoi(void);
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t val);
+// Send vector (or an ICR delivery mode) to one APIC ID, wait for delivery
+void lapic_send_ipi(uint8_t apic_id, uint32_t icr_low);
+
+/*
+LAPIC timer clock event device.
+    Counts down from TIMER_INIT at the bus clock / 16; its rate is measured
+    against the calibrated TSC, so tsc_init() must run first.
+*/
+extern struct clock_event_device lapic_clockevent;
+int lapic_timer_calibrate(void);
+
+// Raw redirection entry for an IOAPIC input (tests and debugging)
+uint64_t ioapic_read_redirection(uint32_t gsi);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Small x86 CPU helpers shared by the kernel.
+Everything here is a single instruction (or close to it), so the helpers are
+static inline and live in the header.
+*/
+
+// Read the Time Stamp Counter (cycles since reset)
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Hint to the CPU that we are in a spin-wait loop
+static inline void cpu_relax(void)
+{
+    __asm__ __volatile__("pause" ::: "memory");
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ __volatile__("cpuid"
+                         : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                         : "a"(leaf), "c"(0));
+}
+
+// CPUID leaf 1 feature bits
+#define CPUID_FEAT_EDX_TSC      (1 << 4)
+#define CPUID_FEAT_EDX_MSR      (1 << 5)
+#define CPUID_FEAT_EDX_APIC     (1 << 9)
+
+// EFLAGS bits
+#define EFLAGS_IF               (1 << 9)    // Interrupts enabled
+
+// Model Specific Registers
+#define MSR_IA32_APIC_BASE      0x1B
+
+static inline uint64_t rdmsr(uint32_t msr)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t val)
+{
+    __asm__ __volatile__("wrmsr" :: "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32)));
+}
+
+// Read performance counter `counter` (bit 30 selects the fixed counters)
+static inline uint64_t rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Fill count dwords at dst with val (rep stosd)
+static inline void memset32(void *dst, uint32_t val, uint32_t count)
+{
+#ifdef KERNEL_HOST
+    // Plain stores, so the host build's sanitizers see them
+    for (uint32_t *p = dst; count; count--) {
+        *p++ = val;
+    }
+#else
+    __asm__ __volatile__("rep stosl" : "+D"(dst), "+c"(count) : "a"(val) : "memory");
+#endif
+}
+
+/*
+Enable interrupts and halt until the next one.
+    `sti` takes effect after the following instruction, so an interrupt
+    cannot slip in between the two and leave the CPU asleep with work due.
+*/
+static inline void cpu_idle(void)
+{
+    __asm__ __volatile__("sti; hlt" ::: "memory");
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/io.h"
+
+/*
+QEMU isa-debug-exit device.
+    Started with -device isa-debug-exit,iobase=0xf4,iosize=0x04, QEMU quits
+    as soon as a value is written to the port, with exit status
+    (value << 1) | 1. The codes below stay clear of 0 so a status of 1
+    cannot be mistaken for QEMU's own error exit. Without the device (real
+    hardware, make run) the write goes nowhere and qemu_exit() returns.
+*/
+#define QEMU_DEBUG_EXIT_PORT    0xF4
+
+#define QEMU_EXIT_SUCCESS       0x10    // QEMU exit status 33
+#define QEMU_EXIT_FAILURE       0x11    // 35: a test suite failed
+#define QEMU_EXIT_PANIK         0x12    // 37: panik()
+
+static inline void qemu_exit(uint8_t code)
+{
+    outl(QEMU_DEBUG_EXIT_PORT, code);
+}
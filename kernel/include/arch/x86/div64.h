@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+64-bit by 32-bit division without libgcc.
+    The kernel links with -nostdlib, so a plain `u64 / u32` on i386 would
+    need __udivdi3. x86 `divl` divides edx:eax by a 32-bit value as long as
+    the quotient fits in 32 bits, so divide the high word first and feed its
+    remainder into a second `divl`.
+
+Divides *n by base in place and returns the remainder.
+*/
+static inline uint32_t do_div_u64(uint64_t *n, uint32_t base)
+{
+#if defined(__i386__)
+    uint32_t low  = (uint32_t)*n;
+    uint32_t high = (uint32_t)(*n >> 32);
+    uint32_t q_high = 0;
+    uint32_t rem;
+
+    if (high >= base) {
+        q_high = high / base;
+        high %= base;
+    }
+
+    __asm__("divl %2" : "=a"(low), "=d"(rem) : "rm"(base), "0"(low), "1"(high));
+
+    *n = ((uint64_t)q_high << 32) | low;
+    return rem;
+#else
+    uint32_t rem = (uint32_t)(*n % base);
+    *n /= base;
+    return rem;
+#endif
+}
+
+/*
+(a * mul) >> shift without a 64x64 multiply overflowing.
+    The product is up to 96 bits wide, so each 32-bit half of `a` is
+    multiplied separately (two 32x32->64 `mull`s) and shifted into place.
+    shift must be <= 32.
+*/
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, unsigned int shift)
+{
+    uint32_t a_lo = (uint32_t)a;
+    uint32_t a_hi = (uint32_t)(a >> 32);
+
+    uint64_t ret = ((uint64_t)a_lo * mul) >> shift;
+    if (a_hi) {
+        ret += ((uint64_t)a_hi * mul) << (32 - shift);
+    }
+    return ret;
+}
@@ -1,5 +1,15 @@
 #pragma once
 #include <stdint.h>
+#include "smp.h"
+
+#define GDT_ENTRIES 6
+
+// Segment selectors (index * 8)
+#define GDT_KERNEL_CODE_SEL 0x08
+#define GDT_KERNEL_DATA_SEL 0x10
+#define GDT_TSS_DF_SEL      0x18    // Double fault task (only reached through the task gate)
+#define GDT_TSS_MAIN_SEL    0x20    // Kernel task, loaded in TR
+#define GDT_PERCPU_SEL      0x28    // Base = this CPU's cpu_data, loaded in %fs
 
 struct gdt_entry {
     uint16_t limit_low;
@@ -15,4 +25,8 @@ struct gdt_ptr {
     uint32_t base;
 } __attribute__((packed));
 
-void gdt_init(void);
+// One GDT per CPU: the TSS and per-CPU entries differ, the rest is shared
+extern struct gdt_entry gdt[NR_CPUS][GDT_ENTRIES];
+
+// Build and load the GDT of `cpu`, then load TR and %fs from it
+void gdt_init_cpu(int cpu);
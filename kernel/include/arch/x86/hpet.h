@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/acpi.h"
+
+/*
+High Precision Event Timer.
+    A free running main counter (>= 10 MHz) whose period in femtoseconds is
+    in the capabilities register. Found through the ACPI "HPET" table; only
+    the main counter is used (for TSC calibration), not its comparators.
+*/
+
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t event_timer_block_id;
+    // Generic Address Structure
+    uint8_t address_space;      // 0 = system memory
+    uint8_t register_bit_width;
+    uint8_t register_bit_offset;
+    uint8_t access_size;
+    uint64_t address;
+    uint8_t hpet_number;
+    uint16_t minimum_tick;
+    uint8_t page_protection;
+} __attribute__((packed)) acpi_hpet_t;
+
+#define HPET_REG_CAPS           0x000   // Bits 32-63: counter period (fs)
+#define HPET_REG_CONFIG         0x010
+#define HPET_REG_COUNTER        0x0F0
+
+#define HPET_CONFIG_ENABLE      (1 << 0)
+
+#define HPET_MAX_PERIOD_FS      100000000   // 100ns, the spec limit
+
+// Map and start the HPET. Returns 0 if one is present.
+int hpet_init(void);
+int hpet_available(void);
+uint32_t hpet_read_counter(void);
+uint32_t hpet_period_fs(void);
+
+// TSC cycles per millisecond measured over `ms` milliseconds
+uint32_t hpet_calibrate_tsc(uint32_t ms);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Common interrupt frame.
+    Built by isr_common (isr_stubs.asm) for every vector; the field order is
+    the reverse of the push order.
+*/
+typedef struct {
+    uint32_t gs, fs, es, ds;                            // Pushed by isr_common
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;    // Pushed by pusha (esp = value before pusha)
+    uint32_t vector;                                    // Pushed by the stub
+    uint32_t error_code;                                // Pushed by the CPU or a dummy 0
+    uint32_t eip, cs, eflags;                           // Pushed by CPU on interrupt
+    uint32_t useresp, ss;                               // Only valid when coming from ring 3
+} interrupt_frame_t;
+
+// Stack pointer of the interrupted code
+static inline uint32_t interrupt_frame_sp(const interrupt_frame_t *frame)
+{
+    if (frame->cs & 3) {
+        return frame->useresp;
+    }
+    // Same privilege: the CPU pushed no esp/ss, the old stack starts right
+    // after eflags. pusha saved esp pointing at `vector`.
+    return frame->esp + 5 * sizeof(uint32_t);
+}
+
+// Vectors 0-31 are CPU exceptions
+#define EXCEPTION_VECTORS   32
+
+#define VECTOR_DIVIDE_ERROR     0
+#define VECTOR_DEBUG            1
+#define VECTOR_NMI              2
+#define VECTOR_BREAKPOINT       3
+#define VECTOR_INVALID_OPCODE   6
+#define VECTOR_DOUBLE_FAULT     8
+#define VECTOR_GP_FAULT         13
+#define VECTOR_PAGE_FAULT       14
+
+typedef void (*irq_handler_t)(interrupt_frame_t *frame, void *ctx);
+
+// Dispatch table entry, one per vector
+struct irq_desc {
+    irq_handler_t handler;
+    void *ctx;
+    uint32_t count;         // Times this vector fired
+};
+
+void interrupt_init(void);
+
+// Returns 0 on success, -1 if the vector already has a handler
+int irq_register_handler(uint8_t vector, irq_handler_t fn, void *ctx);
+void irq_unregister_handler(uint8_t vector);
+uint32_t irq_get_count(uint8_t vector);
+
+// Called by isr_common for every vector
+void interrupt_dispatch(interrupt_frame_t *frame);
+
+// Frame of the interrupt this CPU is handling (the innermost one if they
+// nest), NULL outside interrupt context
+interrupt_frame_t* interrupt_current_frame(void);
+
+// Interrupt flag helpers
+#ifdef KERNEL_HOST
+// Host build (kernel/tests/host): cli/sti fault in user mode, and there
+// are no interrupts to keep out anyway
+static inline void irq_enable(void)  { }
+static inline void irq_disable(void) { }
+static inline uint32_t irq_save(void) { return 0; }
+static inline void irq_restore(uint32_t flags) { (void)flags; }
+#else
+static inline void irq_enable(void)  { __asm__ __volatile__("sti" ::: "memory"); }
+static inline void irq_disable(void) { __asm__ __volatile__("cli" ::: "memory"); }
+
+static inline uint32_t irq_save(void)
+{
+    uint32_t flags;
+    __asm__ __volatile__("pushf\n pop %0\n cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags)
+{
+    __asm__ __volatile__("push %0\n popf" :: "r"(flags) : "memory", "cc");
+}
+#endif
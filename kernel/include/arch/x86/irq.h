@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/interrupt.h"
+
+/*
+IRQ controller abstraction.
+    Hardware interrupt lines (IRQ 0..nr_lines-1) are delivered on vectors
+    starting at IRQ_VECTOR_BASE, right after the CPU exceptions. Drivers only
+    talk to this layer; the backend behind it (8259 PIC today, LAPIC/IOAPIC
+    later) is picked at boot with irq_chip_install().
+
+interrupt_dispatch() calls irq_chip_begin() before and irq_chip_end() after
+the vector's handler, so the backend can drop spurious interrupts and send
+its end-of-interrupt without every handler knowing about it.
+*/
+
+#define IRQ_VECTOR_BASE     32
+#define IRQ_VECTOR(line)    (IRQ_VECTOR_BASE + (line))
+
+// Legacy ISA IRQ lines
+#define IRQ_TIMER       0
+#define IRQ_KEYBOARD    1
+#define IRQ_CASCADE     2
+#define IRQ_COM2        3
+#define IRQ_COM1        4
+#define IRQ_LPT1        7
+#define IRQ_RTC         8
+#define IRQ_MOUSE       12
+#define IRQ_ATA_PRIMARY 14
+#define IRQ_ATA_SECOND  15
+
+struct irq_chip {
+    const char *name;
+    uint8_t nr_lines;
+
+    void (*init)(void);
+    // Mask every line and stop delivering (used when switching backends)
+    void (*disable)(void);
+    void (*mask)(uint8_t line);
+    void (*unmask)(uint8_t line);
+    // Return nonzero if the interrupt on this vector is spurious and must
+    // not be handled or acknowledged
+    int (*is_spurious)(uint8_t vector);
+    // Acknowledge the interrupt on this vector (no-op for vectors the chip
+    // does not own)
+    void (*eoi)(uint8_t vector);
+};
+
+// Disable the current backend (if any), initialize and switch to `chip`
+void irq_chip_install(struct irq_chip *chip);
+struct irq_chip *irq_chip_get(void);
+
+void irq_mask(uint8_t line);
+void irq_unmask(uint8_t line);
+
+// Register fn on the line's vector and unmask it. Returns 0 on success.
+int irq_request(uint8_t line, irq_handler_t fn, void *ctx);
+void irq_free(uint8_t line);
+
+uint32_t irq_get_spurious_count(void);
+
+// Hooks used by interrupt_dispatch(); return 0 from begin to drop the interrupt
+int irq_chip_begin(uint8_t vector);
+void irq_chip_end(uint8_t vector);
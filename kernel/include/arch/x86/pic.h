@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/irq.h"
+
+/*
+8259A Programmable Interrupt Controller (master + slave cascaded on IRQ2).
+    The BIOS leaves the master on vectors 8-15, which collide with CPU
+    exceptions (IRQ0 from the PIT would look like a double fault), so the
+    pair is remapped to IRQ_VECTOR_BASE..IRQ_VECTOR_BASE+15.
+*/
+
+#define PIC1_CMD        0x20
+#define PIC1_DATA       0x21
+#define PIC2_CMD        0xA0
+#define PIC2_DATA       0xA1
+
+#define PIC_LINES       16
+
+// Initialization Command Words
+#define ICW1_ICW4       0x01    // ICW4 will be sent
+#define ICW1_INIT       0x10    // Start initialization sequence
+#define ICW4_8086       0x01    // 8086/88 mode
+
+// Operation Command Words
+#define OCW2_SPECIFIC_EOI   0x60    // | line (0-7)
+#define OCW3_READ_IRR       0x0A
+#define OCW3_READ_ISR       0x0B
+
+extern struct irq_chip pic_8259_chip;
+
+// Current mask, bit n set = IRQ n masked (slave in the high byte)
+uint16_t pic_get_mask(void);
+// In-service register of both chips (slave in the high byte)
+uint16_t pic_get_isr(void);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include "clock.h"
+
+/*
+8253/8254 Programmable Interval Timer.
+    Three 16-bit counters driven by a fixed 1.193182 MHz clock.
+    Channel 0 is wired to IRQ0 and used as a tick source when there is no
+    LAPIC timer; channel 2 is gated through port 0x61 and, unlike channel 0,
+    its output can be polled, which is what TSC calibration uses.
+*/
+
+#define PIT_HZ              1193182
+
+#define PIT_CHANNEL0        0x40
+#define PIT_CHANNEL2        0x42
+#define PIT_COMMAND         0x43
+#define PIT_GATE_PORT       0x61    // Bit 0: channel 2 gate, bit 1: speaker, bit 5: OUT2
+
+// Command byte fields
+#define PIT_SEL_CHANNEL0    (0 << 6)
+#define PIT_SEL_CHANNEL2    (2 << 6)
+#define PIT_ACCESS_LOHI     (3 << 4)
+#define PIT_MODE_ONESHOT    (0 << 1)    // Mode 0: interrupt on terminal count
+#define PIT_MODE_RATE       (2 << 1)    // Mode 2: rate generator (periodic)
+
+extern struct clock_event_device pit_clockevent;
+
+// TSC cycles per millisecond measured over `ms` milliseconds (ms <= 50)
+uint32_t pit_calibrate_tsc(uint32_t ms);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/cpu.h"
+
+/*
+Performance monitoring unit (Intel architectural perfmon).
+    CPUID leaf 0xA reports the perfmon version, how many general purpose
+    and fixed counters there are and how wide they are, and which of the
+    architectural events are missing. pmu_init() programs one counter per
+    PMU_EV_* event and leaves them running; readers take snapshots with
+    rdpmc and subtract (perf.h).
+
+    Cycles and instructions go to the fixed counters where there are any
+    (version 2 and up), the rest to general purpose ones, in PMU_EV_*
+    order until they run out. The dTLB event is not architectural: it is
+    DTLB_LOAD_MISSES.MISS_CAUSES_A_WALK (0x08/0x01, Nehalem to Skylake)
+    and is only set up on family 6 Intel CPUs.
+
+    Counters count in ring 0 and 3 and are never reset after setup, so
+    deltas are taken modulo the counter width. Application processors
+    get the same programming in pmu_init_cpu().
+
+No PMU (AMD, or QEMU without -cpu host under KVM) leaves pmu.events at 0
+and every reader a no-op.
+*/
+
+#define CPUID_LEAF_PERFMON          0x0A
+
+// Model Specific Registers
+#define MSR_IA32_PMC0               0xC1
+#define MSR_IA32_PERFEVTSEL0        0x186
+#define MSR_IA32_FIXED_CTR0         0x309
+#define MSR_IA32_FIXED_CTR_CTRL     0x38D
+#define MSR_IA32_PERF_GLOBAL_CTRL   0x38F
+
+// IA32_PERFEVTSELx
+#define PERFEVTSEL_USR              (1 << 16)
+#define PERFEVTSEL_OS               (1 << 17)
+#define PERFEVTSEL_EN               (1 << 22)
+#define PERFEVTSEL(event, umask) \
+    ((event) | ((umask) << 8) | PERFEVTSEL_USR | PERFEVTSEL_OS | PERFEVTSEL_EN)
+
+// IA32_FIXED_CTR_CTRL: 4 bits per counter, count in ring 0 and 3
+#define FIXED_CTR_CTRL_EN(n)        (0x3u << ((n) * 4))
+
+// rdpmc index of a fixed counter
+#define RDPMC_FIXED                 (1u << 30)
+
+#define PMU_MAX_GP                  8
+#define PMU_MAX_FIXED               3
+
+enum pmu_event {
+    PMU_EV_CYCLES,
+    PMU_EV_INSTRUCTIONS,
+    PMU_EV_LLC_MISSES,
+    PMU_EV_BRANCH_MISSES,
+    PMU_EV_DTLB_MISSES,
+    PMU_NR_EVENTS
+};
+
+struct pmu_info {
+    uint32_t version;                   // Architectural perfmon version, 0 = none
+    uint32_t nr_gp;                     // General purpose counters (used up to PMU_MAX_GP)
+    uint32_t nr_fixed;                  // Fixed counters (used up to PMU_MAX_FIXED)
+    uint32_t events;                    // Bit per PMU_EV_* that has a counter
+    uint32_t counter[PMU_NR_EVENTS];    // rdpmc index
+    uint64_t mask[PMU_NR_EVENTS];       // Counter width
+
+    // Programming replayed on every CPU
+    uint32_t evtsel[PMU_MAX_GP];
+    uint32_t nr_evtsel;
+    uint32_t fixed_ctrl;
+    uint64_t global_ctrl;
+};
+
+extern struct pmu_info pmu;
+
+// Detect the PMU and program the boot CPU. Returns 0 if any event is counted.
+int pmu_init(void);
+// Program the calling application processor like the boot CPU
+void pmu_init_cpu(void);
+
+const char* pmu_event_name(enum pmu_event ev);
+
+// Raw counter values of every event (0 for the ones not counted)
+static inline void pmu_read(uint64_t *out)
+{
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        out[ev] = (pmu.events & (1u << ev)) ? rdpmc(pmu.counter[ev]) : 0;
+    }
+}
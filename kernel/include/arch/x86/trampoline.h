@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// Physical address the AP startup code is copied to. Must be page aligned
+// and below 1MiB: the STARTUP IPI vector is TRAMPOLINE_ADDR >> 12.
+#define TRAMPOLINE_ADDR     0x8000
+
+// Filled in by the boot CPU before each STARTUP IPI (trampoline.asm)
+struct trampoline_params {
+    uint32_t cr3;           // Kernel page directory
+    uint32_t esp;           // Initial stack of the AP
+    uint32_t entry;         // void ap_start(int cpu)
+    uint32_t cpu;           // Logical CPU number passed to entry
+};
+
+// Bounds of the trampoline code in the kernel image
+extern uint8_t trampoline_start[];
+extern uint8_t trampoline_end[];
+extern uint8_t trampoline_params[];
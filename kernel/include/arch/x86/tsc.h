@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/cpu.h"
+#include "arch/x86/div64.h"
+
+/*
+TSC clocksource.
+    The TSC is calibrated once at boot against the HPET (or the PIT when
+    there is none). Converting cycles to nanoseconds is then a multiply and
+    a shift: ns = (cycles * tsc_mult) >> tsc_shift, with tsc_mult chosen so
+    it fits in 32 bits. Time counts from CPU reset (TSC = 0), so stamps taken
+    by the bootloader convert the same way.
+
+Assumes an invariant TSC (constant rate across P-states); tsc_init() warns
+when CPUID does not report one.
+*/
+
+#define CPUID_EXT_MAX               0x80000000
+#define CPUID_EXT_POWER             0x80000007
+#define CPUID_POWER_INVARIANT_TSC   (1 << 8)
+
+// How long each calibration run counts, and how many runs (median is used)
+#define TSC_CALIBRATE_MS            10
+#define TSC_CALIBRATE_RUNS          5
+
+extern uint32_t tsc_khz;
+extern uint32_t tsc_mult;
+extern uint32_t tsc_shift;
+
+// Calibrate and set the scale. Returns 0 on success.
+int tsc_init(void);
+
+static inline uint64_t tsc_cycles_to_ns(uint64_t cycles)
+{
+    return mul_u64_u32_shr(cycles, tsc_mult, tsc_shift);
+}
+
+static inline uint64_t tsc_ns_to_cycles(uint64_t ns)
+{
+    uint64_t cycles = ns * tsc_khz;
+    do_div_u64(&cycles, 1000000);
+    return cycles;
+}
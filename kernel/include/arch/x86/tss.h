@@ -2,11 +2,12 @@
 #define TSS_H
 
 #include <stdint.h>
+#include "smp.h"
 
 
-// Double fault stack (4KB)
+// Double fault stack (4KB per CPU)
 #define DOUBLE_FAULT_STACK_SIZE 0x1000 
-extern uint8_t double_fault_stack[DOUBLE_FAULT_STACK_SIZE];
+extern uint8_t double_fault_stack[NR_CPUS][DOUBLE_FAULT_STACK_SIZE];
 
 
 // Complete TSS structure for task switching
@@ -40,10 +41,12 @@ struct tss_entry {
     uint16_t iomap_base;
 } __attribute__((packed));
 
-extern struct tss_entry tss_df;
+// Indexed by CPU; each CPU's GDT points at its own pair
+extern struct tss_entry tss_df[NR_CPUS];
+extern struct tss_entry tss_main[NR_CPUS];   // Kernel task; holds the faulting state after a #DF
 extern void double_fault_handler(void);  // Assembly handler
 void update_tss_cr3(void);
-void init_tss();
+void init_tss_cpu(int cpu);
 
 #endif // TSS_H
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Stack backtraces.
+    The kernel is built with frame pointers, so every frame starts with the
+    caller's EBP followed by the return address:
+
+        [ebp + 4]   return address into the caller
+        [ebp]       caller's ebp  ->  next frame
+
+    backtrace_capture() follows that chain. It only reads memory on the
+    stack the walk started on (identity-mapped low memory, the boot CPU's
+    high stack, or one kthread stack slot, never its guard page) and stops
+    as soon as a frame does not move up the stack, so a corrupted chain ends
+    the walk instead of faulting again.
+
+    Return addresses point after the call; they are symbolized as addr - 1
+    so a call that ends a function is still put in that function.
+*/
+
+#define BACKTRACE_MAX_DEPTH     16
+
+// Up to max return addresses, innermost first, starting at frame `ebp`
+uint32_t backtrace_capture(uint32_t ebp, uint32_t *out, uint32_t max);
+
+// "  #<index> 0x<addr> <function>+0x<offset>\n"
+int backtrace_format(char *buf, size_t size, uint32_t index, uint32_t addr);
+
+// Print a captured backtrace to CONSOLE_* sinks
+void backtrace_print(int sinks, const uint32_t *addrs, uint32_t depth);
+
+// Print the stack of an interrupted context (fault handlers): its EIP,
+// then the callers found from its EBP
+void backtrace_print_context(int sinks, uint32_t eip, uint32_t ebp);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef KERNEL_HOST
+#include "perf.h"
+#endif
+
+/*
+Microbenchmarks (make bench, KERNEL_BENCH).
+    BENCH(name) { ... } defines a benchmark and registers it in the .bench
+    section; bench_run_all() runs every registered one. Each body runs
+    BENCH_WARMUP times untimed, then BENCH_ITERS times with interrupts off,
+    and each run is one sample. The report gives min, median, p99 and max
+    in TSC cycles, minus the cost of timing an empty body.
+
+    The timer is serialized on both ends so out-of-order execution cannot
+    move work across it: cpuid; rdtsc at the start, rdtscp; cpuid at the
+    end (cpuid; rdtsc without RDTSCP).
+
+    A body can leave setup and cleanup out of its sample:
+
+    BENCH(pmm_alloc_frame) {
+        void *frame = pmm_alloc_frame();
+        bench_stop(bench);
+        pmm_free_frame(frame);
+    }
+
+Every result also goes to the serial port as one line,
+    BENCH name=<name> iters=<n> min=<c> median=<c> p99=<c> max=<c>
+so a host script can compare runs. With a PMU (arch/x86/pmu.h) the line
+goes on with the per-iteration hardware counts of the sample window,
+cycles=<c> instructions=<i> ipc=<x.yy> ... (see perf.h), minus what an
+empty body counts. They are read just outside the TSC reads, so they do
+not add to the cycle figures.
+*/
+
+#define BENCH_ITERS     1000
+#define BENCH_WARMUP    100
+
+struct bench_run {
+    uint64_t start;             // Sample start (bench_start())
+    uint64_t stop;              // Sample end, 0 until bench_stop()
+    struct perf_region *perf;   // Counts the same window, NULL if not counting
+};
+
+struct bench_def {
+    const char *name;
+    void (*fn)(struct bench_run *bench);
+};
+
+// The host build (kernel/tests/host) has no linker script; there the
+// linker's own __start_bench/__stop_bench bound the section
+#ifdef KERNEL_HOST
+#define BENCH_SECTION   "bench"
+#else
+#define BENCH_SECTION   ".bench"
+#endif
+
+#define BENCH(name) \
+    static void bench_fn_##name(struct bench_run *bench); \
+    static const struct bench_def bench_def_##name \
+        __attribute__((used, section(BENCH_SECTION), aligned(4))) = { #name, bench_fn_##name }; \
+    static void bench_fn_##name(struct bench_run *bench __attribute__((unused)))
+
+extern int bench_has_rdtscp;
+
+static inline uint64_t bench_tsc_begin(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("cpuid\n\trdtsc"
+                         : "=a"(lo), "=d"(hi) : "a"(0) : "ebx", "ecx", "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t bench_tsc_end(void)
+{
+    uint32_t lo, hi;
+    if (bench_has_rdtscp) {
+        __asm__ __volatile__("rdtscp\n\tmov %%eax, %0\n\tmov %%edx, %1\n\txor %%eax, %%eax\n\tcpuid"
+                             : "=r"(lo), "=r"(hi) : : "eax", "ebx", "ecx", "edx", "memory");
+    } else {
+        __asm__ __volatile__("cpuid\n\trdtsc"
+                             : "=a"(lo), "=d"(hi) : "a"(0) : "ebx", "ecx", "memory");
+    }
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Restart the sample, leaving the setup before it out
+static inline void bench_start(struct bench_run *bench)
+{
+#ifndef KERNEL_HOST
+    if (bench->perf) {
+        perf_begin(bench->perf);
+    }
+#endif
+    bench->start = bench_tsc_begin();
+}
+
+// End the sample early, leaving the cleanup after it out
+static inline void bench_stop(struct bench_run *bench)
+{
+    if (!bench->stop) {
+        bench->stop = bench_tsc_end();
+#ifndef KERNEL_HOST
+        if (bench->perf) {
+            perf_end(bench->perf);
+        }
+#endif
+    }
+}
+
+// Run every BENCH() linked into the kernel
+void bench_run_all(void);
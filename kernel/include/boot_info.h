@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include "memory_map.h"
+
+/*
+Boot information handed over by the bootloader.
+    _start passes the bootloader's eax (magic) and ebx (pointer) straight to
+    kernel_main(). Two loaders are understood:
+        - stage2: eax = BOOT_INFO_MAGIC, ebx = struct boot_info
+        - a Multiboot (v1) loader such as `qemu -kernel`:
+          eax = MULTIBOOT_BOOTLOADER_MAGIC, ebx = multiboot_info_t
+    boot_info_init() copies either into the kernel's own `boot_info`, with
+    the memory map and command line moved into kernel memory, so nothing
+    later depends on where the loader left them.
+
+stage2.asm builds this struct by hand: the layout is fixed and checked by
+the _Static_asserts in boot_info.c. A newer loader may pass a larger
+struct (size), fields are only ever appended.
+*/
+
+#define BOOT_INFO_MAGIC         0x464E4942      // "BINF"
+#define BOOT_INFO_VERSION       2
+
+// boot_info.flags: which fields the loader filled in
+#define BOOT_INFO_MMAP          (1 << 0)
+#define BOOT_INFO_KERNEL_RANGE  (1 << 1)
+#define BOOT_INFO_BOOT_DRIVE    (1 << 2)
+#define BOOT_INFO_VIDEO_MODE    (1 << 3)
+#define BOOT_INFO_ACPI_RSDP     (1 << 4)
+#define BOOT_INFO_FRAMEBUFFER   (1 << 5)
+#define BOOT_INFO_CMDLINE       (1 << 6)
+#define BOOT_INFO_TSC           (1 << 7)    // v2: tsc_* (boot_prof.h)
+
+// boot_framebuffer.type (same values as Multiboot)
+#define BOOT_FB_TYPE_INDEXED    0
+#define BOOT_FB_TYPE_RGB        1
+#define BOOT_FB_TYPE_EGA_TEXT   2
+
+#define BOOT_CMDLINE_MAX        256
+
+struct boot_framebuffer {
+    uint64_t addr;
+    uint32_t pitch;             // Bytes per line
+    uint32_t width;             // Pixels, or characters in text mode
+    uint32_t height;
+    uint8_t  bpp;
+    uint8_t  type;              // BOOT_FB_TYPE_*
+    uint16_t reserved;
+} __attribute__((packed));
+
+struct boot_info {
+    uint32_t magic;             // BOOT_INFO_MAGIC
+    uint16_t version;           // BOOT_INFO_VERSION
+    uint16_t size;              // sizeof(struct boot_info) as the loader knows it
+    uint32_t flags;             // BOOT_INFO_*
+    uint32_t kernel_start;      // Physical range the kernel occupies, .bss included
+    uint32_t kernel_end;
+    uint32_t mmap_addr;         // e820_entry_t[mmap_count]
+    uint32_t mmap_count;
+    uint32_t boot_drive;        // BIOS drive number (0x80 = first hard disk)
+    uint32_t video_mode;        // BIOS video mode
+    uint32_t acpi_rsdp;         // Physical address of the RSDP
+    uint32_t cmdline;           // NUL-terminated string
+    struct boot_framebuffer fb;
+    // v2: stage2 rdtsc stamps
+    uint64_t tsc_stage2;        // stage2 entry
+    uint64_t tsc_loaded;        // Kernel image in memory
+    uint64_t tsc_handoff;       // Jump to the kernel
+} __attribute__((packed));
+
+extern struct boot_info boot_info;
+
+// Copy the loader's boot information into `boot_info`. Returns 0 on
+// success, -1 if magic matches no known loader.
+int boot_info_init(uint32_t magic, uint32_t addr);
+// Print what the loader told us
+void boot_info_print(void);
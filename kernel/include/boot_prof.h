@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Boot-phase profiler.
+    boot_prof_mark("name") takes a TSC stamp at the end of the phase
+    "name"; a phase lasts from the previous mark to its own. stage2 stamps
+    its own phases into boot_info (BOOT_INFO_TSC) and boot_prof_start()
+    puts them in front of the kernel's. The TSC counts from CPU reset, so
+    the first phase is the firmware itself (on a VM the TSC may not start
+    at 0 and that phase is meaningless).
+
+    boot_prof_report() prints one "[BOOTPROF]" line per phase, once the TSC
+    is calibrated, so boot logs can be compared across releases.
+
+Boot CPU only, no locking.
+*/
+
+#define BOOT_PROF_MAX_PHASES    32
+
+struct boot_phase {
+    const char *name;           // Phase that ended at `tsc` (string literal)
+    uint64_t tsc;
+};
+
+// Import the bootloader's stamps and mark the kernel entry
+void boot_prof_start(void);
+// End of phase `name`
+void boot_prof_mark(const char *name);
+// Print the phase table
+void boot_prof_report(void);
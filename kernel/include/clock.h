@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include "arch/x86/tsc.h"
+#include "arch/x86/interrupt.h"
+
+/*
+Clock subsystem.
+    - Clocksource: the calibrated TSC. ktime_get_ns() is a rdtsc plus a
+      multiply and shift, cheap enough for log stamps and hot paths.
+    - Clock event devices: interrupt sources that can fire periodically or
+      once after a delay (LAPIC timer, PIT). The highest rated one registered
+      is run in one-shot mode, armed only for the next timer wheel expiry
+      (see timer.h); there is no periodic tick.
+*/
+
+#define NSEC_PER_SEC    1000000000ULL
+#define NSEC_PER_MSEC   1000000ULL
+#define NSEC_PER_USEC   1000ULL
+
+#define CLOCK_EVT_FEAT_PERIODIC     (1 << 0)
+#define CLOCK_EVT_FEAT_ONESHOT      (1 << 1)
+#define CLOCK_EVT_FEAT_PERCPU       (1 << 2)    // One instance per CPU (LAPIC timer)
+
+struct clock_event_device {
+    const char *name;
+    uint32_t features;          // CLOCK_EVT_FEAT_*
+    int rating;                 // Higher is preferred
+    uint64_t min_delta_ns;      // Shortest / longest one-shot delay
+    uint64_t max_delta_ns;
+
+    int (*enable)(void);        // Hook up the interrupt
+    void (*enable_cpu)(void);   // FEAT_PERCPU: set up the calling CPU's instance
+    void (*set_periodic)(uint32_t hz);
+    void (*set_next_event)(uint64_t delta_ns);
+    void (*shutdown)(void);
+
+    // Called from the device's interrupt, set by the clock core
+    void (*event_handler)(struct clock_event_device *dev, interrupt_frame_t *frame);
+    struct clock_event_device *next;
+};
+
+// Nanoseconds since CPU reset, 0 until the TSC is calibrated
+static inline uint64_t ktime_get_ns(void)
+{
+    return tsc_cycles_to_ns(rdtsc());
+}
+
+// Busy wait (TSC based once calibrated)
+void udelay(uint32_t us);
+void mdelay(uint32_t ms);
+
+void clockevents_register_device(struct clock_event_device *dev);
+struct clock_event_device* clockevent_get(void);
+
+// Arm the one-shot device for an absolute ktime (clamped to its range)
+void clockevent_program(uint64_t expires_ns);
+
+// Calibrate the TSC, pick the clock event device and start the timer wheel
+void clock_init(void);
+// Timer wheel of an application processor, on its own copy of the tick
+// device. Returns -1 if that device is shared (PIT): the CPU gets no timers.
+int clock_init_cpu(void);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Console sinks.
+    Dump paths (trace ring, log replay, crash reports) can target the VGA
+    screen, the serial port, or both.
+*/
+#define CONSOLE_VGA     (1 << 0)
+#define CONSOLE_SERIAL  (1 << 1)
+#define CONSOLE_ALL     (CONSOLE_VGA | CONSOLE_SERIAL)
+
+// Write a NUL terminated string to every selected sink (color is VGA only)
+void console_write(int sinks, const char* str, char color);
@@ -0,0 +1,35 @@
+#ifndef DRIVERS_SERIAL_H
+#define DRIVERS_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 16550 UART (COM1) driver.
+ * Used as a second console that survives VGA scrolling and can be captured
+ * by the host (qemu -serial stdio / -serial file:log.txt).
+ */
+
+#define SERIAL_COM1_PORT    0x3f8
+
+// Register offsets from the base port
+#define SERIAL_DATA         0       // DLAB=0: data, DLAB=1: divisor low
+#define SERIAL_INT_ENABLE   1       // DLAB=0: IER,  DLAB=1: divisor high
+#define SERIAL_FIFO_CTRL    2
+#define SERIAL_LINE_CTRL    3
+#define SERIAL_MODEM_CTRL   4
+#define SERIAL_LINE_STATUS  5
+
+#define SERIAL_LSR_THR_EMPTY 0x20   // Transmit holding register empty
+
+// 115200 / divisor
+#define SERIAL_BAUD_DIVISOR 1       // 115200 baud
+
+// Serial Driver Functions
+int serial_init(void);
+int serial_is_ready(void);
+void serial_putc(char c);
+void serial_write(const char* str, size_t len);
+void serial_print_string(const char* str);
+
+#endif /* DRIVERS_SERIAL_H */
@@ -63,3 +63,4 @@ typedef struct
 // APIs
 void idt_set_gate(int num, uint32_t base, uint16_t sel, uint8_t flags);
 void idt_init(void);
+void idt_load(void);
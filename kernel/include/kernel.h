@@ -7,16 +7,49 @@
 // Core kernel includes
 #include "printk.h"
 #include "drivers/vga.h"
+#include "drivers/serial.h"
+#include "console.h"
+#include "trace.h"
+#include "profile.h"
+#include "perf.h"
+#include "pstore.h"
 #include "panik.h"
 #include "memory_map.h"
+#include "boot_info.h"
+#include "boot_prof.h"
 #include "pmm.h"
 #include "paging.h"
+#include "page_fault.h"
 #include "idt.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/irq.h"
+#include "arch/x86/pic.h"
+#include "arch/x86/acpi.h"
+#include "arch/x86/apic.h"
+#include "arch/x86/pmu.h"
+#include "clock.h"
+#include "timer.h"
+#include "task.h"
+#include "smp.h"
 #include "arch/x86/tss.h"
+#include "arch/x86/debug_exit.h"
+
+#ifdef KERNEL_BENCH
+#include "bench.h"
+#endif
 
 #ifdef KERNEL_TESTS
 #include "tests/test_printk.h"
 #include "tests/test_panik.h"
+#include "tests/test_interrupt.h"
+#include "tests/test_clock.h"
+#include "tests/test_task.h"
+#include "tests/test_smp.h"
+#include "tests/test_spinlock.h"
+#include "tests/test_profile.h"
+#include "tests/test_perf.h"
+#include "tests/test_trace.h"
+#include "tests/test_runner.h"
 #endif
 
 // Kernel version information
@@ -31,8 +64,8 @@
 
 #define ARRAY_SIZE(x)   (sizeof(x) / sizeof((x)[0]))
 
-// Kernel main function (called from assembly)
-void kernel_main(void);
+// Kernel main function (called from assembly with the loader's eax and ebx)
+void kernel_main(uint32_t boot_magic, uint32_t boot_info_addr);
 
 void grow_stack(int depth);
 
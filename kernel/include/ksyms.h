@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Kernel symbol table.
+    Every text symbol of the kernel image, sorted by address, for turning
+    code addresses into "function+offset". The table is generated at build
+    time (scripts/gen_ksyms.sh): the kernel is linked once without it, the
+    `nm -n` output of that link becomes build/<image>.ksyms.c, and the
+    final link adds it in the .ksyms section. kernel.ld puts .ksyms after
+    all code and data, so adding it moves no function; the Makefile checks
+    that by regenerating the table from the final image.
+
+    Addresses and names are kept apart so the binary search only walks the
+    4-byte address array. An image linked without a table (the first
+    link) still works: lookups just fail.
+*/
+
+// scripts/gen_ksyms.sh; weak so the first link resolves them to NULL
+extern const uint32_t ksym_count __attribute__((weak));
+extern const uint32_t ksym_addrs[] __attribute__((weak));          // Sorted
+extern const uint32_t ksym_name_offs[] __attribute__((weak));      // Into ksym_names
+extern const char ksym_names[] __attribute__((weak));
+
+// Name of the function containing addr and addr's offset into it, NULL
+// if addr is not kernel code (or there is no table)
+const char* ksym_lookup(uint32_t addr, uint32_t *offset);
+
+// "name+0x1c", or "0x%08x" when the address has no symbol
+int ksym_snprint(char *buf, size_t size, uint32_t addr);
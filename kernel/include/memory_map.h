@@ -20,6 +20,7 @@ typedef enum {
     RESERVED_TYPE_KERNEL        = 1 << 3,
     RESERVED_TYPE_BITMAP        = 1 << 4,
     RESERVED_TYPE_PAGE_TABLE    = 1 << 5,
+    RESERVED_TYPE_PSTORE        = 1 << 6,
 } reserved_memory_type_t;
 
 // BIOS provided memory map entry structure
@@ -30,10 +31,6 @@ typedef struct {
     uint32_t reserved;  // Reserved for future use
 } __attribute__((packed)) e820_entry_t;
 
-// Exposed for parsing
-#define E820_MAP_ADDRESS    0x5000
-#define E820_MAP_COUNT_PTR  0x2004
-
 // Memory map structure for storing usable memory regions
 typedef struct {
     uint64_t base;          // Start address of the memory region
@@ -44,5 +41,7 @@ typedef struct {
 #define MAX_MEMORY_REGIONS 32
 
 extern void parse_and_print_e820_map(void);
+// E820 type of the region containing addr, 0 if no entry covers it
+extern uint32_t e820_lookup_type(uint64_t addr);
 extern memory_region_t usable_memory_region[MAX_MEMORY_REGIONS];
 extern uint16_t usable_memory_region_count;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Multiboot (v1) structures, enough to boot from `qemu -kernel` or GRUB.
+The header itself is in kernel_entry.asm.
+*/
+
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+
+// multiboot_info_t.flags
+#define MULTIBOOT_INFO_MEMORY       (1 << 0)    // mem_lower, mem_upper
+#define MULTIBOOT_INFO_BOOTDEV      (1 << 1)
+#define MULTIBOOT_INFO_CMDLINE      (1 << 2)
+#define MULTIBOOT_INFO_MEM_MAP      (1 << 6)
+#define MULTIBOOT_INFO_FRAMEBUFFER  (1 << 12)
+
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;         // KiB from 0
+    uint32_t mem_upper;         // KiB from 1MiB
+    uint32_t boot_device;       // Drive number in the top byte
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;       // Bytes
+    uint32_t mmap_addr;
+    uint32_t drives_length;
+    uint32_t drives_addr;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+    uint64_t framebuffer_addr;
+    uint32_t framebuffer_pitch;
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t  framebuffer_bpp;
+    uint8_t  framebuffer_type;
+} __attribute__((packed)) multiboot_info_t;
+
+// Memory map entry; `size` does not count itself
+typedef struct {
+    uint32_t size;
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;              // E820 type
+} __attribute__((packed)) multiboot_mmap_entry_t;
@@ -1,12 +1,10 @@
 #pragma once
 #include <stdint.h>
+#include "arch/x86/interrupt.h"
+#include "perf.h"
 
-typedef struct {
-    uint32_t ds;                                        // Data segment selector
-    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;    // Pushed by pusha
-    uint32_t int_no;                                    // Interrupt number
-    uint32_t error_code;                                // Error code pushed by CPU
-    uint32_t eip, cs, eflags, useresp, ss;              // Pushed by CPU on interrupt
-} page_fault_stack_t;
+// Hardware counts of the page faults that were resolved (see perf.h)
+extern struct perf_region page_fault_perf;
 
-void page_fault_handler(page_fault_stack_t* frame);
+// Registered for VECTOR_PAGE_FAULT by idt_init()
+void page_fault_handler(interrupt_frame_t* frame, void* ctx);
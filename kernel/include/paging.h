@@ -11,8 +11,18 @@
 #define PAGE_PRESENT    0x1
 #define PAGE_WRITE      0x2
 #define PAGE_USER       0x4
+#define PAGE_PWT        0x8     // Write-through
+#define PAGE_PCD        0x10    // Cache disable (device MMIO)
+
+// Flags for device registers: uncached, never combined or reordered
+#define PAGE_MMIO       (PAGE_PRESENT | PAGE_WRITE | PAGE_PWT | PAGE_PCD)
 
 void paging_init();
 // void page_fault_handler(); // do we need this ? dupplicate of page_fault.h
 void paging_map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags);
+// Remove a mapping; returns the physical frame it pointed to (0 if none)
+uint32_t paging_unmap_page(uint32_t virtual_addr);
+int paging_is_mapped(uint32_t virtual_addr);
+// Identity map every page touching [phys, phys + size) and return phys as a pointer
+void* paging_map_identity(uint32_t phys, uint32_t size, uint32_t flags);
 void debug_page_tables();
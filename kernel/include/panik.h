@@ -3,6 +3,9 @@
 
 #include "assert.h"
 
+// Bytes of the log ring flushed to the serial port on panik
+#define PANIK_LOG_DUMP_SIZE (4 * 1024)
+
 typedef enum {
 	PANIK_MODE_NORMAL,
 	PANIK_MODE_TEST
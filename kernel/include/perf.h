@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "smp.h"
+#include "arch/x86/pmu.h"
+
+/*
+Hardware counter regions.
+    A perf_region accumulates the PMU counts (arch/x86/pmu.h) of every run
+    between perf_begin() and perf_end(), per CPU, so one region can be
+    used on several CPUs at once:
+
+    static DEFINE_PERF_REGION(pf_perf, "page_fault");
+
+    perf_begin(&pf_perf);
+    ...
+    perf_end(&pf_perf);
+    perf_report(&pf_perf, CONSOLE_ALL);
+
+    A run must begin and end on the same CPU (interrupts off, or pinned)
+    and runs of one region must not nest on a CPU. Without a PMU both
+    calls return right away.
+
+The report gives per-run averages, instructions per cycle and misses per
+thousand instructions; the serial port gets a line of its own,
+    PERF name=<name> runs=<n> cycles=<c> instructions=<i> ipc=<x.yy> ...
+with only the counted events in it.
+*/
+
+struct perf_region_cpu {
+    uint32_t runs;
+    uint64_t start[PMU_NR_EVENTS];      // Counters at perf_begin()
+    uint64_t total[PMU_NR_EVENTS];      // Sum of the finished runs
+};
+
+struct perf_region {
+    const char *name;
+    struct perf_region_cpu cpu[NR_CPUS];
+};
+
+#define DEFINE_PERF_REGION(var, region_name) \
+    struct perf_region var = { .name = region_name }
+
+// Totals (or per-run averages, see perf_counts_per_run()) of a region
+struct perf_counts {
+    uint32_t runs;
+    uint64_t count[PMU_NR_EVENTS];
+};
+
+static inline void perf_begin(struct perf_region *region)
+{
+    if (pmu.events) {
+        pmu_read(region->cpu[smp_processor_id()].start);
+    }
+}
+
+static inline void perf_end(struct perf_region *region)
+{
+    if (!pmu.events) {
+        return;
+    }
+
+    struct perf_region_cpu *pc = &region->cpu[smp_processor_id()];
+    uint64_t now[PMU_NR_EVENTS];
+
+    pmu_read(now);
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        pc->total[ev] += (now[ev] - pc->start[ev]) & pmu.mask[ev];
+    }
+    pc->runs++;
+}
+
+void perf_region_reset(struct perf_region *region);
+
+// Sum of every CPU's runs
+void perf_region_sum(const struct perf_region *region, struct perf_counts *out);
+// Divide the counts by the number of runs
+void perf_counts_per_run(struct perf_counts *counts);
+
+// "cycles=.. instructions=.. ipc=x.yy llc_misses=.. ..." for the counted events
+int perf_snprint(char *buf, size_t size, const struct perf_counts *counts);
+
+// Per-run averages to the console, totals as a PERF line to the serial port
+void perf_report(const struct perf_region *region, int sinks);
@@ -15,9 +15,30 @@
 #define KERNEL_STACK_TOP_VIRT   0xC3000000
 #define KERNEL_STACK_BOTTOM_VIRT (KERNEL_STACK_TOP_VIRT - 0x10000) // 0xc2FF0000
 
+/*
+Deferred initialization.
+    pmm_init() only frees the usable frames below CONFIG_PMM_EAGER_MB (0 =
+    all of memory). pmm_start_deferred_init() brings the rest online in
+    PMM_ONLINE_CHUNK_FRAMES steps from a low priority thread. Allocating or
+    reserving memory that is not online yet brings it online on the spot.
+*/
+#ifndef CONFIG_PMM_EAGER_MB
+#define CONFIG_PMM_EAGER_MB     64
+#endif
+#define PMM_ONLINE_CHUNK_FRAMES 4096    // 16MiB
+
+// Where pmm_init() puts the frame bitmap (1 bit per frame, 128KiB for
+// 4GiB); the host build points it at a buffer of its own
+#ifndef PMM_BITMAP_ADDR
+#define PMM_BITMAP_ADDR         0x90000
+#endif
+
 // pmm - process memory management utilities
 void pmm_init(void);
+// Once the scheduler runs: bring the memory above CONFIG_PMM_EAGER_MB online
+void pmm_start_deferred_init(void);
 void pmm_reserve_memory_region(reserved_memory_type_t reserved_type);
 void pmm_set_frame_bitmap(uint32_t start_address, uint32_t end_address);
 void* pmm_alloc_frame(void);
-void pmm_free_frame(void* addr);
\ No newline at end of file
+void pmm_free_frame(void* addr);
+uint32_t pmm_used_frames(void);
\ No newline at end of file
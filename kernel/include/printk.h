@@ -7,12 +7,19 @@
 
 /**
  * Kernel print function - similar to printf but for kernel space
- * Supports basic format specifiers: %s, %c, %d, %x, %p
+ * Supports %s, %c, %d, %i, %u, %x, %X, %p with flags, width, precision
+ * and the l / ll / z length modifiers
  */
 
 // Maximum buffer size for each printk call output
 #define LOG_BUF_SIZE 1024
 
+// Size of the circular log ring that keeps the kernel message history
+#define LOG_RING_SIZE (16 * 1024)
+
+// Longest record handed out by the log readers (longer lines come in pieces)
+#define LOG_LINE_MAX 256
+
 // Log levels
 #define KERN_SOH        "\001"              // Start of Header for Log Messages
 #define KERN_EMERG      KERN_SOH    "0"     // Emergency messages
@@ -24,6 +31,34 @@
 #define KERN_INFO       KERN_SOH    "6"     // Informational messages
 #define KERN_DEBUG      KERN_SOH    "7"     // Debug messages
 
+// Numeric log levels (lower is more severe)
+#define LOGLEVEL_EMERG      0
+#define LOGLEVEL_ALERT      1
+#define LOGLEVEL_CRIT       2
+#define LOGLEVEL_ERR        3
+#define LOGLEVEL_WARNING    4
+#define LOGLEVEL_NOTICE     5
+#define LOGLEVEL_INFO       6
+#define LOGLEVEL_DEBUG      7
+
+// Level used for printk() calls without a KERN_* prefix
+#define LOGLEVEL_DEFAULT    LOGLEVEL_INFO
+
+/*
+Compile-time minimum log level.
+    pr_*() calls less severe than CONFIG_LOGLEVEL compile to nothing:
+    the format string is still type-checked but never formatted or stored.
+    Set from the Makefile (make CONFIG_LOGLEVEL=7 for a verbose build).
+*/
+#ifndef CONFIG_LOGLEVEL
+#define CONFIG_LOGLEVEL     LOGLEVEL_INFO
+#endif
+
+// Prefix each record in the log ring with its ktime_get_ns() time
+#ifndef CONFIG_PRINTK_TIME
+#define CONFIG_PRINTK_TIME  1
+#endif
+
 // Log level structure definition
 struct loglevel {
     char level_char;
@@ -38,24 +73,112 @@ extern const int num_loglevels;
 // Main printk function
 int printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
 
+// Evaluates to 0 without touching the arguments when level is compiled out
+#define printk_level(level, fmt, ...) \
+    ({ \
+        int _len = 0; \
+        if ((level) <= CONFIG_LOGLEVEL) \
+            _len = printk(fmt, ##__VA_ARGS__); \
+        _len; \
+    })
+
 // Convenience macros for different log levels
-#define pr_emerg(fmt, ...)    printk(KERN_EMERG fmt, ##__VA_ARGS__)
-#define pr_alert(fmt, ...)    printk(KERN_ALERT fmt, ##__VA_ARGS__)
-#define pr_crit(fmt, ...)     printk(KERN_CRIT fmt, ##__VA_ARGS__)
-#define pr_err(fmt, ...)      printk(KERN_ERR fmt, ##__VA_ARGS__)
-#define pr_warning(fmt, ...)  printk(KERN_WARNING fmt, ##__VA_ARGS__)
+#define pr_emerg(fmt, ...)    printk_level(LOGLEVEL_EMERG,   KERN_EMERG fmt, ##__VA_ARGS__)
+#define pr_alert(fmt, ...)    printk_level(LOGLEVEL_ALERT,   KERN_ALERT fmt, ##__VA_ARGS__)
+#define pr_crit(fmt, ...)     printk_level(LOGLEVEL_CRIT,    KERN_CRIT fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)      printk_level(LOGLEVEL_ERR,     KERN_ERR fmt, ##__VA_ARGS__)
+#define pr_warning(fmt, ...)  printk_level(LOGLEVEL_WARNING, KERN_WARNING fmt, ##__VA_ARGS__)
 #define pr_warn pr_warning
-#define pr_notice(fmt, ...)   printk(KERN_NOTICE fmt, ##__VA_ARGS__)
-#define pr_info(fmt, ...)     printk(KERN_INFO fmt, ##__VA_ARGS__)
-#define pr_debug(fmt, ...)    printk(KERN_DEBUG fmt, ##__VA_ARGS__)
+#define pr_notice(fmt, ...)   printk_level(LOGLEVEL_NOTICE,  KERN_NOTICE fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)     printk_level(LOGLEVEL_INFO,    KERN_INFO fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...)    printk_level(LOGLEVEL_DEBUG,   KERN_DEBUG fmt, ##__VA_ARGS__)
+
+/*
+Runtime console level.
+    Messages with level <= console loglevel are rendered to the console,
+    everything else only goes to the ring buffer.
+    Defaults to CONFIG_LOGLEVEL, so debug builds keep pr_debug in the log
+    but can silence the (slow) console with printk_set_console_loglevel().
+*/
+void printk_set_console_loglevel(int level);
+int printk_get_console_loglevel(void);
+
+// Console sinks (CONSOLE_* in console.h): VGA by default, VGA and serial
+// in headless test runs so the whole log reaches the host
+void printk_set_console_sinks(int sinks);
+
+/*
+Rate limiting.
+    At most `burst` messages per `interval` nanoseconds are let through,
+    the rest are counted and reported as "N callbacks suppressed" once the
+    next interval opens.
+*/
+struct ratelimit_state {
+    uint64_t interval;      // Window length in ns
+    uint32_t burst;         // Messages allowed per window
+    uint32_t printed;       // Messages let through in the current window
+    uint32_t missed;        // Messages dropped in the current window
+    uint64_t begin;         // ktime_get_ns() at the start of the current window
+};
+
+// 1s; until the clock is calibrated ktime is 0 and only the burst applies
+#define DEFAULT_RATELIMIT_INTERVAL  (1000ULL * 1000 * 1000)
+#define DEFAULT_RATELIMIT_BURST     10
+
+#define RATELIMIT_STATE_INIT(interval_init, burst_init) \
+    { .interval = (interval_init), .burst = (burst_init), .printed = 0, .missed = 0, .begin = 0 }
+
+// Returns 1 if the caller may print, 0 if the message should be dropped
+int printk_ratelimit_ok(struct ratelimit_state *rs);
+
+// One ratelimit_state per call site
+#define printk_ratelimited(fmt, ...) \
+    ({ \
+        static struct ratelimit_state _rs = \
+            RATELIMIT_STATE_INIT(DEFAULT_RATELIMIT_INTERVAL, DEFAULT_RATELIMIT_BURST); \
+        printk_ratelimit_ok(&_rs) ? printk(fmt, ##__VA_ARGS__) : 0; \
+    })
+
+#define printk_level_ratelimited(level, fmt, ...) \
+    ({ \
+        int _len_rl = 0; \
+        if ((level) <= CONFIG_LOGLEVEL) \
+            _len_rl = printk_ratelimited(fmt, ##__VA_ARGS__); \
+        _len_rl; \
+    })
+
+#define pr_err_ratelimited(fmt, ...)    printk_level_ratelimited(LOGLEVEL_ERR,     KERN_ERR fmt, ##__VA_ARGS__)
+#define pr_warn_ratelimited(fmt, ...)   printk_level_ratelimited(LOGLEVEL_WARNING, KERN_WARNING fmt, ##__VA_ARGS__)
+#define pr_info_ratelimited(fmt, ...)   printk_level_ratelimited(LOGLEVEL_INFO,    KERN_INFO fmt, ##__VA_ARGS__)
+#define pr_debug_ratelimited(fmt, ...)  printk_level_ratelimited(LOGLEVEL_DEBUG,   KERN_DEBUG fmt, ##__VA_ARGS__)
 
 // Initialize printk subsystem
 void printk_init(void);
 
 // Internal formatting function (used by panik.c)
 int my_vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+int my_snprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
 
 // Ring buffer write function (used by panik.c)
 void ringbuf_write(const char* str, size_t str_len);
 
+/*
+Log ring readers.
+    Records are the '\n' terminated lines stored in the ring. An iterator
+    snapshots the range between rb_tail and rb_head when it is initialized.
+*/
+struct log_iter {
+    size_t pos;         // Ring index of the next byte to read
+    size_t remaining;   // Bytes left in the snapshotted range
+};
+
+size_t log_buffer_used(void);
+void log_iter_init(struct log_iter *it);
+void log_iter_init_tail(struct log_iter *it, size_t max_bytes);
+size_t log_iter_next(struct log_iter *it, char *buf, size_t size);
+
+// Replay the log to CONSOLE_VGA and/or CONSOLE_SERIAL
+void dmesg(int sinks);
+void dmesg_tail(int sinks, size_t max_bytes);
+
 #endif /* KERNEL_PRINTK_H */
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include "smp.h"
+
+/*
+Sampling profiler.
+    A per-CPU timer on the timer wheel fires at the sampling rate and
+    records where its interrupt landed: the interrupted EIP and, with
+    PROFILE_CALLCHAIN, the callers found by walking the interrupted EBP
+    chain (backtrace.h). interrupt_dispatch() keeps the frame of the
+    interrupt being handled, so the timer callback sees the code that was
+    running, not the timer code.
+
+    Samples go into a fixed per-CPU buffer; once it is full further samples
+    are counted as dropped. Code that runs with interrupts disabled is
+    never sampled, its time is charged to whatever enables them again.
+
+    The wheel has a granularity of ~1ms (timer.h), so rates above
+    PROFILE_MAX_HZ are clamped. CPUs without a timer wheel of their own
+    (PIT tick device, see clock_init_cpu()) are not sampled.
+
+profile_dump() prints the buffers in the folded-stack format of
+flamegraph.pl, root first and one line per distinct stack, each prefixed
+with "PROFILE " so they can be pulled out of the serial log:
+
+    PROFILE cpu0;kernel_main;run_kernel_tests;busy_loop 37
+
+    sed -n 's/^PROFILE //p' serial.log | flamegraph.pl > kernel.svg
+
+Build with CONFIG_PROFILE_HZ=<rate> to profile the test and benchmark runs
+(kernel_main starts the profiler before them and dumps after).
+*/
+
+#ifndef CONFIG_PROFILE_HZ
+#define CONFIG_PROFILE_HZ       0
+#endif
+
+// Samples kept per CPU
+#define PROFILE_SAMPLES         1024
+// Interrupted EIP plus callers
+#define PROFILE_MAX_DEPTH       8
+#define PROFILE_MAX_HZ          500
+
+// profile_start() flags
+#define PROFILE_CALLCHAIN       (1 << 0)    // Walk the interrupted stack
+
+struct profile_sample {
+    uint32_t depth;                     // Valid entries in pc[]
+    uint32_t pc[PROFILE_MAX_DEPTH];     // pc[0] = interrupted EIP, then return addresses
+};
+
+struct profile_buffer {
+    uint32_t count;                     // Samples recorded
+    uint32_t dropped;                   // Samples lost to a full buffer
+    struct profile_sample samples[PROFILE_SAMPLES];
+};
+
+extern struct profile_buffer profile_buffers[NR_CPUS];
+
+// Start sampling every CPU that has a timer wheel at `hz`; samples add
+// to the ones already buffered
+void profile_start(uint32_t hz, uint32_t flags);
+// Stop sampling; each CPU's timer lapses at its next expiry
+void profile_stop(void);
+// Drop all samples
+void profile_reset(void);
+
+// Print every CPU's samples as folded stacks to the CONSOLE_* sinks
+void profile_dump(int sinks);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Persistent crash store.
+    A reserved physical region that survives a warm reboot (QEMU and most
+    BIOSes do not clear RAM on reset or triple fault). panik() and the
+    double fault handler write a checksummed crash record into it: reason,
+    message, registers, a raw backtrace and the tail of the printk ring.
+    The next boot validates the record and prints it, the backtrace
+    symbolized with its own symbol table (ksyms.h): after a rebuild the
+    names may be off, the raw addresses are printed as well.
+
+    The region sits below 1MiB, clear of the kernel image, page tables
+    (0x80000) and the frame bitmap (0x90000).
+*/
+
+#define PSTORE_ADDR         0x70000
+#define PSTORE_SIZE         0x4000          // 16 KiB
+
+#define PSTORE_MAGIC        0x50535452      // "PSTR": valid, not yet reported
+#define PSTORE_MAGIC_SEEN   0x50535444      // Record was reported by a later boot
+#define PSTORE_VERSION      1
+
+#define PSTORE_BT_MAX       16
+#define PSTORE_MSG_SIZE     128
+
+typedef enum {
+    PSTORE_REASON_PANIK         = 1,
+    PSTORE_REASON_DOUBLE_FAULT  = 2,
+} pstore_reason_t;
+
+struct pstore_regs {
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t esi, edi, ebp, esp;
+    uint32_t eip, eflags;
+    uint32_t cs, ds, ss;
+    uint32_t cr0, cr2, cr3;
+};
+
+struct pstore_record {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                          // Bytes covered by the checksum
+    uint32_t checksum;                      // FNV-1a over the record with this field zeroed
+    uint32_t reason;                        // pstore_reason_t
+    uint32_t crash_count;                   // Crashes recorded since the region was first formatted
+    struct pstore_regs regs;
+    uint32_t bt_depth;
+    uint32_t backtrace[PSTORE_BT_MAX];      // Return addresses, innermost first
+    char message[PSTORE_MSG_SIZE];
+    uint32_t log_len;
+    char log[];                             // Tail of the printk ring
+};
+
+#define PSTORE_LOG_SIZE     (PSTORE_SIZE - sizeof(struct pstore_record))
+
+// Called early at boot: report a crash record left by the previous boot
+void pstore_init(void);
+
+// Record a crash. regs may be NULL to snapshot the caller's registers.
+void pstore_save(pstore_reason_t reason, const char *message, const struct pstore_regs *regs);
+
+// Called from the double fault task; the faulting state is in tss_main
+void pstore_save_double_fault(void);
+
+// Print the stored record (if valid) to CONSOLE_* sinks
+void pstore_dump(int sinks);
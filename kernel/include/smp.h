@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// Maximum number of CPUs the kernel keeps per-CPU state for
+#define NR_CPUS 4
+
+struct task;
+
+/*
+Per-CPU area.
+    Every CPU has its own GDT with a data segment (GDT_PERCPU_SEL) whose base
+    is that CPU's cpu_data entry, loaded in %fs. A %fs-relative load then
+    reaches the local copy in one instruction, with no APIC ID lookup and no
+    risk of being migrated between reading the ID and using it.
+
+The first fields are read from assembly by offset; keep them in place.
+*/
+struct cpu_data {
+    struct cpu_data *self;      // Linear address of this block (offset 0)
+    int cpu_id;                 // Logical CPU number, 0 = boot CPU (offset 4)
+    struct task *current;       // Task running on this CPU (offset 8)
+    volatile int need_resched;  // Switch away at the next interrupt exit (offset 12)
+    uint32_t apic_id;
+    volatile int online;        // Set by the CPU once it runs kernel code
+    struct task *idle;          // Task running when nothing else is
+};
+
+#define PERCPU_SELF_OFFSET      0
+#define PERCPU_CPU_ID_OFFSET    4
+#define PERCPU_CURRENT_OFFSET   8
+#define PERCPU_NEED_RESCHED_OFFSET 12
+
+extern struct cpu_data cpu_data[NR_CPUS];
+
+#ifdef KERNEL_HOST
+// Host build (kernel/tests/host): one thread plays CPU 0
+static inline int smp_processor_id(void) { return 0; }
+static inline struct cpu_data* this_cpu(void) { return &cpu_data[0]; }
+#else
+// Index of the CPU we are running on
+static inline int smp_processor_id(void)
+{
+    int cpu;
+    __asm__ __volatile__("movl %%fs:%c1, %0" : "=r"(cpu) : "i"(PERCPU_CPU_ID_OFFSET));
+    return cpu;
+}
+
+static inline struct cpu_data* this_cpu(void)
+{
+    struct cpu_data *self;
+    __asm__ __volatile__("movl %%fs:%c1, %0" : "=r"(self) : "i"(PERCPU_SELF_OFFSET));
+    return self;
+}
+#endif
+
+// Number of CPUs that came online (boot CPU included)
+int smp_num_cpus(void);
+
+// Per-CPU GDT, TSS and %fs for the boot CPU; must run before anything
+// calls smp_processor_id()
+void smp_prepare_boot_cpu(void);
+
+// Start every application processor listed in the ACPI MADT
+void smp_boot_aps(void);
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "arch/x86/cpu.h"
+#include "arch/x86/interrupt.h"
+
+/*
+Spinning locks.
+    - spinlock_t: test-and-test-and-set. Cheapest when uncontended, but
+      unfair: a releasing CPU can take it straight back.
+    - ticket_lock_t: FIFO. Each CPU draws a ticket and waits for its turn,
+      still spinning on the one shared word.
+    - mcs_lock_t: FIFO queue lock. Every waiter spins on a node of its own
+      (usually on its stack), so a contended lock does not bounce one cache
+      line between all waiting CPUs.
+
+None of them disables preemption. Data also touched from interrupt handlers
+must use the _irqsave variants, which keep the holder on its CPU as well;
+a plain lock is for data that interrupts never see.
+
+Lock statistics.
+    With CONFIG_LOCK_STAT=1 every lock counts its acquisitions, how many of
+    them had to wait, and the TSC cycles spent waiting. A lock joins the
+    list printed by lock_stat_dump() the first time it is taken. The
+    counters are only written by the holder, so they need no atomics.
+*/
+
+#ifndef CONFIG_LOCK_STAT
+#define CONFIG_LOCK_STAT    0
+#endif
+
+struct lock_stat {
+    const char *name;
+    uint32_t acquisitions;
+    uint32_t contended;         // Acquisitions that had to wait
+    uint64_t spin_cycles;       // rdtsc cycles spent waiting
+    struct lock_stat *next;     // lock_stat_dump() list
+    int registered;
+};
+
+#if CONFIG_LOCK_STAT
+#define LOCK_STAT_MEMBER        struct lock_stat stat;
+#define LOCK_STAT_INIT(n)       , .stat = { .name = (n) }
+#define LOCK_STAT(lock)         (&(lock)->stat)
+#else
+#define LOCK_STAT_MEMBER
+#define LOCK_STAT_INIT(n)
+#define LOCK_STAT(lock)         ((struct lock_stat*)NULL)
+#endif
+
+// Add a lock to the lock_stat_dump() list (spinlock.c)
+void lock_stat_register(struct lock_stat *stat);
+// Print the counters of every lock taken so far, one line each
+void lock_stat_dump(void);
+// Zero the counters of every registered lock
+void lock_stat_reset(void);
+
+static inline uint64_t lock_stat_wait_start(void)
+{
+#if CONFIG_LOCK_STAT
+    return rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Called by the new holder; wait_start is 0 if it got the lock at once
+static inline void lock_stat_acquired(struct lock_stat *stat, uint64_t wait_start)
+{
+#if CONFIG_LOCK_STAT
+    if (!stat->registered) {
+        lock_stat_register(stat);
+    }
+    stat->acquisitions++;
+    if (wait_start) {
+        stat->contended++;
+        stat->spin_cycles += rdtsc() - wait_start;
+    }
+#else
+    (void)stat;
+    (void)wait_start;
+#endif
+}
+
+/*
+spinlock_t
+*/
+typedef struct {
+    volatile uint32_t locked;
+    LOCK_STAT_MEMBER
+} spinlock_t;
+
+#define SPINLOCK_INIT(name)     { .locked = 0 LOCK_STAT_INIT(name) }
+#define DEFINE_SPINLOCK(var)    spinlock_t var = SPINLOCK_INIT(#var)
+
+static inline int spin_trylock(spinlock_t *lock)
+{
+    if (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    lock_stat_acquired(LOCK_STAT(lock), 0);
+    return 1;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+    if (!__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        lock_stat_acquired(LOCK_STAT(lock), 0);
+        return;
+    }
+
+    // Wait with plain reads; only retry the exchange once it looks free
+    uint64_t start = lock_stat_wait_start();
+    do {
+        while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED)) {
+            cpu_relax();
+        }
+    } while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE));
+    lock_stat_acquired(LOCK_STAT(lock), start);
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t *lock)
+{
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+/*
+ticket_lock_t
+*/
+typedef struct {
+    volatile uint32_t next;     // Ticket the next CPU to arrive draws
+    volatile uint32_t owner;    // Ticket being served
+    LOCK_STAT_MEMBER
+} ticket_lock_t;
+
+#define TICKET_LOCK_INIT(name)  { .next = 0, .owner = 0 LOCK_STAT_INIT(name) }
+#define DEFINE_TICKET_LOCK(var) ticket_lock_t var = TICKET_LOCK_INIT(#var)
+
+static inline void ticket_lock(ticket_lock_t *lock)
+{
+    uint32_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+
+    if (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) == ticket) {
+        lock_stat_acquired(LOCK_STAT(lock), 0);
+        return;
+    }
+
+    uint64_t start = lock_stat_wait_start();
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        cpu_relax();
+    }
+    lock_stat_acquired(LOCK_STAT(lock), start);
+}
+
+static inline void ticket_unlock(ticket_lock_t *lock)
+{
+    // Only the holder writes owner
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+static inline int ticket_is_locked(ticket_lock_t *lock)
+{
+    return __atomic_load_n(&lock->owner, __ATOMIC_RELAXED) !=
+           __atomic_load_n(&lock->next, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t ticket_lock_irqsave(ticket_lock_t *lock)
+{
+    uint32_t flags = irq_save();
+    ticket_lock(lock);
+    return flags;
+}
+
+static inline void ticket_unlock_irqrestore(ticket_lock_t *lock, uint32_t flags)
+{
+    ticket_unlock(lock);
+    irq_restore(flags);
+}
+
+/*
+mcs_lock_t
+    The lock is the tail of a queue of waiters. A CPU appends its node and
+    spins on node->locked until its predecessor hands the lock over by
+    clearing it. The node must stay valid until mcs_unlock() returns.
+*/
+struct mcs_node {
+    struct mcs_node *volatile next;
+    volatile int locked;
+};
+
+typedef struct {
+    struct mcs_node *tail;      // Last waiter, NULL when free
+    LOCK_STAT_MEMBER
+} mcs_lock_t;
+
+#define MCS_LOCK_INIT(name)     { .tail = NULL LOCK_STAT_INIT(name) }
+#define DEFINE_MCS_LOCK(var)    mcs_lock_t var = MCS_LOCK_INIT(#var)
+
+static inline void mcs_lock(mcs_lock_t *lock, struct mcs_node *node)
+{
+    node->next = NULL;
+    node->locked = 1;
+
+    struct mcs_node *prev = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+    if (!prev) {
+        lock_stat_acquired(LOCK_STAT(lock), 0);
+        return;
+    }
+
+    uint64_t start = lock_stat_wait_start();
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+        cpu_relax();
+    }
+    lock_stat_acquired(LOCK_STAT(lock), start);
+}
+
+static inline void mcs_unlock(mcs_lock_t *lock, struct mcs_node *node)
+{
+    struct mcs_node *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+
+    if (!next) {
+        // Nobody queued behind us: free the lock
+        struct mcs_node *expected = node;
+        if (__atomic_compare_exchange_n(&lock->tail, &expected, NULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        // A waiter swapped itself in but has not linked up yet
+        while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+            cpu_relax();
+        }
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t mcs_lock_irqsave(mcs_lock_t *lock, struct mcs_node *node)
+{
+    uint32_t flags = irq_save();
+    mcs_lock(lock, node);
+    return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t *lock, struct mcs_node *node, uint32_t flags)
+{
+    mcs_unlock(lock, node);
+    irq_restore(flags);
+}
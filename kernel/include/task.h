@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pmm.h"
+#include "smp.h"
+#include "clock.h"
+#include "arch/x86/interrupt.h"
+
+/*
+Kernel threads.
+    A task is a kernel thread: its own stack plus the registers saved when it
+    was switched out. Switching is done by switch_to() (switch_to.asm), which
+    pushes the callee-saved registers on the old stack, stores esp in the old
+    task, loads the new task's esp and pops the same registers back. The
+    caller-saved registers are already saved by the C calling convention.
+
+Tasks live in a fixed table; task 0 is the boot thread (running on the
+KERNEL_STACK_* stack), the others get a stack slot below it. Every CPU also
+has an idle task, which runs when nothing else is runnable there and is
+never queued.
+*/
+
+#ifndef CONFIG_MAX_TASKS
+#define CONFIG_MAX_TASKS        64
+#endif
+
+#define TASK_NAME_LEN           16
+
+/*
+Priorities: 0 is the most urgent, MAX_PRIO - 1 the least. One bit per level
+fits the run queue bitmap in a single word, so picking the next task is one
+`bsf`.
+*/
+#define MAX_PRIO                32
+#define DEFAULT_PRIO            16
+#define IDLE_PRIO               (MAX_PRIO - 1)
+
+// CPU time a task may use before an equal-priority task gets a turn
+#define SCHED_TIMESLICE_NS      (10 * NSEC_PER_MSEC)
+
+// A task that ran this recently still has its working set in the old
+// CPU's caches; idle CPUs leave it where it is instead of stealing it
+#define SCHED_MIGRATION_COST_NS (500 * NSEC_PER_USEC)
+
+#define CPU_MASK_ALL            ((1u << NR_CPUS) - 1)
+
+/*
+Thread stacks: CONFIG_MAX_TASKS fixed slots right below the boot stack.
+Each slot is an unmapped guard page followed by KTHREAD_STACK_SIZE of
+stack, so an overflow faults instead of running into the next thread.
+Pages are mapped when the thread is created and freed when it is reaped.
+*/
+#define KTHREAD_STACK_SIZE      0x4000
+#define KTHREAD_STACK_SLOT      (KTHREAD_STACK_SIZE + PAGE_SIZE)
+#define KTHREAD_STACK_AREA_TOP  KERNEL_STACK_BOTTOM_VIRT
+#define KTHREAD_STACK_AREA_BOTTOM (KTHREAD_STACK_AREA_TOP - CONFIG_MAX_TASKS * KTHREAD_STACK_SLOT)
+
+typedef enum {
+    TASK_UNUSED = 0,
+    TASK_RUNNING,       // On a CPU
+    TASK_READY,         // On a run queue
+    TASK_BLOCKED,       // Waiting for task_wake()
+    TASK_DEAD,          // Exited, stack freed by the next task to run
+} task_state_t;
+
+// Frame switch_to() leaves on a switched-out stack (lowest address first)
+struct task_context {
+    uint32_t edi;
+    uint32_t esi;
+    uint32_t ebx;
+    uint32_t ebp;
+    uint32_t eip;       // Return address into schedule() (or kthread_start)
+};
+
+struct task {
+    uint32_t esp;       // Saved stack pointer, must stay first (switch_to.asm)
+    int tid;
+    task_state_t state;
+    int prio;
+    int preempt_count;  // > 0: not preempted from interrupt exit
+    uint64_t time_slice_ns; // Left of the current slice
+    char name[TASK_NAME_LEN];
+
+    uint32_t stack_bottom;  // Lowest mapped stack byte (0 for the boot thread)
+    uint32_t stack_top;
+
+    void (*fn)(void *arg);
+    void *arg;
+
+    struct task *next;  // Remote wakeup list link
+
+    int cpu;                // CPU it last ran on, where wakeups queue it
+    uint32_t allowed_cpus;  // Bit per CPU it may run on
+    volatile int on_cpu;    // Running, or switched out but still on its stack
+    int migrate_disable;    // > 0: only its own CPU may pick it up
+    int queued_prio;        // Run queue level it was pushed on
+
+    uint64_t exec_start;    // ktime when last switched in
+    uint64_t last_ran;      // ktime when last switched out
+    uint64_t runtime_ns;    // Total time on a CPU
+    uint32_t nr_switches;   // Times switched in
+    uint32_t nr_migrations; // Times picked up by another CPU
+};
+
+extern struct task tasks[CONFIG_MAX_TASKS];
+
+// One %fs load: cannot be migrated between finding the CPU and reading it
+static inline struct task* get_current(void)
+{
+    struct task *cur;
+    __asm__ __volatile__("movl %%fs:%c1, %0" : "=r"(cur) : "i"(PERCPU_CURRENT_OFFSET));
+    return cur;
+}
+
+// Adopt the running boot thread as task 0
+void task_init(void);
+
+// Create a kernel thread running fn(arg); it is runnable right away, on
+// any CPU. Returns NULL when the task table or memory is exhausted.
+struct task* kthread_create(void (*fn)(void *arg), void *arg, const char *name);
+// Same, but the thread only ever runs on `cpu`; NULL if `cpu` does not
+// run tasks (sched_cpu_active())
+struct task* kthread_create_on_cpu(void (*fn)(void *arg), void *arg, const char *name, int cpu);
+
+// Idle task of a CPU: runs sched_idle(), never queued, lowest priority.
+// Application processors start on its stack.
+struct task* task_create_idle(int cpu);
+
+// Terminate the calling thread (also what returning from fn does)
+void kthread_exit(void) __attribute__((noreturn));
+
+// Task owning the stack guard page containing addr, NULL if none
+struct task* task_stack_guard_owner(uint32_t addr);
+
+int task_count(void);
+
+// Scheduler hooks used by task.c and smp.c (sched.c)
+void sched_init(void);
+// Let this CPU run and steal tasks; needs its timer wheel running
+void sched_init_cpu(void);
+// Body of every idle task
+void sched_idle(void *arg) __attribute__((noreturn));
+void finish_task_switch(struct task *prev);
+void task_free(struct task *t);
+// Drop this CPU's TLB entries for t's stack if its slot was remapped
+void task_sync_stack_tlb(struct task *t);
+
+// Let other runnable tasks run; returns when this task is picked again
+void yield(void);
+// Give up the CPU; the current task is requeued only if still TASK_RUNNING.
+// To sleep, set current->state = TASK_BLOCKED first.
+void schedule(void);
+// Make a blocked task runnable; preempts the caller if t is more urgent
+void task_wake(struct task *t);
+// Change priority; takes effect immediately, also for a queued task
+void sched_set_prio(struct task *t, int prio);
+// Block the calling task for at least ms milliseconds
+void msleep(uint32_t ms);
+
+/*
+Preemption.
+    A timer interrupt (slice expired) or a wakeup of a more urgent task sets
+    the need_resched flag in the CPU's cpu_data. isr_common tests this CPU's
+    flag through %fs on every interrupt exit and only then calls
+    preempt_schedule_irq(), which switches away unless the interrupted code
+    had interrupts off or preemption disabled.
+*/
+static inline void set_need_resched(void)
+{
+    __asm__ __volatile__("movl $1, %%fs:%c0" : : "i"(PERCPU_NEED_RESCHED_OFFSET) : "memory");
+}
+
+// Ask another CPU to reschedule; it notices at its next interrupt exit
+static inline void set_need_resched_cpu(int cpu)
+{
+    __atomic_store_n(&cpu_data[cpu].need_resched, 1, __ATOMIC_RELEASE);
+}
+
+static inline int need_resched(void)
+{
+    int flag;
+    __asm__ __volatile__("movl %%fs:%c1, %0" : "=r"(flag) : "i"(PERCPU_NEED_RESCHED_OFFSET));
+    return flag;
+}
+
+void preempt_schedule_irq(interrupt_frame_t *frame);
+// Involuntary switches on this CPU so far
+uint32_t sched_nr_preemptions(void);
+// Tasks this CPU took from other CPUs' run queues so far
+uint32_t sched_nr_steals(int cpu);
+// Whether `cpu` runs tasks (APs without a local timer only idle)
+int sched_cpu_active(int cpu);
+
+// Keep the current task on this CPU until the matching preempt_enable()
+static inline void preempt_disable(void)
+{
+    get_current()->preempt_count++;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+static inline void preempt_enable(void)
+{
+    __asm__ __volatile__("" ::: "memory");
+    if (--get_current()->preempt_count == 0 && need_resched()) {
+        schedule();
+    }
+}
+
+// Low level switch (switch_to.asm). Returns the task that was switched
+// away from to get back here.
+struct task* switch_to(struct task *prev, struct task *next);
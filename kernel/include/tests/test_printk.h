@@ -2,3 +2,5 @@
 
 void run_printk_tests(void);
 void run_printk_scrolling_test(void);
+void run_vsnprintf_tests(void);
+void run_log_reader_tests(void);
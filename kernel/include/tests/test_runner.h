@@ -0,0 +1,56 @@
+#pragma once
+
+#include "printk.h"
+
+/*
+Kernel test runner (make test, make test-headless).
+    run_kernel_tests() runs every suite in order and reports each one on
+    the serial port as
+        TEST name=<suite> result=PASS|FAIL failures=<n> us=<time>
+    followed by
+        TEST done passed=<suites> failed=<suites>
+    A suite fails if any of its checks called test_fail(). Suites check
+    with TEST_EXPECT(), the runner counts the checks of each suite.
+*/
+
+// Called by every check
+void test_check(void);
+// Called by every failed check ("[FAIL]")
+void test_fail(void);
+
+#define TEST_EXPECT(condition, message) \
+    do { \
+        test_check(); \
+        if (condition) { \
+            pr_info("[PASS] %s\n", message); \
+        } else { \
+            pr_err("[FAIL] %s\n", message); \
+            test_fail(); \
+        } \
+    } while (0)
+
+// String helpers for checks (no libc in the kernel)
+static inline int test_str_equal(const char *a, const char *b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static inline int test_str_ends_with(const char *s, const char *suffix)
+{
+    const char *a = s, *b = suffix;
+    while (*a) a++;
+    while (*b) b++;
+    while (b > suffix) {
+        if (a == s || *--a != *--b) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Run all suites; returns the number of suites that failed
+int run_kernel_tests(void);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Tickless timer wheel.
+    Timers are kept in a hierarchical, non-cascading wheel: TIMER_LVL_DEPTH
+    levels of TIMER_LVL_SIZE buckets, each level 8x coarser than the one
+    below. A timer goes straight into the level whose range covers its
+    timeout and is never moved again, so add and delete are O(1) list
+    operations. Each level has a bitmap of non-empty buckets; the earliest
+    expiry is found with a bit scan per level.
+
+    The wheel counts in units of 2^TIMER_CLK_SHIFT ns (~1.05 ms). There is
+    no periodic tick: the one-shot clock event device is programmed to the
+    earliest bucket only, and stays silent while no timer is pending.
+
+Precision: a timer never fires early. It can fire up to one bucket late,
+which is 1 unit at level 0 and 8^lvl units further up (about 12% of the
+timeout). That is fine for timeouts, which are usually cancelled anyway.
+
+Callbacks run in interrupt context with interrupts disabled and may re-add
+their own timer.
+*/
+
+#define TIMER_CLK_SHIFT         20
+#define TIMER_LVL_CLK_SHIFT     3
+#define TIMER_LVL_CLK_DIV       (1 << TIMER_LVL_CLK_SHIFT)
+#define TIMER_LVL_CLK_MASK      (TIMER_LVL_CLK_DIV - 1)
+#define TIMER_LVL_BITS          6
+#define TIMER_LVL_SIZE          (1 << TIMER_LVL_BITS)
+#define TIMER_LVL_MASK          (TIMER_LVL_SIZE - 1)
+#define TIMER_LVL_DEPTH         6
+#define TIMER_WHEEL_SIZE        (TIMER_LVL_SIZE * TIMER_LVL_DEPTH)
+
+#define TIMER_LVL_SHIFT(n)      ((n) * TIMER_LVL_CLK_SHIFT)
+#define TIMER_LVL_GRAN(n)       (1ULL << TIMER_LVL_SHIFT(n))
+#define TIMER_LVL_OFFS(n)       ((n) * TIMER_LVL_SIZE)
+// First delta (in units) that no longer fits level n - 1
+#define TIMER_LVL_START(n)      ((uint64_t)(TIMER_LVL_SIZE - 1) << (((n) - 1) * TIMER_LVL_CLK_SHIFT))
+
+// Longer timeouts are clamped (~35 minutes)
+#define TIMER_WHEEL_CUTOFF      TIMER_LVL_START(TIMER_LVL_DEPTH)
+#define TIMER_WHEEL_MAX         (TIMER_WHEEL_CUTOFF - TIMER_LVL_GRAN(TIMER_LVL_DEPTH - 1))
+
+#define TIMER_NEVER             UINT64_MAX
+
+struct timer_list {
+    struct timer_list *next;
+    struct timer_list **pprev;  // NULL when not pending
+    uint64_t expires;           // Absolute ktime_get_ns()
+    void (*fn)(struct timer_list *timer);
+    void *data;
+    uint16_t idx;               // Wheel bucket while pending
+};
+
+struct timer_stats {
+    uint32_t interrupts;        // Timer interrupts taken
+    uint32_t expired;           // Callbacks run
+    uint32_t early_wakeups;     // Interrupts that found nothing due
+};
+
+extern struct timer_stats timer_stats[];
+
+// Reset the wheel of this CPU; run before its clock event device is armed
+void timer_init(void);
+
+void timer_setup(struct timer_list *timer, void (*fn)(struct timer_list *), void *data);
+
+// Arm an idle timer for timer->expires
+void timer_add(struct timer_list *timer);
+// (Re)arm for `expires`; returns 1 if the timer was pending
+int timer_mod(struct timer_list *timer, uint64_t expires);
+// Returns 1 if the timer was pending
+int timer_del(struct timer_list *timer);
+
+static inline int timer_pending(const struct timer_list *timer)
+{
+    return timer->pprev != NULL;
+}
+
+// ktime of the earliest pending bucket, TIMER_NEVER if none
+uint64_t timer_next_expiry(void);
+
+// Called from the clock event interrupt: run due timers, reprogram
+void timer_interrupt(void);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "smp.h"
+#include "arch/x86/cpu.h"
+
+/*
+Binary (deferred-format) trace buffer.
+    trace_event() stores only the format string pointer, a TSC timestamp
+    and up to four raw 32-bit arguments in a per-CPU ring. Nothing is
+    formatted on the hot path; trace_dump() runs the records through
+    my_vsnprintf later.
+
+    The format string is the event id, so it must be a string literal (or
+    otherwise live forever). Arguments are stored as 32-bit values: use
+    %x/%u/%d/%p/%c, and %s only for strings that outlive the dump.
+
+    panik() and the kernel test run dump the rings to the serial port.
+
+Example:
+    trace_event("pf addr=0x%x err=%x", fault_address, error_code);
+*/
+
+// Number of records per CPU (power of two)
+#define TRACE_RING_ENTRIES  256
+
+#define TRACE_MAX_ARGS      4
+
+struct trace_record {
+    uint64_t tsc;                       // rdtsc at the time of the event
+    const char *fmt;                    // Format string / event id
+    uint32_t args[TRACE_MAX_ARGS];      // Raw arguments
+} __attribute__((aligned(32)));
+
+struct trace_ring {
+    uint32_t head;                      // Total records written (next slot = head % entries)
+    struct trace_record rec[TRACE_RING_ENTRIES];
+};
+
+extern struct trace_ring trace_rings[NR_CPUS];
+extern volatile int trace_enabled;
+
+// Hot path: reserve a slot with one atomic add, then fill it in
+static inline void __trace_record(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    if (!trace_enabled) {
+        return;
+    }
+
+    struct trace_ring *ring = &trace_rings[smp_processor_id()];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) & (TRACE_RING_ENTRIES - 1);
+    struct trace_record *rec = &ring->rec[slot];
+
+    rec->fmt = 0;                       // Invalidate while the slot is rewritten
+    rec->tsc = rdtsc();
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+    __atomic_store_n(&rec->fmt, fmt, __ATOMIC_RELEASE);
+}
+
+// Pads the argument list with zeros so 0..4 arguments can be passed
+#define __TRACE_ARGS(_skip, a0, a1, a2, a3, ...) \
+    (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3)
+
+#define trace_event(fmt, ...) \
+    __trace_record(fmt, __TRACE_ARGS(0, ##__VA_ARGS__, 0, 0, 0, 0))
+
+// Control and dump APIs
+void trace_start(void);
+void trace_stop(void);
+void trace_reset(void);
+
+// Format and print the last records of every CPU ring to the given sinks (CONSOLE_*)
+void trace_dump(int sinks);
+// Format one record's message (no timestamp) the way trace_dump() prints it
+int trace_format(char *buf, size_t size, const struct trace_record *rec);
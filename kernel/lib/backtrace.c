@@ -0,0 +1,110 @@
+#include "backtrace.h"
+#include "ksyms.h"
+#include "printk.h"
+#include "console.h"
+#include "pmm.h"
+#include "task.h"
+#include "drivers/vga.h"
+
+// Identity-mapped low memory (early boot stack); the first page is never mapped
+#define LOW_MEM_END     0x400000
+
+/**
+ * Bounds [*lo, *hi) of the stack holding addr. Returns 0 if addr is on no
+ * stack we know to be mapped.
+ */
+static int backtrace_stack_bounds(uint32_t addr, uint32_t *lo, uint32_t *hi)
+{
+    if (addr >= PAGE_SIZE && addr < LOW_MEM_END) {
+        *lo = PAGE_SIZE;
+        *hi = LOW_MEM_END;
+        return 1;
+    }
+    if (addr >= KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE && addr < KERNEL_STACK_TOP_VIRT) {
+        *lo = KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE;
+        *hi = KERNEL_STACK_TOP_VIRT;
+        return 1;
+    }
+    if (addr >= KTHREAD_STACK_AREA_BOTTOM && addr < KTHREAD_STACK_AREA_TOP) {
+        // Each slot is a guard page followed by the stack
+        uint32_t slot = addr - (addr - KTHREAD_STACK_AREA_BOTTOM) % KTHREAD_STACK_SLOT;
+        if (addr < slot + PAGE_SIZE) {
+            return 0;
+        }
+        *lo = slot + PAGE_SIZE;
+        *hi = slot + KTHREAD_STACK_SLOT;
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t backtrace_capture(uint32_t ebp, uint32_t *out, uint32_t max)
+{
+    uint32_t lo, hi;
+    uint32_t depth = 0;
+
+    if (!backtrace_stack_bounds(ebp, &lo, &hi)) {
+        return 0;
+    }
+
+    while (depth < max && !(ebp & 3) && ebp >= lo && ebp + 8 <= hi) {
+        uint32_t *frame = (uint32_t*)ebp;
+        uint32_t ret = frame[1];
+        uint32_t next = frame[0];
+
+        if (!ret) {
+            break;
+        }
+        out[depth++] = ret;
+
+        if (next <= ebp) {
+            break;
+        }
+        ebp = next;
+    }
+    return depth;
+}
+
+static int backtrace_format_at(char *buf, size_t size, uint32_t index, uint32_t addr, uint32_t lookup)
+{
+    uint32_t offset;
+    const char *name = ksym_lookup(lookup, &offset);
+
+    if (!name) {
+        return my_snprintf(buf, size, "  #%u 0x%08x\n", index, addr);
+    }
+    return my_snprintf(buf, size, "  #%u 0x%08x %s+0x%x\n", index, addr, name, offset + (addr - lookup));
+}
+
+int backtrace_format(char *buf, size_t size, uint32_t index, uint32_t addr)
+{
+    return backtrace_format_at(buf, size, index, addr, addr - 1);
+}
+
+void backtrace_print(int sinks, const uint32_t *addrs, uint32_t depth)
+{
+    char line[128];
+
+    for (uint32_t i = 0; i < depth; i++) {
+        backtrace_format(line, sizeof(line), i, addrs[i]);
+        console_write(sinks, line, WHITE_ON_BLACK);
+    }
+}
+
+void backtrace_print_context(int sinks, uint32_t eip, uint32_t ebp)
+{
+    uint32_t addrs[BACKTRACE_MAX_DEPTH];
+    uint32_t depth = backtrace_capture(ebp, addrs, BACKTRACE_MAX_DEPTH);
+    char line[128];
+
+    console_write(sinks, "Call trace:\n", WHITE_ON_BLACK);
+
+    // eip is the faulting instruction itself, not a return address
+    backtrace_format_at(line, sizeof(line), 0, eip, eip);
+    console_write(sinks, line, WHITE_ON_BLACK);
+
+    for (uint32_t i = 0; i < depth; i++) {
+        backtrace_format(line, sizeof(line), i + 1, addrs[i]);
+        console_write(sinks, line, WHITE_ON_BLACK);
+    }
+}
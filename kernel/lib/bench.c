@@ -0,0 +1,157 @@
+#include "bench.h"
+#include "printk.h"
+#include "console.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/div64.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/tsc.h"
+
+#define CPUID_EXT_FEATURES          0x80000001
+#define CPUID_EXT_EDX_RDTSCP        (1 << 27)
+
+#ifdef KERNEL_HOST
+extern const struct bench_def __start_bench[];
+extern const struct bench_def __stop_bench[];
+#define __bench_start   __start_bench
+#define __bench_end     __stop_bench
+#else
+// kernel.ld
+extern const struct bench_def __bench_start[];
+extern const struct bench_def __bench_end[];
+#endif
+
+int bench_has_rdtscp;
+
+static uint32_t bench_samples[BENCH_ITERS];
+static uint32_t bench_overhead;
+
+// Hardware counts of the timed iterations; no PMU access on the host
+#ifndef KERNEL_HOST
+static DEFINE_PERF_REGION(bench_perf, "bench");
+static struct perf_counts bench_perf_overhead;      // Per iteration, empty body
+#endif
+static struct perf_region *bench_counting;          // &bench_perf while timing
+
+static void bench_empty(struct bench_run *bench)
+{
+    (void)bench;
+}
+
+// One timed run of fn, in cycles
+static uint32_t bench_sample(void (*fn)(struct bench_run *bench))
+{
+    struct bench_run bench = { .stop = 0, .perf = bench_counting };
+
+    uint32_t flags = irq_save();
+    bench_start(&bench);
+    fn(&bench);
+    bench_stop(&bench);
+    irq_restore(flags);
+
+    uint64_t cycles = bench.stop - bench.start;
+    return cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles;
+}
+
+static void bench_sort(uint32_t *v, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        uint32_t j = i;
+        for (; j > 0 && v[j - 1] > x; j--) {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+}
+
+// Fill bench_samples and sort them, timing overhead already removed
+static void bench_collect(void (*fn)(struct bench_run *bench))
+{
+    for (uint32_t i = 0; i < BENCH_WARMUP; i++) {
+        bench_sample(fn);
+    }
+#ifndef KERNEL_HOST
+    perf_region_reset(&bench_perf);
+    bench_counting = &bench_perf;
+#endif
+    for (uint32_t i = 0; i < BENCH_ITERS; i++) {
+        uint32_t cycles = bench_sample(fn);
+        bench_samples[i] = cycles > bench_overhead ? cycles - bench_overhead : 0;
+    }
+    bench_counting = NULL;
+    bench_sort(bench_samples, BENCH_ITERS);
+}
+
+// Hardware counts per iteration of the last bench_collect(), empty if none
+static void bench_perf_format(char *buf, size_t size)
+{
+    buf[0] = '\0';
+#ifndef KERNEL_HOST
+    struct perf_counts counts;
+
+    if (!pmu.events) {
+        return;
+    }
+    perf_region_sum(&bench_perf, &counts);
+    perf_counts_per_run(&counts);
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        uint64_t base = bench_perf_overhead.count[ev];
+        counts.count[ev] = counts.count[ev] > base ? counts.count[ev] - base : 0;
+    }
+    perf_snprint(buf, size, &counts);
+#else
+    (void)size;
+#endif
+}
+
+static void bench_report(const char *name)
+{
+    uint32_t min = bench_samples[0];
+    uint32_t median = bench_samples[BENCH_ITERS / 2];
+    uint32_t p99 = bench_samples[BENCH_ITERS * 99 / 100];
+    uint32_t max = bench_samples[BENCH_ITERS - 1];
+    char perf[224];
+    char line[384];
+
+    bench_perf_format(perf, sizeof(perf));
+
+    printk("  %-24s %10u %10u %10u %10u\n", name, min, median, p99, max);
+    if (perf[0]) {
+        printk("  %-24s %s\n", "", perf);
+    }
+
+    my_snprintf(line, sizeof(line), "BENCH name=%s iters=%u min=%u median=%u p99=%u max=%u%s%s\n",
+                name, BENCH_ITERS, min, median, p99, max, perf[0] ? " " : "", perf);
+    console_write(CONSOLE_SERIAL, line, 0);
+}
+
+void bench_run_all(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_EXT_MAX, &eax, &ebx, &ecx, &edx);
+    if (eax >= CPUID_EXT_FEATURES) {
+        cpuid(CPUID_EXT_FEATURES, &eax, &ebx, &ecx, &edx);
+        bench_has_rdtscp = !!(edx & CPUID_EXT_EDX_RDTSCP);
+    }
+
+    // The cheapest empty sample is what the timer itself costs
+    bench_overhead = 0;
+    bench_collect(bench_empty);
+    bench_overhead = bench_samples[0];
+#ifndef KERNEL_HOST
+    perf_region_sum(&bench_perf, &bench_perf_overhead);
+    perf_counts_per_run(&bench_perf_overhead);
+#endif
+
+    pr_notice("=== BENCHMARKS (%u iterations, %u warmup, cycles) ===\n", BENCH_ITERS, BENCH_WARMUP);
+    printk("  TSC %u kHz, %s, timer overhead %u cycles subtracted\n",
+           tsc_khz, bench_has_rdtscp ? "rdtscp" : "no rdtscp", bench_overhead);
+    printk("  %-24s %10s %10s %10s %10s\n", "name", "min", "median", "p99", "max");
+
+    for (const struct bench_def *def = __bench_start; def < __bench_end; def++) {
+        bench_collect(def->fn);
+        bench_report(def->name);
+    }
+
+    console_write(CONSOLE_SERIAL, "BENCH done\n", 0);
+}
@@ -0,0 +1,54 @@
+#include "boot_prof.h"
+#include "boot_info.h"
+#include "printk.h"
+#include "arch/x86/tsc.h"
+
+static struct boot_phase boot_phases[BOOT_PROF_MAX_PHASES];
+static uint32_t boot_phase_count;
+
+static void boot_prof_mark_at(const char *name, uint64_t tsc)
+{
+    if (boot_phase_count < BOOT_PROF_MAX_PHASES) {
+        boot_phases[boot_phase_count++] = (struct boot_phase){ .name = name, .tsc = tsc };
+    }
+}
+
+void boot_prof_start(void)
+{
+    if (boot_info.flags & BOOT_INFO_TSC) {
+        boot_prof_mark_at("firmware+stage1", boot_info.tsc_stage2);
+        boot_prof_mark_at("stage2 load", boot_info.tsc_loaded);
+        boot_prof_mark_at("stage2 e820/video", boot_info.tsc_handoff);
+    }
+    boot_prof_mark("kernel entry");
+}
+
+void boot_prof_mark(const char *name)
+{
+    boot_prof_mark_at(name, rdtsc());
+}
+
+void boot_prof_report(void)
+{
+    if (!boot_phase_count) {
+        return;
+    }
+
+    // Without loader stamps the table starts at the kernel entry
+    uint64_t prev = (boot_info.flags & BOOT_INFO_TSC) ? 0 : boot_phases[0].tsc;
+    uint64_t start = prev;
+
+    printk("[BOOTPROF] %-20s %14s %10s\n", "phase", "cycles", "us");
+    for (uint32_t i = 0; i < boot_phase_count; i++) {
+        uint64_t cycles = boot_phases[i].tsc - prev;
+        uint64_t us = tsc_cycles_to_ns(cycles);
+        do_div_u64(&us, 1000);
+        printk("[BOOTPROF] %-20s %14llu %10llu\n", boot_phases[i].name, cycles, us);
+        prev = boot_phases[i].tsc;
+    }
+
+    uint64_t total = prev - start;
+    uint64_t total_us = tsc_cycles_to_ns(total);
+    do_div_u64(&total_us, 1000);
+    printk("[BOOTPROF] %-20s %14llu %10llu\n", "total", total, total_us);
+}
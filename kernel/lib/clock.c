@@ -0,0 +1,126 @@
+#include "clock.h"
+#include "arch/x86/io.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/apic.h"
+#include "timer.h"
+#include "printk.h"
+
+static struct clock_event_device *clockevent_devices;
+static struct clock_event_device *tick_device;
+
+void udelay(uint32_t us)
+{
+    if (!tsc_khz) {
+        // Not calibrated yet: a port 0x80 write takes about 1us
+        while (us--) {
+            io_wait();
+        }
+        return;
+    }
+
+    uint64_t cycles = (uint64_t)us * tsc_khz;
+    do_div_u64(&cycles, 1000);
+
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < cycles) {
+        cpu_relax();
+    }
+}
+
+void mdelay(uint32_t ms)
+{
+    while (ms--) {
+        udelay(1000);
+    }
+}
+
+static void tick_handle_oneshot(struct clock_event_device *dev, interrupt_frame_t *frame)
+{
+    (void)dev;
+    (void)frame;
+    timer_interrupt();
+}
+
+void clockevents_register_device(struct clock_event_device *dev)
+{
+    dev->event_handler = NULL;
+    dev->next = clockevent_devices;
+    clockevent_devices = dev;
+    pr_debug("[CLOCK] Event device %s, rating %d\n", dev->name, dev->rating);
+}
+
+struct clock_event_device* clockevent_get(void)
+{
+    return tick_device;
+}
+
+void clockevent_program(uint64_t expires_ns)
+{
+    struct clock_event_device *dev = tick_device;
+    if (!dev) {
+        return;
+    }
+
+    uint64_t now = ktime_get_ns();
+    uint64_t delta = expires_ns > now ? expires_ns - now : 0;
+
+    // Too far out for the counter: wake up early and re-arm from there
+    if (delta > dev->max_delta_ns) {
+        delta = dev->max_delta_ns;
+    }
+    if (delta < dev->min_delta_ns) {
+        delta = dev->min_delta_ns;
+    }
+    dev->set_next_event(delta);
+}
+
+static struct clock_event_device* clockevent_best(void)
+{
+    struct clock_event_device *best = NULL;
+    for (struct clock_event_device *dev = clockevent_devices; dev; dev = dev->next) {
+        if (!best || dev->rating > best->rating) {
+            best = dev;
+        }
+    }
+    return best;
+}
+
+void clock_init(void)
+{
+    if (tsc_init() < 0) {
+        pr_warn("[CLOCK] No TSC clocksource, ktime_get_ns() stays at 0\n");
+    }
+
+    clockevents_register_device(&pit_clockevent);
+    if (apic_available() && tsc_khz && lapic_timer_calibrate() == 0) {
+        clockevents_register_device(&lapic_clockevent);
+    }
+
+    struct clock_event_device *dev = clockevent_best();
+    if (!(dev->features & CLOCK_EVT_FEAT_ONESHOT) || dev->enable() < 0) {
+        pr_err("[CLOCK] Could not enable %s in one-shot mode\n", dev->name);
+        return;
+    }
+
+    timer_init();
+    tick_device = dev;
+    dev->event_handler = tick_handle_oneshot;
+    uint64_t max_us = dev->max_delta_ns;
+    do_div_u64(&max_us, NSEC_PER_USEC);
+    pr_info("[CLOCK] Event device: %s, one-shot, up to %llu us ahead\n", dev->name, max_us);
+}
+
+int clock_init_cpu(void)
+{
+    struct clock_event_device *dev = tick_device;
+    if (!dev || !(dev->features & CLOCK_EVT_FEAT_PERCPU)) {
+        return -1;
+    }
+
+    // The interrupt handler is shared; only the counter is per CPU
+    if (dev->enable_cpu) {
+        dev->enable_cpu();
+    }
+    timer_init();
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include "console.h"
+#include "drivers/vga.h"
+#include "drivers/serial.h"
+
+void console_write(int sinks, const char* str, char color)
+{
+    if (sinks & CONSOLE_VGA) {
+        vga_print_string(str, color);
+    }
+    if (sinks & CONSOLE_SERIAL) {
+        serial_print_string(str);
+    }
+}
@@ -0,0 +1,40 @@
+#include "ksyms.h"
+#include "printk.h"
+
+// kernel.ld
+extern char __text_end;
+
+const char* ksym_lookup(uint32_t addr, uint32_t *offset)
+{
+    if (!&ksym_count || !ksym_count || addr < ksym_addrs[0] || addr >= (uint32_t)&__text_end) {
+        return NULL;
+    }
+
+    // Last symbol at or below addr
+    uint32_t lo = 0;
+    uint32_t hi = ksym_count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ksym_addrs[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (offset) {
+        *offset = addr - ksym_addrs[lo];
+    }
+    return &ksym_names[ksym_name_offs[lo]];
+}
+
+int ksym_snprint(char *buf, size_t size, uint32_t addr)
+{
+    uint32_t offset;
+    const char *name = ksym_lookup(addr, &offset);
+
+    if (!name) {
+        return my_snprintf(buf, size, "0x%08x", addr);
+    }
+    return my_snprintf(buf, size, "%s+0x%x", name, offset);
+}
@@ -2,6 +2,11 @@
 #include "../include/printk.h"
 #include "../include/drivers/vga.h"
 #include "../include/panik.h"
+#include "../include/console.h"
+#include "../include/pstore.h"
+#include "../include/backtrace.h"
+#include "../include/trace.h"
+#include "../include/arch/x86/debug_exit.h"
 
 // Panic mode and state tracking
 static panik_mode_t current_panik_mode = PANIK_MODE_NORMAL;
@@ -64,6 +69,9 @@ void panik(const char* fmt, ...)
 	// Disable Interrupt in PANIK_MODE_NORMAL
 	__asm__ __volatile__("cli");
 
+	// Keep a crash record for the next boot before touching any device
+	pstore_save(PSTORE_REASON_PANIK, panik_state.last_panik_msg, NULL);
+
 	// Log to ring buffer and display
 	ringbuf_write("[PANIK] ", 8);
 	ringbuf_write(panik_state.last_panik_msg, len);
@@ -74,9 +82,35 @@ void panik(const char* fmt, ...)
 	vga_print_string(panik_state.last_panik_msg, VGA_COLOR(VGA_BLACK, VGA_LIGHT_RED));
 	vga_print_string("\n", WHITE_ON_BLACK);
 
+	// Who called panik(), symbolized; the serial dump below picks it up from the ring
+	uint32_t bt[BACKTRACE_MAX_DEPTH];
+	uint32_t depth = backtrace_capture((uint32_t)__builtin_frame_address(0), bt, BACKTRACE_MAX_DEPTH);
+	ringbuf_write("Call trace:\n", 12);
+	vga_print_string("Call trace:\n", WHITE_ON_BLACK);
+	for (uint32_t i = 0; i < depth; i++) {
+		char line[128];
+		int line_len = backtrace_format(line, sizeof(line), i, bt[i]);
+		ringbuf_write(line, line_len);
+		vga_print_string(line, WHITE_ON_BLACK);
+	}
+
 	// Print system halt message
 	vga_print_string("System halted. Press reset to restart.\n", VGA_COLOR(VGA_BLACK, VGA_YELLOW));
 
+	// Flush the end of the log to serial so the lead-up to the panik
+	// survives even if it already scrolled off the screen
+	console_write(CONSOLE_SERIAL, "\n--- panik: last kernel log ---\n", 0);
+	dmesg_tail(CONSOLE_SERIAL, PANIK_LOG_DUMP_SIZE);
+	console_write(CONSOLE_SERIAL, "--- end of log ---\n", 0);
+
+	// And what the scheduler and fault paths did last, per CPU
+	trace_dump(CONSOLE_SERIAL);
+
+#ifdef KERNEL_HEADLESS
+	// Unattended run: let the test runner see the panik right away
+	qemu_exit(QEMU_EXIT_PANIK);
+#endif
+
 	// halt in panik
 	while (1) {
 		__asm__ __volatile__("hlt");
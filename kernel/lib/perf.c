@@ -0,0 +1,121 @@
+#include "perf.h"
+#include "printk.h"
+#include "console.h"
+#include "drivers/vga.h"
+#include "arch/x86/div64.h"
+
+void perf_region_reset(struct perf_region *region)
+{
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct perf_region_cpu *pc = &region->cpu[cpu];
+        pc->runs = 0;
+        for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+            pc->total[ev] = 0;
+        }
+    }
+}
+
+void perf_region_sum(const struct perf_region *region, struct perf_counts *out)
+{
+    out->runs = 0;
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        out->count[ev] = 0;
+    }
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        const struct perf_region_cpu *pc = &region->cpu[cpu];
+        out->runs += pc->runs;
+        for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+            out->count[ev] += pc->total[ev];
+        }
+    }
+}
+
+void perf_counts_per_run(struct perf_counts *counts)
+{
+    if (counts->runs == 0) {
+        return;
+    }
+    for (int ev = 0; ev < PMU_NR_EVENTS; ev++) {
+        do_div_u64(&counts->count[ev], counts->runs);
+    }
+}
+
+/**
+ * num * scale / den without a 64-bit divisor: both are scaled down
+ * until they fit in 32 bits, so the product cannot overflow either
+ */
+static uint64_t perf_ratio(uint64_t num, uint64_t den, uint32_t scale)
+{
+    while (den > 0xFFFFFFFF || num > 0xFFFFFFFF) {
+        num >>= 1;
+        den >>= 1;
+    }
+    if (den == 0) {
+        return 0;
+    }
+
+    uint64_t q = num * scale;
+    do_div_u64(&q, (uint32_t)den);
+    return q;
+}
+
+static int perf_counted(int ev)
+{
+    return (pmu.events >> ev) & 1;
+}
+
+int perf_snprint(char *buf, size_t size, const struct perf_counts *counts)
+{
+    const uint64_t *c = counts->count;
+    int len = 0;
+
+    buf[0] = '\0';
+    for (int ev = 0; ev < PMU_NR_EVENTS && (size_t)len < size; ev++) {
+        if (!perf_counted(ev)) {
+            continue;
+        }
+        len += my_snprintf(buf + len, size - len, "%s%s=%llu",
+                           len ? " " : "", pmu_event_name(ev), c[ev]);
+
+        if (ev == PMU_EV_INSTRUCTIONS && perf_counted(PMU_EV_CYCLES) && (size_t)len < size) {
+            uint64_t ipc = perf_ratio(c[PMU_EV_INSTRUCTIONS], c[PMU_EV_CYCLES], 100);
+            uint32_t frac = do_div_u64(&ipc, 100);
+            len += my_snprintf(buf + len, size - len, " ipc=%llu.%02u", ipc, frac);
+        }
+        if (ev == PMU_EV_DTLB_MISSES && perf_counted(PMU_EV_INSTRUCTIONS) && (size_t)len < size) {
+            // Misses per thousand instructions
+            uint64_t mpki = perf_ratio(c[PMU_EV_DTLB_MISSES], c[PMU_EV_INSTRUCTIONS], 100000);
+            uint32_t frac = do_div_u64(&mpki, 100);
+            len += my_snprintf(buf + len, size - len, " dtlb_mpki=%llu.%02u", mpki, frac);
+        }
+    }
+    return len;
+}
+
+void perf_report(const struct perf_region *region, int sinks)
+{
+    struct perf_counts counts;
+    char stats[224];
+    char line[288];
+
+    if (!pmu.events) {
+        return;
+    }
+
+    perf_region_sum(region, &counts);
+    my_snprintf(line, sizeof(line), "[PERF] %s: %u runs\n", region->name, counts.runs);
+    console_write(sinks, line, WHITE_ON_BLACK);
+    if (counts.runs == 0) {
+        return;
+    }
+
+    perf_snprint(stats, sizeof(stats), &counts);
+    my_snprintf(line, sizeof(line), "PERF name=%s runs=%u %s\n", region->name, counts.runs, stats);
+    console_write(CONSOLE_SERIAL, line, 0);
+
+    perf_counts_per_run(&counts);
+    perf_snprint(stats, sizeof(stats), &counts);
+    my_snprintf(line, sizeof(line), "[PERF]   per run: %s\n", stats);
+    console_write(sinks, line, WHITE_ON_BLACK);
+}
@@ -1,15 +1,59 @@
 #include "printk.h"
 #include "drivers/vga.h"
+#include "console.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/div64.h"
+#include "clock.h"
+#include "smp.h"
+#include "spinlock.h"
 #include <stdarg.h>
 #include <stdint.h>
 #include <stddef.h>
 
 // Circular log buffer for storing kernel messages
-static char log_buffer[LOG_BUF_SIZE];
+static char log_buffer[LOG_RING_SIZE];
 
 // Ring buffer pointers
 static size_t rb_head = 0;  // Position of next byte to be written
 static size_t rb_tail = 0;  // Position of oldest byte in buffer
+static int rb_wrapped = 0;  // Set once the oldest bytes started being dropped
+static int rb_line_start = 1;   // Last byte written was '\n' (next one starts a record)
+
+// Messages with level <= console_loglevel are rendered to console_sinks
+static int console_loglevel = CONFIG_LOGLEVEL;
+static int console_sinks = CONSOLE_VGA;
+
+/*
+Writers take log_lock so that a record (stamp, level prefix and message)
+reaches the ring and the console in one piece. Readers (dmesg, pstore,
+panik) stay lock-free: a crash must always be able to dump the log. A
+fault taken on the CPU that holds the lock prints without it rather than
+deadlocking.
+*/
+static DEFINE_TICKET_LOCK(log_lock);
+static volatile int log_lock_cpu = -1;
+
+static uint32_t log_lock_irqsave(int *nested)
+{
+    uint32_t flags = irq_save();
+    int cpu = smp_processor_id();
+
+    *nested = (log_lock_cpu == cpu);
+    if (!*nested) {
+        ticket_lock(&log_lock);
+        log_lock_cpu = cpu;
+    }
+    return flags;
+}
+
+static void log_unlock_irqrestore(int nested, uint32_t flags)
+{
+    if (!nested) {
+        log_lock_cpu = -1;
+        ticket_unlock(&log_lock);
+    }
+    irq_restore(flags);
+}
 
 const struct loglevel loglevels[] = {
     { '0', "EMERG",  VGA_COLOR(VGA_RED, VGA_WHITE) },
@@ -29,11 +73,12 @@ const int num_loglevels = sizeof(loglevels) / sizeof(loglevels[0]);
  */
 static void ringbuf_putc(char ch) {
     log_buffer[rb_head] = ch;
-    rb_head = (rb_head + 1) % LOG_BUF_SIZE;
+    rb_head = (rb_head + 1) % LOG_RING_SIZE;
     
     // If buffer is full, advance tail to drop oldest byte
     if (rb_head == rb_tail) {
-        rb_tail = (rb_tail + 1) % LOG_BUF_SIZE;
+        rb_tail = (rb_tail + 1) % LOG_RING_SIZE;
+        rb_wrapped = 1;
     }
 }
 
@@ -44,6 +89,112 @@ void ringbuf_write(const char* str, size_t str_len) {
     for (size_t i = 0; i < str_len; i++) {
         ringbuf_putc(str[i]);
     }
+    if (str_len) {
+        rb_line_start = (str[str_len - 1] == '\n');
+    }
+}
+
+/**
+ * Number of bytes currently held in the ring
+ */
+size_t log_buffer_used(void) {
+    return (rb_head + LOG_RING_SIZE - rb_tail) % LOG_RING_SIZE;
+}
+
+/**
+ * Move the iterator to the start of the next record unless it already sits
+ * on one. A record starts at the beginning of an unwrapped buffer or right
+ * after a '\n'; anything before that is the tail of a dropped record.
+ */
+static void log_iter_align(struct log_iter *it) {
+    if (it->pos == rb_tail && !rb_wrapped) {
+        return;
+    }
+
+    while (it->remaining > 0) {
+        char prev = log_buffer[(it->pos + LOG_RING_SIZE - 1) % LOG_RING_SIZE];
+        if (prev == '\n') {
+            return;
+        }
+        it->pos = (it->pos + 1) % LOG_RING_SIZE;
+        it->remaining--;
+    }
+}
+
+/**
+ * Iterate every record from rb_tail to rb_head (oldest first).
+ * The range is snapshotted here; records written afterwards are not visited.
+ */
+void log_iter_init(struct log_iter *it) {
+    it->pos = rb_tail;
+    it->remaining = log_buffer_used();
+    log_iter_align(it);
+}
+
+/**
+ * Iterate only the records within the last max_bytes of the ring
+ */
+void log_iter_init_tail(struct log_iter *it, size_t max_bytes) {
+    size_t used = log_buffer_used();
+    size_t skip = (used > max_bytes) ? used - max_bytes : 0;
+
+    it->pos = (rb_tail + skip) % LOG_RING_SIZE;
+    it->remaining = used - skip;
+    log_iter_align(it);
+}
+
+/**
+ * Copy the next record (one line, including its '\n') into buf.
+ * Lines longer than the buffer are returned in pieces.
+ * Returns the record length, 0 when the iteration is done.
+ */
+size_t log_iter_next(struct log_iter *it, char *buf, size_t size) {
+    size_t len = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    while (it->remaining > 0 && len < size - 1) {
+        char ch = log_buffer[it->pos];
+        it->pos = (it->pos + 1) % LOG_RING_SIZE;
+        it->remaining--;
+        buf[len++] = ch;
+        if (ch == '\n') {
+            break;
+        }
+    }
+
+    buf[len] = '\0';
+    return len;
+}
+
+static void log_dump(struct log_iter *it, int sinks) {
+    char line[LOG_LINE_MAX];
+
+    while (log_iter_next(it, line, sizeof(line)) > 0) {
+        console_write(sinks, line, WHITE_ON_BLACK);
+    }
+}
+
+/**
+ * Replay the whole log ring to the given sinks (CONSOLE_*)
+ */
+void dmesg(int sinks) {
+    struct log_iter it;
+    log_iter_init(&it);
+    console_write(sinks, "--- dmesg ---\n", VGA_COLOR(VGA_BLACK, VGA_LIGHT_CYAN));
+    log_dump(&it, sinks);
+    console_write(sinks, "--- end dmesg ---\n", VGA_COLOR(VGA_BLACK, VGA_LIGHT_CYAN));
+}
+
+/**
+ * Replay the most recent max_bytes of the log ring
+ */
+void dmesg_tail(int sinks, size_t max_bytes) {
+    struct log_iter it;
+    log_iter_init_tail(&it, max_bytes);
+    log_dump(&it, sinks);
 }
 
 /**
@@ -64,230 +215,417 @@ static int find_loglevel(char level_char) {
 void printk_init(void) {
     rb_head = 0;
     rb_tail = 0;
+    rb_wrapped = 0;
+    console_loglevel = CONFIG_LOGLEVEL;
+    console_sinks = CONSOLE_VGA;
     vga_init();
 }
 
+/**
+ * Set / get the runtime console log level
+ */
+void printk_set_console_loglevel(int level) {
+    if (level < LOGLEVEL_EMERG) level = LOGLEVEL_EMERG;
+    if (level > LOGLEVEL_DEBUG) level = LOGLEVEL_DEBUG;
+    console_loglevel = level;
+}
+
+int printk_get_console_loglevel(void) {
+    return console_loglevel;
+}
+
+/**
+ * Choose where console messages go (CONSOLE_*)
+ */
+void printk_set_console_sinks(int sinks) {
+    console_sinks = sinks;
+}
+
+/**
+ * Decide whether a rate limited call site may print.
+ * The first call opens the window. When a new window opens and messages were
+ * dropped in the previous one, a summary line is printed first.
+ */
+int printk_ratelimit_ok(struct ratelimit_state *rs) {
+    if (!rs->interval) {
+        return 1;
+    }
+
+    uint64_t now = ktime_get_ns();
+
+    if (!rs->begin) {
+        rs->begin = now;
+    }
+
+    if (now - rs->begin >= rs->interval) {
+        if (rs->missed) {
+            printk(KERN_WARNING "%u callbacks suppressed\n", rs->missed);
+        }
+        rs->begin = now;
+        rs->printed = 0;
+        rs->missed = 0;
+    }
+
+    if (rs->printed < rs->burst) {
+        rs->printed++;
+        return 1;
+    }
+
+    rs->missed++;
+    return 0;
+}
+
+/*
+Formatter helpers
+    A conversion is parsed once into a fmt_spec, its argument is fetched
+    once with the right width, and every integer goes through put_number().
+*/
+
+// Flags from a conversion specification
+#define FMT_ZEROPAD     (1 << 0)    // '0' pad with zeros
+#define FMT_LEFT        (1 << 1)    // '-' left justify
+#define FMT_PLUS        (1 << 2)    // '+' always print a sign
+#define FMT_SPACE       (1 << 3)    // ' ' space in place of '+'
+#define FMT_SPECIAL     (1 << 4)    // '#' 0x prefix for hex
+#define FMT_SIGNED      (1 << 5)    // signed conversion (%d)
+#define FMT_UPPER       (1 << 6)    // upper case hex (%X)
+
+// Length modifiers
+#define FMT_LEN_INT     0
+#define FMT_LEN_LONG    1           // %l
+#define FMT_LEN_LLONG   2           // %ll
+#define FMT_LEN_SIZE    3           // %z
+
+struct fmt_spec {
+    uint8_t flags;
+    uint8_t base;
+    uint8_t length;
+    int width;
+    int precision;                  // -1 when not given
+};
+
+// "00" "01" ... "99": two decimal digits per division by 100
+static const char dec_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+/**
+ * Write the decimal digits of a 32-bit value backwards, ending at `end`.
+ * Returns a pointer to the first digit.
+ */
+static char* u32_to_dec(char *end, uint32_t val)
+{
+    while (val >= 100) {
+        uint32_t q = val / 100;
+        uint32_t r = (val - q * 100) * 2;
+        end -= 2;
+        end[0] = dec_pairs[r];
+        end[1] = dec_pairs[r + 1];
+        val = q;
+    }
+
+    if (val >= 10) {
+        end -= 2;
+        end[0] = dec_pairs[val * 2];
+        end[1] = dec_pairs[val * 2 + 1];
+    } else {
+        *--end = '0' + val;
+    }
+    return end;
+}
+
+/**
+ * 64-bit values are split into 8-digit chunks with one 64/32 division each,
+ * the chunks themselves are converted with 32-bit arithmetic only.
+ */
+static char* u64_to_dec(char *end, uint64_t val)
+{
+    while (val >> 32) {
+        uint32_t chunk = do_div_u64(&val, 100000000);
+        for (int i = 0; i < 4; i++) {
+            uint32_t r = (chunk % 100) * 2;
+            chunk /= 100;
+            end -= 2;
+            end[0] = dec_pairs[r];
+            end[1] = dec_pairs[r + 1];
+        }
+    }
+    return u32_to_dec(end, (uint32_t)val);
+}
+
+static char* u64_to_hex(char *end, uint64_t val, const char *digits)
+{
+    if (val >> 32) {
+        // low word always yields exactly 8 digits when the high word is set
+        uint32_t low = (uint32_t)val;
+        for (int i = 0; i < 8; i++) {
+            *--end = digits[low & 0xF];
+            low >>= 4;
+        }
+        val >>= 32;
+    }
+
+    uint32_t v = (uint32_t)val;
+    do {
+        *--end = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    return end;
+}
+
+static inline char* emit_repeat(char *p, char *end, char c, int count)
+{
+    while (count-- > 0 && p < end) {
+        *p++ = c;
+    }
+    return p;
+}
+
+static inline char* emit_string(char *p, char *end, const char *s, int len)
+{
+    while (len-- > 0 && p < end) {
+        *p++ = *s++;
+    }
+    return p;
+}
+
+/**
+ * Format one integer according to spec: [spaces][sign][0x][zeros]digits[spaces]
+ */
+static char* put_number(char *p, char *end, uint64_t num, const struct fmt_spec *spec)
+{
+    char tmp[24];
+    char *digits_end = tmp + sizeof(tmp);
+    char *digits;
+    char sign = 0;
+
+    if (spec->flags & FMT_SIGNED) {
+        if ((int64_t)num < 0) {
+            sign = '-';
+            num = 0 - num;
+        } else if (spec->flags & FMT_PLUS) {
+            sign = '+';
+        } else if (spec->flags & FMT_SPACE) {
+            sign = ' ';
+        }
+    }
+
+    if (spec->precision == 0 && num == 0) {
+        digits = digits_end;        // "%.0d" of zero prints nothing
+    } else if (spec->base == 16) {
+        digits = u64_to_hex(digits_end, num, (spec->flags & FMT_UPPER) ? hex_upper : hex_lower);
+    } else {
+        digits = u64_to_dec(digits_end, num);
+    }
+
+    int ndigits = digits_end - digits;
+    int prefix = (spec->base == 16 && (spec->flags & FMT_SPECIAL)) ? 2 : 0;
+    int zeros = (spec->precision > ndigits) ? spec->precision - ndigits : 0;
+    int pad = spec->width - (ndigits + zeros + prefix + (sign ? 1 : 0));
+
+    // '0' only applies when right justified and no precision was given
+    if ((spec->flags & (FMT_ZEROPAD | FMT_LEFT)) == FMT_ZEROPAD && spec->precision < 0 && pad > 0) {
+        zeros += pad;
+        pad = 0;
+    }
+
+    if (!(spec->flags & FMT_LEFT)) {
+        p = emit_repeat(p, end, ' ', pad);
+    }
+    if (sign && p < end) {
+        *p++ = sign;
+    }
+    if (prefix) {
+        p = emit_repeat(p, end, '0', 1);
+        p = emit_repeat(p, end, (spec->flags & FMT_UPPER) ? 'X' : 'x', 1);
+    }
+    p = emit_repeat(p, end, '0', zeros);
+    p = emit_string(p, end, digits, ndigits);
+    if (spec->flags & FMT_LEFT) {
+        p = emit_repeat(p, end, ' ', pad);
+    }
+    return p;
+}
+
 /**
  * My Implementation of vsnprintf 
  * snprintf (buf, size to write, template, value) writes to a buffer 
- * Supported format specifiers: %s (string), %c (char), %d (int), %u (unsigned int), %x (hex), %p (pointer)
+ * Conversions: %s %c %d %i %u %x %X %p %%
+ * Flags: '-' (left justify), '0', '+', ' ', '#', width, .precision
+ * Length modifiers: l, ll (64-bit), z (size_t)
  * Return number of characters written
- * TODO: Modify this buffer generation as desired
  */
 int my_vsnprintf(char *buf, size_t size, const char *fmt, va_list args)
 {
+    if (size == 0) {
+        return 0;
+    }
+
     char *p = buf;
     char *end = buf + size - 1;
 
     while(*fmt && p < end)
     {
-        if(*fmt == '%') {
+        if(*fmt != '%') {
+            *p++ = *fmt++;  // Copy normal character
+            continue;
+        }
+        fmt++;
+
+        struct fmt_spec spec = { .flags = 0, .base = 10, .length = FMT_LEN_INT, .width = 0, .precision = -1 };
+
+        // Flags
+        for (;;) {
+            if (*fmt == '0')        spec.flags |= FMT_ZEROPAD;
+            else if (*fmt == '-')   spec.flags |= FMT_LEFT;
+            else if (*fmt == '+')   spec.flags |= FMT_PLUS;
+            else if (*fmt == ' ')   spec.flags |= FMT_SPACE;
+            else if (*fmt == '#')   spec.flags |= FMT_SPECIAL;
+            else break;
             fmt++;
+        }
 
-            // Handle Padding
-            int pad_width = 0;
-            char pad_char = ' ';
-            // Handle zero padding
-            if(*fmt == '0')
-            {
-                pad_char = '0';
+        // Field width
+        while(*fmt >= '0' && *fmt <= '9') {
+            spec.width = spec.width * 10 + (*fmt - '0');
+            fmt++;
+        }
+
+        // Precision
+        if (*fmt == '.') {
+            fmt++;
+            spec.precision = 0;
+            while(*fmt >= '0' && *fmt <= '9') {
+                spec.precision = spec.precision * 10 + (*fmt - '0');
                 fmt++;
             }
-            // Handle Padding width
-            while(*fmt >= '0' && *fmt <= '9') {
-                pad_width = pad_width * 10 + (*fmt - '0');
+        }
+
+        // Length modifier
+        if (*fmt == 'l') {
+            fmt++;
+            spec.length = FMT_LEN_LONG;
+            if (*fmt == 'l') {
                 fmt++;
+                spec.length = FMT_LEN_LLONG;
             }
+        } else if (*fmt == 'z') {
+            fmt++;
+            spec.length = FMT_LEN_SIZE;
+        }
 
-            switch(*fmt) {
-                case 's': {
-                    const char *str = va_arg(args, const char*);
-                    int str_len = 0;
-                    
-                    // Handle null strings
-                    if (!str) str = "(null)";  
-
-                    // Calculate string length
-                    const char *s = str;
-                    while(*s++) str_len++;
-
-                    // claculate the padding needed
-                    int to_pad_width;
-                    if(str_len > pad_width)
-                    {
-                        to_pad_width = 0;
-                    } else
-                    {
-                        to_pad_width = pad_width - str_len;
-                    }
-
-                    // Write padding if needed
-                    while(to_pad_width-- > 0 && p < end) {
-                        *p++ = pad_char; 
-                    }
-
-                    // Write the string
-                    while(*str && p < end) {
-                        *p++ = *str++;
-                    }
-                    break;
-                }
-                case 'c': {
-                    char c = (char)va_arg(args, int);
+        uint64_t num;
 
-                    // calculate the padding needed
-                    int to_pad_width = pad_width - 1;
-                    if(to_pad_width < 0) to_pad_width = 0;
+        switch(*fmt) {
+            case '\0':
+                continue;   // lone '%' at the end of the format
 
-                    // Write padding if needed
-                    while(to_pad_width-- > 0 && p < end) {
-                        *p++ = pad_char; 
-                    }
+            case 's': {
+                const char *str = va_arg(args, const char*);
 
-                    // Write the character
-                    if(p < end) *p++ = c;
-                    break;
-                }
-                case 'd': {
-                    int num = va_arg(args, int);
-                    // convert signed decimal into char array
-                    int is_negative = (num < 0);
-                    unsigned int val = is_negative ? -num : num;
-                    char tmp[12];
-                    int tmplen = 0;
-                    
-                    do {
-                        tmp[tmplen++] = '0' + (val % 10);
-                        val /= 10;
-                    } while(val && tmplen < (int)sizeof(tmp));
-
-                    if(is_negative && tmplen < (int)sizeof(tmp))
-                    {
-                        tmp[tmplen++] = '-';  // Fixed: increment tmplen
-                    }
-
-                    // calculate the padding needed
-                    int to_pad_width = pad_width - tmplen;
-                    if(to_pad_width < 0) to_pad_width = 0;
-
-                    // Write padding if needed
-                    while(to_pad_width-- > 0 && p < end) {
-                        *p++ = pad_char; 
-                    }
-
-                    // reverse it and store in output
-                    for(int pos = tmplen - 1; pos >= 0 && p < end; pos--)  // Fixed: start from tmplen-1
-                    {
-                        *p++ = tmp[pos];
-                    }
-                    break;
-                }
-                case 'u': {
-                    int num = va_arg(args, int);
-                    
-                    char tmp[12];
-                    int tmplen = 0;
-                    
-                    do {
-                        tmp[tmplen++] = '0' + (num % 10);
-                        num /= 10;
-                    } while(num && tmplen < (int)sizeof(tmp));
-
-                    // calculate the padding needed
-                    int to_pad_width = pad_width - tmplen;
-                    if(to_pad_width < 0) to_pad_width = 0;
-
-                    // Write padding if needed
-                    while(to_pad_width-- > 0 && p < end) {
-                        *p++ = pad_char; 
-                    }
-
-                    // reverse it and store in output
-                    for(int pos = tmplen - 1; pos >= 0 && p < end; pos--)  // Fixed: start from tmplen-1
-                    {
-                        *p++ = tmp[pos];
-                    }
-                    break;
+                // Handle null strings
+                if (!str) str = "(null)";
+
+                // Length, bounded by the precision
+                int str_len = 0;
+                while (str[str_len] && (spec.precision < 0 || str_len < spec.precision)) {
+                    str_len++;
                 }
-                case 'x': {
-                    unsigned int num = va_arg(args, unsigned int);
-                    // convert unsigned hex into char array
-                    char tmp[12];
-                    int tmplen = 0;
-                    
-                    if (num == 0) {
-                        tmp[tmplen++] = '0';
-                    } else {
-                        do {
-                            int digit = num % 16;
-                            tmp[tmplen++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
-                            num /= 16;
-                        } while(num && tmplen < (int)sizeof(tmp));
-                    }
-
-                    // calculate the padding needed
-                    int to_pad_width = pad_width - tmplen;
-                    if(to_pad_width < 0) to_pad_width = 0;
-
-                    // Write padding if needed
-                    while(to_pad_width-- > 0 && p < end) {
-                        *p++ = pad_char; 
-                    }
-
-                    // reverse it and store in output
-                    for(int pos = tmplen - 1; pos >= 0 && p < end; pos--)
-                    {
-                        *p++ = tmp[pos];
-                    }
-                    break;
+
+                int pad = spec.width - str_len;
+                char pad_char = (spec.flags & FMT_ZEROPAD) ? '0' : ' ';
+                if (!(spec.flags & FMT_LEFT)) p = emit_repeat(p, end, pad_char, pad);
+                p = emit_string(p, end, str, str_len);
+                if (spec.flags & FMT_LEFT) p = emit_repeat(p, end, ' ', pad);
+                fmt++;
+                continue;
+            }
+
+            case 'c': {
+                char c = (char)va_arg(args, int);
+                char pad_char = (spec.flags & FMT_ZEROPAD) ? '0' : ' ';
+                if (!(spec.flags & FMT_LEFT)) p = emit_repeat(p, end, pad_char, spec.width - 1);
+                if (p < end) *p++ = c;
+                if (spec.flags & FMT_LEFT) p = emit_repeat(p, end, ' ', spec.width - 1);
+                fmt++;
+                continue;
+            }
+
+            case 'p': {
+                spec.base = 16;
+                spec.flags |= FMT_SPECIAL;
+                num = (uintptr_t)va_arg(args, void*);
+                // keep the 0x prefix even for NULL
+                if (num == 0) {
+                    p = emit_string(p, end, "0x0", 3);
+                    fmt++;
+                    continue;
                 }
-                case 'p': {
-                    void *ptr = va_arg(args, void*);
-                    // Add "0x" prefix
-                    if (p < end - 1) {
-                        *p++ = '0';
-                        *p++ = 'x';
-                    }
-                    
-                    // convert pointer to hex
-                    uintptr_t num = (uintptr_t)ptr;
-                    char tmp[20];  // Enough for 64-bit pointer
-                    int tmplen = 0;
-                    
-                    if (num == 0) {
-                        tmp[tmplen++] = '0';
-                    } else {
-                        do {
-                            int digit = num % 16;
-                            tmp[tmplen++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
-                            num /= 16;
-                        } while(num && tmplen < (int)sizeof(tmp));
-                    }
-
-                    // reverse it and store in output
-                    for(int pos = tmplen - 1; pos >= 0 && p < end; pos--)
-                    {
-                        *p++ = tmp[pos];
-                    }
-                    break;
+                p = put_number(p, end, num, &spec);
+                fmt++;
+                continue;
+            }
+
+            case '%':
+                *p++ = '%';
+                fmt++;
+                continue;
+
+            case 'd':
+            case 'i':
+                spec.flags |= FMT_SIGNED;
+                switch (spec.length) {
+                    case FMT_LEN_LLONG: num = (uint64_t)va_arg(args, long long); break;
+                    case FMT_LEN_LONG:  num = (uint64_t)(int64_t)va_arg(args, long); break;
+                    case FMT_LEN_SIZE:  num = (uint64_t)(int64_t)(intptr_t)va_arg(args, size_t); break;
+                    default:            num = (uint64_t)(int64_t)va_arg(args, int); break;
                 }
-                case '%': {
-                    if(p < end) *p++ = '%';
-                    break;
+                break;
+
+            case 'X':
+                spec.flags |= FMT_UPPER;
+                /* fallthrough */
+            case 'x':
+                spec.base = 16;
+                /* fallthrough */
+            case 'u':
+                switch (spec.length) {
+                    case FMT_LEN_LLONG: num = va_arg(args, unsigned long long); break;
+                    case FMT_LEN_LONG:  num = va_arg(args, unsigned long); break;
+                    case FMT_LEN_SIZE:  num = va_arg(args, size_t); break;
+                    default:            num = va_arg(args, unsigned int); break;
                 }
-                default:
-                    if(p < end) *p++ = *fmt;  // Just copy unknown specifier
-            }
-        } else {
-            if(p < end) *p++ = *fmt;  // Copy normal character
+                break;
+
+            default:
+                *p++ = *fmt++;  // Just copy unknown specifier
+                continue;
         }
+
+        p = put_number(p, end, num, &spec);
         fmt++;
     }
     *p = '\0';
     return p - buf;  
 }
 
-int vprintk(const char* fmt, va_list args)
+/**
+ * snprintf on top of my_vsnprintf
+ */
+int my_snprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = my_vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return len;
+}
+
+static int vprintk(const char* fmt, va_list args, int to_console)
 {
     char tmp[LOG_BUF_SIZE];
     
@@ -295,17 +633,19 @@ int vprintk(const char* fmt, va_list args)
 
     ringbuf_write(tmp, len);
 
-    vga_print_string(tmp, WHITE_ON_BLACK);
+    if (to_console) {
+        console_write(console_sinks, tmp, WHITE_ON_BLACK);
+    }
 
     return len;
 }
 
 int printk(const char *fmt, ...)
 {
-    char tmp[LOG_BUF_SIZE];
     char level_prefix[32];
     const char* actual_fmt = fmt;
     int log_level_idx = -1;
+    int level = LOGLEVEL_DEFAULT;
     int total_len = 0;
 
     if (fmt[0] == '\001' && fmt[1] >= '0' && fmt[1] <= '7') {
@@ -313,9 +653,25 @@ int printk(const char *fmt, ...)
         if (idx >= 0) {
             log_level_idx = idx;
         }
+        level = fmt[1] - '0';
         actual_fmt = fmt + 2;
     }
 
+    int to_console = (level <= console_loglevel);
+    int nested;
+    uint32_t flags = log_lock_irqsave(&nested);
+
+#if CONFIG_PRINTK_TIME
+    // Stamp each new record in the ring: "[seconds.microseconds] "
+    if (rb_line_start) {
+        char stamp[32];
+        uint64_t secs = ktime_get_ns();
+        uint32_t ns = do_div_u64(&secs, 1000000000);
+        int stamp_len = my_snprintf(stamp, sizeof(stamp), "[%5llu.%06u] ", secs, ns / 1000);
+        ringbuf_write(stamp, stamp_len);
+    }
+#endif
+
     if (log_level_idx != -1) {
         // Build the level prefix: [LEVEL] 
         char *p = level_prefix;
@@ -335,15 +691,19 @@ int printk(const char *fmt, ...)
         
         // Write to ring buffer and console with colored prefix
         ringbuf_write(level_prefix, prefix_len);
-        vga_print_string(level_prefix, loglevels[log_level_idx].color);
+        if (to_console) {
+            console_write(console_sinks, level_prefix, loglevels[log_level_idx].color);
+        }
         total_len += prefix_len;
     }
 
     va_list args;
     va_start(args, fmt);
-    int msg_len = vprintk(actual_fmt, args);
+    int msg_len = vprintk(actual_fmt, args, to_console);
     va_end(args);
 
+    log_unlock_irqrestore(nested, flags);
+
     total_len += msg_len;
     return total_len;
 }
@@ -0,0 +1,204 @@
+#include "profile.h"
+#include "backtrace.h"
+#include "ksyms.h"
+#include "clock.h"
+#include "timer.h"
+#include "task.h"
+#include "printk.h"
+#include "console.h"
+#include "drivers/vga.h"
+
+struct profile_buffer profile_buffers[NR_CPUS];
+
+static struct timer_list profile_timers[NR_CPUS];
+static volatile int profile_enabled;
+static volatile int profile_paused;         // profile_dump() is reading the buffers
+static volatile uint32_t profile_flags;
+static volatile uint32_t profile_period_ns;
+
+static void profile_record(const interrupt_frame_t *frame)
+{
+    struct profile_buffer *buf = &profile_buffers[smp_processor_id()];
+
+    if (buf->count >= PROFILE_SAMPLES) {
+        buf->dropped++;
+        return;
+    }
+
+    struct profile_sample *sample = &buf->samples[buf->count];
+    sample->pc[0] = frame->eip;
+    sample->depth = 1;
+    if (profile_flags & PROFILE_CALLCHAIN) {
+        sample->depth += backtrace_capture(frame->ebp, &sample->pc[1], PROFILE_MAX_DEPTH - 1);
+    }
+    buf->count++;
+}
+
+/**
+ * Runs from the clock event interrupt, inside interrupt_dispatch(): the
+ * frame it keeps is the code this interrupt stopped.
+ */
+static void profile_timer_fn(struct timer_list *timer)
+{
+    if (!profile_enabled) {
+        return;
+    }
+
+    const interrupt_frame_t *frame = interrupt_current_frame();
+    if (frame && !profile_paused) {
+        profile_record(frame);
+    }
+
+    // Stay on the sampling grid, unless we fell a whole period behind
+    uint64_t next = timer->expires + profile_period_ns;
+    uint64_t now = ktime_get_ns();
+    if (next <= now) {
+        next = now + profile_period_ns;
+    }
+    timer_mod(timer, next);
+}
+
+// Arm the calling CPU's sampling timer (the wheels are per CPU)
+static void profile_arm(void)
+{
+    struct timer_list *timer = &profile_timers[smp_processor_id()];
+
+    if (!timer_pending(timer)) {
+        timer_setup(timer, profile_timer_fn, NULL);
+        timer_mod(timer, ktime_get_ns() + profile_period_ns);
+    }
+}
+
+static void profile_arm_fn(void *arg)
+{
+    (void)arg;
+    profile_arm();
+}
+
+void profile_start(uint32_t hz, uint32_t flags)
+{
+    struct clock_event_device *dev = clockevent_get();
+
+    if (!dev) {
+        pr_warn("[PROFILE] No clock event device, not sampling\n");
+        return;
+    }
+    if (hz == 0) {
+        hz = 1;
+    } else if (hz > PROFILE_MAX_HZ) {
+        hz = PROFILE_MAX_HZ;
+    }
+
+    profile_period_ns = (uint32_t)NSEC_PER_SEC / hz;
+    profile_flags = flags;
+    __atomic_store_n(&profile_enabled, 1, __ATOMIC_RELEASE);
+
+    int self = smp_processor_id();
+    int cpus = 1;
+    profile_arm();
+
+    // A shared tick device (PIT) only interrupts the boot CPU
+    if (dev->features & CLOCK_EVT_FEAT_PERCPU) {
+        for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+            if (cpu != self && sched_cpu_active(cpu) &&
+                kthread_create_on_cpu(profile_arm_fn, NULL, "profile", cpu)) {
+                cpus++;
+            }
+        }
+    }
+    pr_info("[PROFILE] Sampling %d CPU(s) at %u Hz%s\n",
+            cpus, hz, (flags & PROFILE_CALLCHAIN) ? " with call chains" : "");
+}
+
+void profile_stop(void)
+{
+    __atomic_store_n(&profile_enabled, 0, __ATOMIC_RELEASE);
+}
+
+void profile_reset(void)
+{
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        profile_buffers[cpu].count = 0;
+        profile_buffers[cpu].dropped = 0;
+    }
+}
+
+static int profile_sample_equal(const struct profile_sample *a, const struct profile_sample *b)
+{
+    if (a->depth != b->depth) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->depth; i++) {
+        if (a->pc[i] != b->pc[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * "cpu0;outermost;...;innermost": pc[0] is the interrupted instruction,
+ * the rest are return addresses and are looked up one byte back (see
+ * backtrace.h).
+ */
+static void profile_fold(char *buf, size_t size, int cpu, const struct profile_sample *sample)
+{
+    size_t len = my_snprintf(buf, size, "cpu%d", cpu);
+
+    for (uint32_t i = sample->depth; i-- > 0 && len < size;) {
+        uint32_t addr = sample->pc[i];
+        const char *name = ksym_lookup(i ? addr - 1 : addr, NULL);
+
+        if (name) {
+            len += my_snprintf(buf + len, size - len, ";%s", name);
+        } else {
+            len += my_snprintf(buf + len, size - len, ";0x%08x", addr);
+        }
+    }
+}
+
+/**
+ * Identical stacks are merged with a quadratic scan; a dump is rare and a
+ * buffer holds at most PROFILE_SAMPLES samples. Sampling is paused while
+ * dumping so the buffers do not move under us.
+ */
+void profile_dump(int sinks)
+{
+    static uint8_t printed[PROFILE_SAMPLES];
+    char stack[384];
+    char line[416];
+
+    __atomic_store_n(&profile_paused, 1, __ATOMIC_SEQ_CST);
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct profile_buffer *buf = &profile_buffers[cpu];
+        if (buf->count == 0 && buf->dropped == 0) {
+            continue;
+        }
+
+        pr_info("[PROFILE] cpu%d: %u samples (%u dropped)\n", cpu, buf->count, buf->dropped);
+
+        for (uint32_t i = 0; i < buf->count; i++) {
+            printed[i] = 0;
+        }
+        for (uint32_t i = 0; i < buf->count; i++) {
+            if (printed[i]) {
+                continue;
+            }
+
+            uint32_t hits = 1;
+            for (uint32_t j = i + 1; j < buf->count; j++) {
+                if (!printed[j] && profile_sample_equal(&buf->samples[i], &buf->samples[j])) {
+                    printed[j] = 1;
+                    hits++;
+                }
+            }
+
+            profile_fold(stack, sizeof(stack), cpu, &buf->samples[i]);
+            my_snprintf(line, sizeof(line), "PROFILE %s %u\n", stack, hits);
+            console_write(sinks, line, WHITE_ON_BLACK);
+        }
+    }
+
+    __atomic_store_n(&profile_paused, 0, __ATOMIC_RELEASE);
+}
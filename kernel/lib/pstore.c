@@ -0,0 +1,220 @@
+#include "pstore.h"
+#include "printk.h"
+#include "console.h"
+#include "drivers/vga.h"
+#include "arch/x86/tss.h"
+#include "backtrace.h"
+#include <stddef.h>
+
+static struct pstore_record* const pstore = (struct pstore_record*)PSTORE_ADDR;
+
+/**
+ * FNV-1a over the record. The magic (which changes once the record has
+ * been reported) is not covered and the checksum field counts as zero.
+ */
+static uint32_t pstore_checksum(const struct pstore_record *rec, uint32_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)rec;
+    const size_t csum_off = offsetof(struct pstore_record, checksum);
+    uint32_t hash = 0x811c9dc5;
+
+    for (uint32_t i = offsetof(struct pstore_record, version); i < size; i++) {
+        uint8_t b = (i >= csum_off && i < csum_off + sizeof(uint32_t)) ? 0 : bytes[i];
+        hash ^= b;
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static int pstore_valid(void)
+{
+    if (pstore->magic != PSTORE_MAGIC && pstore->magic != PSTORE_MAGIC_SEEN) {
+        return 0;
+    }
+    if (pstore->version != PSTORE_VERSION || pstore->size > PSTORE_SIZE ||
+        pstore->size < sizeof(struct pstore_record) || pstore->log_len > PSTORE_LOG_SIZE) {
+        return 0;
+    }
+    return pstore_checksum(pstore, pstore->size) == pstore->checksum;
+}
+
+static void pstore_read_cr(struct pstore_regs *regs)
+{
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(regs->cr0));
+    __asm__ __volatile__("mov %%cr2, %0" : "=r"(regs->cr2));
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(regs->cr3));
+}
+
+void pstore_save(pstore_reason_t reason, const char *message, const struct pstore_regs *regs)
+{
+    uint32_t crash_count = pstore_valid() ? pstore->crash_count + 1 : 1;
+    struct pstore_regs snap;
+
+    // Invalidate first: a crash while saving must not leave a half record marked valid
+    pstore->magic = 0;
+
+    if (!regs) {
+        __asm__ __volatile__(
+            "mov %%eax, %0\n"
+            "mov %%ebx, %1\n"
+            "mov %%ecx, %2\n"
+            "mov %%edx, %3\n"
+            : "=m"(snap.eax), "=m"(snap.ebx), "=m"(snap.ecx), "=m"(snap.edx));
+        __asm__ __volatile__(
+            "mov %%esi, %0\n"
+            "mov %%edi, %1\n"
+            "mov %%esp, %2\n"
+            "pushf\n"
+            "pop %3\n"
+            : "=m"(snap.esi), "=m"(snap.edi), "=m"(snap.esp), "=r"(snap.eflags));
+        __asm__ __volatile__("mov %%cs, %0" : "=r"(snap.cs));
+        __asm__ __volatile__("mov %%ds, %0" : "=r"(snap.ds));
+        __asm__ __volatile__("mov %%ss, %0" : "=r"(snap.ss));
+        snap.cs &= 0xFFFF;
+        snap.ds &= 0xFFFF;
+        snap.ss &= 0xFFFF;
+        snap.ebp = (uint32_t)__builtin_frame_address(0);
+        snap.eip = (uint32_t)__builtin_return_address(0);
+        pstore_read_cr(&snap);
+        regs = &snap;
+    }
+
+    pstore->version = PSTORE_VERSION;
+    pstore->reason = reason;
+    pstore->crash_count = crash_count;
+    pstore->regs = *regs;
+    pstore->bt_depth = backtrace_capture(regs->ebp, pstore->backtrace, PSTORE_BT_MAX);
+
+    // Message (always NUL terminated)
+    uint32_t i = 0;
+    if (message) {
+        for (; message[i] && i < PSTORE_MSG_SIZE - 1; i++) {
+            pstore->message[i] = message[i];
+        }
+    }
+    pstore->message[i] = '\0';
+
+    // Tail of the printk ring, record by record
+    struct log_iter it;
+    uint32_t len = 0;
+    log_iter_init_tail(&it, PSTORE_LOG_SIZE - 1);
+    while (len < PSTORE_LOG_SIZE - 1) {
+        size_t n = log_iter_next(&it, pstore->log + len, PSTORE_LOG_SIZE - len);
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    pstore->log[len] = '\0';
+    pstore->log_len = len;
+
+    pstore->size = sizeof(struct pstore_record) + len + 1;
+    pstore->checksum = pstore_checksum(pstore, pstore->size);
+    pstore->magic = PSTORE_MAGIC;
+}
+
+/**
+ * Runs on the double fault task's stack. The CPU saved the interrupted
+ * kernel task into tss_main during the task switch; CR2 still holds the
+ * last page fault address.
+ */
+void pstore_save_double_fault(void)
+{
+    // The #DF task runs with this CPU's %fs, so this is the CPU that faulted
+    const struct tss_entry *kt = &tss_main[smp_processor_id()];
+    struct pstore_regs regs = {
+        .eax = kt->eax, .ebx = kt->ebx, .ecx = kt->ecx, .edx = kt->edx,
+        .esi = kt->esi, .edi = kt->edi, .ebp = kt->ebp, .esp = kt->esp,
+        .eip = kt->eip, .eflags = kt->eflags,
+        .cs = kt->cs, .ds = kt->ds, .ss = kt->ss,
+        .cr3 = kt->cr3,
+    };
+    uint32_t cr0, cr2;
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ __volatile__("mov %%cr2, %0" : "=r"(cr2));
+    regs.cr0 = cr0;
+    regs.cr2 = cr2;
+
+    pstore_save(PSTORE_REASON_DOUBLE_FAULT, "double fault", &regs);
+}
+
+static const char* pstore_reason_str(uint32_t reason)
+{
+    switch (reason) {
+        case PSTORE_REASON_PANIK:           return "panik";
+        case PSTORE_REASON_DOUBLE_FAULT:    return "double fault";
+        default:                            return "unknown";
+    }
+}
+
+void pstore_dump(int sinks)
+{
+    char line[LOG_LINE_MAX];
+    const struct pstore_regs *r = &pstore->regs;
+
+    if (!pstore_valid()) {
+        console_write(sinks, "[PSTORE] No crash record\n", WHITE_ON_BLACK);
+        return;
+    }
+
+    my_snprintf(line, sizeof(line), "[PSTORE] Crash #%u: %s: %s\n",
+                pstore->crash_count, pstore_reason_str(pstore->reason), pstore->message);
+    console_write(sinks, line, VGA_COLOR(VGA_BLACK, VGA_LIGHT_RED));
+    my_snprintf(line, sizeof(line), "  eax=%08x ebx=%08x ecx=%08x edx=%08x\n", r->eax, r->ebx, r->ecx, r->edx);
+    console_write(sinks, line, WHITE_ON_BLACK);
+    my_snprintf(line, sizeof(line), "  esi=%08x edi=%08x ebp=%08x esp=%08x\n", r->esi, r->edi, r->ebp, r->esp);
+    console_write(sinks, line, WHITE_ON_BLACK);
+    my_snprintf(line, sizeof(line), "  eip=%08x efl=%08x cs=%04x ds=%04x ss=%04x\n", r->eip, r->eflags, r->cs, r->ds, r->ss);
+    console_write(sinks, line, WHITE_ON_BLACK);
+    my_snprintf(line, sizeof(line), "  cr0=%08x cr2=%08x cr3=%08x\n", r->cr0, r->cr2, r->cr3);
+    console_write(sinks, line, WHITE_ON_BLACK);
+
+    console_write(sinks, "  Backtrace:\n", WHITE_ON_BLACK);
+    backtrace_print(sinks, pstore->backtrace, pstore->bt_depth < PSTORE_BT_MAX ? pstore->bt_depth : PSTORE_BT_MAX);
+
+    my_snprintf(line, sizeof(line), "  Last %u bytes of the kernel log:\n", pstore->log_len);
+    console_write(sinks, line, WHITE_ON_BLACK);
+    console_write(sinks, pstore->log, WHITE_ON_BLACK);
+    console_write(sinks, "[PSTORE] End of crash record\n", WHITE_ON_BLACK);
+}
+
+/**
+ * Report a record left by the previous boot once: the summary (registers,
+ * backtrace) goes to the screen, the full record including the log tail
+ * goes to the serial port.
+ */
+void pstore_init(void)
+{
+    extern char kernel_start;
+    extern char kernel_end;
+
+    if ((uint32_t)&kernel_start < PSTORE_ADDR + PSTORE_SIZE && (uint32_t)&kernel_end > PSTORE_ADDR) {
+        pr_err("[PSTORE] Kernel image overlaps the crash region at 0x%x, disabled\n", PSTORE_ADDR);
+        return;
+    }
+
+    if (!pstore_valid()) {
+        printk("[PSTORE] No crash record from the previous boot\n");
+        return;
+    }
+
+    if (pstore->magic == PSTORE_MAGIC_SEEN) {
+        printk("[PSTORE] Crash record #%u already reported\n", pstore->crash_count);
+        return;
+    }
+
+    const struct pstore_regs *r = &pstore->regs;
+    pr_alert("[PSTORE] Previous boot crashed (#%u): %s: %s\n",
+             pstore->crash_count, pstore_reason_str(pstore->reason), pstore->message);
+    pr_alert("[PSTORE] eip=0x%08x esp=0x%08x ebp=0x%08x cr2=0x%08x\n", r->eip, r->esp, r->ebp, r->cr2);
+    for (uint32_t i = 0; i < pstore->bt_depth && i < PSTORE_BT_MAX; i++) {
+        char line[128];
+        backtrace_format(line, sizeof(line), i, pstore->backtrace[i]);
+        printk("[PSTORE] %s", line);
+    }
+
+    pstore_dump(CONSOLE_SERIAL);
+
+    // Mark as reported (the magic is not covered by the checksum)
+    pstore->magic = PSTORE_MAGIC_SEEN;
+}
@@ -0,0 +1,46 @@
+#include "spinlock.h"
+#include "printk.h"
+#include "arch/x86/div64.h"
+
+// Every lock taken at least once (CONFIG_LOCK_STAT only)
+static struct lock_stat *lock_stat_list;
+
+void lock_stat_register(struct lock_stat *stat)
+{
+    stat->registered = 1;
+    stat->next = __atomic_load_n(&lock_stat_list, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&lock_stat_list, &stat->next, stat, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        cpu_relax();
+    }
+}
+
+void lock_stat_dump(void)
+{
+#if CONFIG_LOCK_STAT
+    printk("%-20s %10s %10s %14s\n", "lock", "acquired", "contended", "avg wait cyc");
+    for (struct lock_stat *stat = __atomic_load_n(&lock_stat_list, __ATOMIC_ACQUIRE);
+         stat; stat = stat->next) {
+        uint64_t avg = stat->spin_cycles;
+        if (stat->contended) {
+            do_div_u64(&avg, stat->contended);
+        }
+        printk("%-20s %10u %10u %14llu\n", stat->name ? stat->name : "?",
+               stat->acquisitions, stat->contended, avg);
+    }
+#else
+    printk("[LOCK] Lock statistics need CONFIG_LOCK_STAT=1\n");
+#endif
+}
+
+// Counters may be mid-update by a holder on another CPU; good enough for
+// starting a measurement
+void lock_stat_reset(void)
+{
+    for (struct lock_stat *stat = __atomic_load_n(&lock_stat_list, __ATOMIC_ACQUIRE);
+         stat; stat = stat->next) {
+        stat->acquisitions = 0;
+        stat->contended = 0;
+        stat->spin_cycles = 0;
+    }
+}
@@ -0,0 +1,330 @@
+#include "timer.h"
+#include "clock.h"
+#include "smp.h"
+#include "trace.h"
+
+struct timer_base {
+    uint64_t clk;                               // Next wheel unit to process
+    uint64_t next_expiry;                       // Earliest programmed bucket (unit)
+    uint64_t pending_map[TIMER_LVL_DEPTH];      // Bit per non-empty bucket
+    struct timer_list *vectors[TIMER_WHEEL_SIZE];
+};
+
+static struct timer_base timer_bases[NR_CPUS];
+struct timer_stats timer_stats[NR_CPUS];
+
+static inline struct timer_base* this_timer_base(void)
+{
+    return &timer_bases[smp_processor_id()];
+}
+
+static inline uint64_t ns_to_units(uint64_t ns)
+{
+    return ns >> TIMER_CLK_SHIFT;
+}
+
+static inline uint64_t units_to_ns(uint64_t units)
+{
+    return units << TIMER_CLK_SHIFT;
+}
+
+// Index of the lowest set bit; 64-bit variant without libgcc
+static inline int ffs64(uint64_t map)
+{
+    uint32_t lo = (uint32_t)map;
+    if (lo) {
+        return __builtin_ctz(lo);
+    }
+    return 32 + __builtin_ctz((uint32_t)(map >> 32));
+}
+
+/**
+ * Bucket for `expires` at level `lvl`. Expiry is rounded up to the next
+ * bucket boundary so a timer never fires early.
+ */
+static inline unsigned int calc_index(uint64_t expires, unsigned int lvl, uint64_t *bucket_expiry)
+{
+    expires = (expires >> TIMER_LVL_SHIFT(lvl)) + 1;
+    *bucket_expiry = expires << TIMER_LVL_SHIFT(lvl);
+    return TIMER_LVL_OFFS(lvl) + (expires & TIMER_LVL_MASK);
+}
+
+static unsigned int calc_wheel_index(uint64_t expires, uint64_t clk, uint64_t *bucket_expiry)
+{
+    if (expires < clk) {
+        // Already due: first bucket the next run looks at
+        *bucket_expiry = clk;
+        return clk & TIMER_LVL_MASK;
+    }
+
+    uint64_t delta = expires - clk;
+    for (unsigned int lvl = 0; lvl < TIMER_LVL_DEPTH - 1; lvl++) {
+        if (delta < TIMER_LVL_START(lvl + 1)) {
+            return calc_index(expires, lvl, bucket_expiry);
+        }
+    }
+
+    if (delta >= TIMER_WHEEL_CUTOFF) {
+        expires = clk + TIMER_WHEEL_MAX;
+    }
+    return calc_index(expires, TIMER_LVL_DEPTH - 1, bucket_expiry);
+}
+
+/**
+ * Distance (in level buckets) from `clk` to the next pending bucket of a
+ * level, wrapping around; -1 if the level is empty.
+ */
+static int next_pending_bucket(struct timer_base *base, unsigned int lvl, unsigned int clk)
+{
+    uint64_t map = base->pending_map[lvl];
+    uint64_t upper = map >> clk;
+
+    if (upper) {
+        return ffs64(upper);
+    }
+    uint64_t lower = clk ? (map & ((1ULL << clk) - 1)) : 0;
+    if (lower) {
+        return ffs64(lower) + TIMER_LVL_SIZE - clk;
+    }
+    return -1;
+}
+
+/**
+ * Wheel unit at which the earliest pending bucket will be collected.
+ * A level n bucket is only looked at when the lower levels wrap, which is
+ * why the clock is rounded up when moving to the next level.
+ */
+static uint64_t next_timer_unit(struct timer_base *base)
+{
+    uint64_t clk = base->clk;
+    uint64_t next = TIMER_NEVER;
+
+    for (unsigned int lvl = 0; lvl < TIMER_LVL_DEPTH; lvl++) {
+        int pos = next_pending_bucket(base, lvl, clk & TIMER_LVL_MASK);
+        unsigned int lvl_clk = clk & TIMER_LVL_CLK_MASK;
+
+        if (pos >= 0) {
+            uint64_t tmp = (clk + pos) << TIMER_LVL_SHIFT(lvl);
+            if (tmp < next) {
+                next = tmp;
+            }
+            // Expires before this level's clock reaches the next level:
+            // nothing further up can be earlier
+            if ((unsigned int)pos <= ((TIMER_LVL_CLK_DIV - lvl_clk) & TIMER_LVL_CLK_MASK)) {
+                break;
+            }
+        }
+
+        clk >>= TIMER_LVL_CLK_SHIFT;
+        clk += lvl_clk ? 1 : 0;
+    }
+    return next;
+}
+
+static void program_next_event(struct timer_base *base)
+{
+    base->next_expiry = next_timer_unit(base);
+    if (base->next_expiry != TIMER_NEVER) {
+        clockevent_program(units_to_ns(base->next_expiry));
+    }
+    // Nothing pending: the one-shot device has fired and stays quiet
+}
+
+static void enqueue_timer(struct timer_base *base, struct timer_list *timer)
+{
+    uint64_t now = ns_to_units(ktime_get_ns());
+
+    // After an idle stretch the base clock lags behind; catch it up when
+    // nothing is due, so the new timer lands in the finest possible level
+    if (base->next_expiry > now && now > base->clk) {
+        base->clk = now;
+    }
+
+    uint64_t bucket_expiry;
+    unsigned int idx = calc_wheel_index(ns_to_units(timer->expires), base->clk, &bucket_expiry);
+
+    struct timer_list **head = &base->vectors[idx];
+    timer->next = *head;
+    if (*head) {
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+    timer->idx = idx;
+    base->pending_map[idx / TIMER_LVL_SIZE] |= 1ULL << (idx % TIMER_LVL_SIZE);
+
+    if (bucket_expiry < base->next_expiry) {
+        base->next_expiry = bucket_expiry;
+        clockevent_program(units_to_ns(bucket_expiry));
+    }
+}
+
+static void detach_timer(struct timer_base *base, struct timer_list *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    if (!base->vectors[timer->idx]) {
+        base->pending_map[timer->idx / TIMER_LVL_SIZE] &= ~(1ULL << (timer->idx % TIMER_LVL_SIZE));
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+    // next_expiry may now be early; that costs one empty interrupt at most
+}
+
+void timer_init(void)
+{
+    struct timer_base *base = this_timer_base();
+
+    for (int i = 0; i < TIMER_WHEEL_SIZE; i++) {
+        base->vectors[i] = NULL;
+    }
+    for (int lvl = 0; lvl < TIMER_LVL_DEPTH; lvl++) {
+        base->pending_map[lvl] = 0;
+    }
+    base->clk = ns_to_units(ktime_get_ns());
+    base->next_expiry = TIMER_NEVER;
+}
+
+void timer_setup(struct timer_list *timer, void (*fn)(struct timer_list *), void *data)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+    timer->idx = 0;
+}
+
+void timer_add(struct timer_list *timer)
+{
+    uint32_t flags = irq_save();
+    enqueue_timer(this_timer_base(), timer);
+    irq_restore(flags);
+}
+
+int timer_mod(struct timer_list *timer, uint64_t expires)
+{
+    uint32_t flags = irq_save();
+    struct timer_base *base = this_timer_base();
+    int was_pending = timer_pending(timer);
+
+    if (was_pending) {
+        detach_timer(base, timer);
+    }
+    timer->expires = expires;
+    enqueue_timer(base, timer);
+
+    irq_restore(flags);
+    return was_pending;
+}
+
+int timer_del(struct timer_list *timer)
+{
+    uint32_t flags = irq_save();
+    int was_pending = timer_pending(timer);
+
+    if (was_pending) {
+        detach_timer(this_timer_base(), timer);
+    }
+
+    irq_restore(flags);
+    return was_pending;
+}
+
+uint64_t timer_next_expiry(void)
+{
+    uint32_t flags = irq_save();
+    uint64_t next = next_timer_unit(this_timer_base());
+    irq_restore(flags);
+    return next == TIMER_NEVER ? TIMER_NEVER : units_to_ns(next);
+}
+
+/**
+ * Move every bucket due at base->clk onto the `expired` list: level 0
+ * always, each higher level only when all the levels below it wrap at
+ * this clk. Collected timers stay pending (linked into `expired`) until
+ * they run, so a callback can still timer_del() one of its siblings.
+ */
+static void collect_expired_timers(struct timer_base *base, struct timer_list **expired)
+{
+    uint64_t clk = base->clk;
+
+    for (unsigned int lvl = 0; lvl < TIMER_LVL_DEPTH; lvl++) {
+        unsigned int idx = TIMER_LVL_OFFS(lvl) + (clk & TIMER_LVL_MASK);
+        uint64_t bit = 1ULL << (idx % TIMER_LVL_SIZE);
+
+        if (base->pending_map[lvl] & bit) {
+            base->pending_map[lvl] &= ~bit;
+
+            // Splice the whole bucket in front of the list
+            struct timer_list *first = base->vectors[idx];
+            struct timer_list *last = first;
+            while (last->next) {
+                last = last->next;
+            }
+            base->vectors[idx] = NULL;
+
+            last->next = *expired;
+            if (*expired) {
+                (*expired)->pprev = &last->next;
+            }
+            *expired = first;
+            first->pprev = expired;
+        }
+
+        if (clk & TIMER_LVL_CLK_MASK) {
+            break;
+        }
+        clk >>= TIMER_LVL_CLK_SHIFT;
+    }
+}
+
+static void run_timers(struct timer_base *base, uint64_t now)
+{
+    struct timer_stats *stats = &timer_stats[smp_processor_id()];
+    struct timer_list *expired = NULL;
+    int ran = 0;
+
+    while (base->clk <= now) {
+        // Jump over empty units instead of walking them one by one
+        uint64_t next = next_timer_unit(base);
+        if (next > now) {
+            base->clk = now + 1;
+            break;
+        }
+        base->clk = next;
+
+        collect_expired_timers(base, &expired);
+        base->clk++;
+
+        while (expired) {
+            struct timer_list *t = expired;
+            expired = t->next;
+            if (expired) {
+                expired->pprev = &expired;
+            }
+            t->next = NULL;
+            t->pprev = NULL;
+
+            trace_event("timer expire fn=%p late=%u ns", t->fn, (uint32_t)(ktime_get_ns() - t->expires));
+            t->fn(t);
+            stats->expired++;
+            ran++;
+        }
+    }
+
+    if (!ran) {
+        stats->early_wakeups++;
+    }
+}
+
+void timer_interrupt(void)
+{
+    struct timer_base *base = this_timer_base();
+
+    timer_stats[smp_processor_id()].interrupts++;
+    run_timers(base, ns_to_units(ktime_get_ns()));
+    program_next_event(base);
+}
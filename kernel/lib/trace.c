@@ -0,0 +1,88 @@
+#include "trace.h"
+#include "printk.h"
+#include "console.h"
+#include "drivers/vga.h"
+#include <stdarg.h>
+
+struct trace_ring trace_rings[NR_CPUS];
+volatile int trace_enabled = 1;
+
+void trace_start(void)
+{
+    trace_enabled = 1;
+}
+
+void trace_stop(void)
+{
+    trace_enabled = 0;
+}
+
+/**
+ * Drop all recorded events
+ */
+void trace_reset(void)
+{
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        trace_rings[cpu].head = 0;
+        for (int i = 0; i < TRACE_RING_ENTRIES; i++) {
+            trace_rings[cpu].rec[i].fmt = 0;
+        }
+    }
+}
+
+/**
+ * Format one record. The stored arguments are passed through a real varargs
+ * call so my_vsnprintf sees them exactly like a printk() would.
+ */
+int trace_format(char *buf, size_t size, const struct trace_record *rec)
+{
+    return my_snprintf(buf, size, rec->fmt, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+}
+
+/**
+ * Dump the rings oldest first. Timestamps are printed as TSC cycles relative
+ * to the first dumped record of each CPU.
+ * Tracing is paused while dumping so the records do not move under us.
+ */
+void trace_dump(int sinks)
+{
+    char line[160];
+    char msg[128];
+    int was_enabled = trace_enabled;
+
+    trace_stop();
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct trace_ring *ring = &trace_rings[cpu];
+        uint32_t head = ring->head;
+        if (head == 0) {
+            continue;
+        }
+
+        uint32_t count = head < TRACE_RING_ENTRIES ? head : TRACE_RING_ENTRIES;
+        uint32_t first = head - count;
+        uint64_t base_tsc = 0;
+
+        my_snprintf(line, sizeof(line), "--- trace cpu%d: %u events (%u lost) ---\n",
+                    cpu, count, head - count);
+        console_write(sinks, line, WHITE_ON_BLACK);
+
+        for (uint32_t i = first; i != head; i++) {
+            const struct trace_record *rec = &ring->rec[i & (TRACE_RING_ENTRIES - 1)];
+            if (!rec->fmt) {
+                continue;       // Slot was being written when tracing stopped
+            }
+            if (!base_tsc) {
+                base_tsc = rec->tsc;
+            }
+
+            trace_format(msg, sizeof(msg), rec);
+            my_snprintf(line, sizeof(line), "[%d] +%10llu %s\n", cpu, rec->tsc - base_tsc, msg);
+            console_write(sinks, line, WHITE_ON_BLACK);
+        }
+    }
+
+    if (was_enabled) {
+        trace_start();
+    }
+}
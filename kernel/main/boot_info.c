@@ -0,0 +1,163 @@
+#include <stddef.h>
+#include "boot_info.h"
+#include "multiboot.h"
+#include "printk.h"
+
+// Field offsets stage2.asm writes to (BI_* there)
+_Static_assert(offsetof(struct boot_info, flags) == 8, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, kernel_start) == 12, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, mmap_addr) == 20, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, boot_drive) == 28, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, acpi_rsdp) == 36, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, fb) == 44, "boot_info layout");
+_Static_assert(offsetof(struct boot_info, tsc_stage2) == 68, "boot_info layout");
+_Static_assert(sizeof(struct boot_info) == 92, "boot_info layout");
+
+struct boot_info boot_info;
+
+// Kernel copies of what the loader left in its own memory
+static e820_entry_t boot_mmap[E820_MAX_ENTRIES];
+static char boot_cmdline[BOOT_CMDLINE_MAX];
+
+static void boot_mmap_add(uint64_t base, uint64_t length, uint32_t type)
+{
+    if (boot_info.mmap_count < E820_MAX_ENTRIES) {
+        boot_mmap[boot_info.mmap_count++] = (e820_entry_t){
+            .base = base,
+            .length = length,
+            .type = type,
+        };
+    }
+}
+
+static void boot_cmdline_copy(const char *src)
+{
+    uint32_t i = 0;
+    for (; i < BOOT_CMDLINE_MAX - 1 && src[i]; i++) {
+        boot_cmdline[i] = src[i];
+    }
+    boot_cmdline[i] = '\0';
+    boot_info.cmdline = (uint32_t)boot_cmdline;
+    boot_info.flags |= BOOT_INFO_CMDLINE;
+}
+
+static void boot_info_from_stage2(const struct boot_info *bi)
+{
+    // Fields the loader does not know about stay zero
+    uint32_t size = bi->size < sizeof(boot_info) ? bi->size : sizeof(boot_info);
+    const uint8_t *src = (const uint8_t*)bi;
+    uint8_t *dst = (uint8_t*)&boot_info;
+    for (uint32_t i = 0; i < size; i++) {
+        dst[i] = src[i];
+    }
+    boot_info.size = sizeof(boot_info);
+
+    uint32_t flags = boot_info.flags;
+    boot_info.flags &= ~(BOOT_INFO_MMAP | BOOT_INFO_CMDLINE);
+    boot_info.mmap_count = 0;
+    boot_info.mmap_addr = (uint32_t)boot_mmap;
+    boot_info.cmdline = 0;
+
+    if (flags & BOOT_INFO_MMAP) {
+        const e820_entry_t *map = (const e820_entry_t*)bi->mmap_addr;
+        for (uint32_t i = 0; i < bi->mmap_count; i++) {
+            boot_mmap_add(map[i].base, map[i].length, map[i].type);
+        }
+        boot_info.flags |= BOOT_INFO_MMAP;
+    }
+    if ((flags & BOOT_INFO_CMDLINE) && bi->cmdline) {
+        boot_cmdline_copy((const char*)bi->cmdline);
+    }
+}
+
+static void boot_info_from_multiboot(const multiboot_info_t *mb)
+{
+    extern char kernel_start;
+    extern char kernel_end;
+
+    boot_info.magic = BOOT_INFO_MAGIC;
+    boot_info.version = BOOT_INFO_VERSION;
+    boot_info.size = sizeof(boot_info);
+    boot_info.mmap_addr = (uint32_t)boot_mmap;
+
+    // The loader placed the ELF segments where the linker script says
+    boot_info.kernel_start = (uint32_t)&kernel_start;
+    boot_info.kernel_end = (uint32_t)&kernel_end;
+    boot_info.flags |= BOOT_INFO_KERNEL_RANGE;
+
+    if (mb->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t addr = mb->mmap_addr;
+        while (addr < mb->mmap_addr + mb->mmap_length) {
+            const multiboot_mmap_entry_t *entry = (const multiboot_mmap_entry_t*)addr;
+            boot_mmap_add(entry->base, entry->length, entry->type);
+            addr += entry->size + sizeof(entry->size);
+        }
+        boot_info.flags |= BOOT_INFO_MMAP;
+    } else if (mb->flags & MULTIBOOT_INFO_MEMORY) {
+        // Only the two classic sizes: conventional memory and memory above 1MiB
+        boot_mmap_add(0, (uint64_t)mb->mem_lower * 1024, E820_TYPE_AVAILABLE);
+        boot_mmap_add(0x100000, (uint64_t)mb->mem_upper * 1024, E820_TYPE_AVAILABLE);
+        boot_info.flags |= BOOT_INFO_MMAP;
+    }
+
+    if (mb->flags & MULTIBOOT_INFO_BOOTDEV) {
+        boot_info.boot_drive = mb->boot_device >> 24;
+        boot_info.flags |= BOOT_INFO_BOOT_DRIVE;
+    }
+
+    if ((mb->flags & MULTIBOOT_INFO_CMDLINE) && mb->cmdline) {
+        boot_cmdline_copy((const char*)mb->cmdline);
+    }
+
+    if (mb->flags & MULTIBOOT_INFO_FRAMEBUFFER) {
+        boot_info.fb = (struct boot_framebuffer){
+            .addr = mb->framebuffer_addr,
+            .pitch = mb->framebuffer_pitch,
+            .width = mb->framebuffer_width,
+            .height = mb->framebuffer_height,
+            .bpp = mb->framebuffer_bpp,
+            .type = mb->framebuffer_type,
+        };
+        boot_info.flags |= BOOT_INFO_FRAMEBUFFER;
+    }
+}
+
+int boot_info_init(uint32_t magic, uint32_t addr)
+{
+    if (magic == BOOT_INFO_MAGIC && ((const struct boot_info*)addr)->magic == BOOT_INFO_MAGIC) {
+        boot_info_from_stage2((const struct boot_info*)addr);
+        return 0;
+    }
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC) {
+        boot_info_from_multiboot((const multiboot_info_t*)addr);
+        return 0;
+    }
+    return -1;
+}
+
+void boot_info_print(void)
+{
+    printk("[BOOT] boot_info v%u, flags 0x%x\n", boot_info.version, boot_info.flags);
+    if (boot_info.flags & BOOT_INFO_KERNEL_RANGE) {
+        printk("[BOOT] Kernel: 0x%08x - 0x%08x\n", boot_info.kernel_start, boot_info.kernel_end);
+    }
+    if (boot_info.flags & BOOT_INFO_MMAP) {
+        printk("[BOOT] Memory map: %u entries\n", boot_info.mmap_count);
+    }
+    if (boot_info.flags & BOOT_INFO_BOOT_DRIVE) {
+        printk("[BOOT] Boot drive: 0x%02x\n", boot_info.boot_drive);
+    }
+    if (boot_info.flags & BOOT_INFO_VIDEO_MODE) {
+        printk("[BOOT] Video mode: 0x%02x\n", boot_info.video_mode);
+    }
+    if (boot_info.flags & BOOT_INFO_FRAMEBUFFER) {
+        printk("[BOOT] Framebuffer: 0x%08llx %ux%u, %u bpp, type %u\n", boot_info.fb.addr,
+               boot_info.fb.width, boot_info.fb.height, boot_info.fb.bpp, boot_info.fb.type);
+    }
+    if (boot_info.flags & BOOT_INFO_ACPI_RSDP) {
+        printk("[BOOT] ACPI RSDP: 0x%08x\n", boot_info.acpi_rsdp);
+    }
+    if (boot_info.flags & BOOT_INFO_CMDLINE) {
+        printk("[BOOT] Command line: %s\n", (const char*)boot_info.cmdline);
+    }
+}
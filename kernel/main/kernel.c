@@ -7,18 +7,6 @@
 // =================================================================
 // DEBUG Start
 // =================================================================
-void check_double_fault_breadcrumbs() {
-    uint32_t *magic1 = (uint32_t*)0x15000;
-    uint32_t *magic2 = (uint32_t*)0x15004;
-    uint32_t *magic3 = (uint32_t*)0x15008;
-    
-    printk("Checking double fault breadcrumbs:\n");
-    printk("  Magic1 (0x15000): 0x%08x %s\n", *magic1, (*magic1 == 0xDEADBEEF) ? "(FOUND)" : "(not found)");
-    printk("  Magic2 (0x15004): 0x%08x %s\n", *magic2, (*magic2 == 0xCAFEBABE) ? "(FOUND)" : "(not found)");
-    printk("  Magic3 (0x15008): 0x%08x %s\n", *magic3, (*magic3 == 0x12345678) ? "(FOUND)" : "(not found)");
-}
-
-
 void debug_idt_entry(int num) {
     extern idt_entry_t idt[IDT_ENTRIES];
     
@@ -40,33 +28,37 @@ void debug_idt_entry(int num) {
 }
 
 void debug_gdt_entry(int num) {
-    extern struct gdt_entry gdt[4];
-    
+    struct gdt_entry *table = gdt[0];   // Boot CPU
+
     printk("GDT Entry %d:\n", num);
     printk("  base: 0x%08x\n", 
-           (gdt[num].base_high << 24) | (gdt[num].base_middle << 16) | gdt[num].base_low);
+           (table[num].base_high << 24) | (table[num].base_middle << 16) | table[num].base_low);
     printk("  limit: 0x%05x\n", 
-           ((gdt[num].granularity & 0x0F) << 16) | gdt[num].limit_low);
-    printk("  access: 0x%02x\n", gdt[num].access);
-    printk("  granularity: 0x%02x\n", gdt[num].granularity);
+           ((table[num].granularity & 0x0F) << 16) | table[num].limit_low);
+    printk("  access: 0x%02x\n", table[num].access);
+    printk("  granularity: 0x%02x\n", table[num].granularity);
     
     // Decode access byte
-    if (gdt[num].access & 0x80) printk("    Present: YES\n");
+    if (table[num].access & 0x80) printk("    Present: YES\n");
     else printk("    Present: NO\n");
     
-    uint8_t desc_type = (gdt[num].access >> 3) & 0x1;
+    uint8_t desc_type = (table[num].access >> 3) & 0x1;
     if (desc_type == 0) printk("    Type: System\n");
     else printk("    Type: Code/Data\n");
 }
 
 void debug_tss_contents() {
     printk("TSS Contents:\n");
-    printk("  esp: 0x%08x\n", tss_df.esp);
-    printk("  ss:  0x%04x\n", tss_df.ss);
-    printk("  cs:  0x%04x\n", tss_df.cs);
-    printk("  eip: 0x%08x\n", tss_df.eip);
-    printk("  cr3: 0x%08x\n", tss_df.cr3);
-    printk("  ds:  0x%04x\n", tss_df.ds);
+    printk("  esp: 0x%08x\n", tss_df[0].esp);
+    printk("  ss:  0x%04x\n", tss_df[0].ss);
+    printk("  cs:  0x%04x\n", tss_df[0].cs);
+    printk("  eip: 0x%08x\n", tss_df[0].eip);
+    printk("  cr3: 0x%08x\n", tss_df[0].cr3);
+    printk("  ds:  0x%04x\n", tss_df[0].ds);
+
+    uint16_t current_tr;
+    __asm__ volatile("str %0" : "=r"(current_tr));
+    printk("Current Task Register: 0x%04x (should be 0x%02x)\n", current_tr, GDT_TSS_MAIN_SEL);
 }
 // =================================================================
 // DEBUG End
@@ -82,7 +74,7 @@ void test_stack_overflow(int depth) {
     uint32_t current_esp;
     asm volatile ("mov %%esp, %0" : "=r"(current_esp));
     
-    printk("Stack depth: %d, ESP=0x%08x\n", depth, current_esp);
+    pr_debug("Stack depth: %d, ESP=0x%08x\n", depth, current_esp);
     
     // Check if we're getting close to the guard page
     if (current_esp <= KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE + 0x1000) {
@@ -95,16 +87,74 @@ void test_stack_overflow(int depth) {
 
 __attribute__((noreturn))
 void high_stack_entry() {
+    boot_prof_mark("stack switch");
     printk("Switched to high virtual stack!\n");
     uint32_t cur_esp;
     asm volatile ("mov %%esp, %0" : "=r"(cur_esp));
     printk("ESP after stack switch: 0x%08x\n", cur_esp);
 
-    // IMP: Enabling Interrupts is causing the kernel to reboot infinitely. WHY ???
-    // Now enable interrupts 
-    // __asm__ __volatile__("sti");
+    // The BIOS left the PIC on vectors 8-15, so the first timer tick used
+    // to arrive as a "double fault" and reboot the machine. Remap it to
+    // IRQ_VECTOR_BASE (all lines masked) before enabling interrupts.
+    irq_chip_install(&pic_8259_chip);
+
+    // Prefer the IOAPIC when ACPI describes one; the PIC stays remapped and
+    // masked so a stray spurious IRQ7 still lands on a harmless vector
+    if (acpi_init() == 0 && apic_init() == 0) {
+        irq_chip_install(&apic_chip);
+    }
+    boot_prof_mark("acpi/irq chip");
+
+    // Calibrate the TSC and start the tick (LAPIC timer, else PIT)
+    clock_init();
+    irq_enable();
+    boot_prof_mark("clock");
+
+    // Hardware performance counters, if the CPU has architectural perfmon
+    pmu_init();
+
+    // This thread becomes task 0; kthread_create() works from here on
+    task_init();
+    boot_prof_mark("tasks");
+
+    // Wake the application processors (needs the LAPIC and a calibrated
+    // clock for the INIT/STARTUP IPI delays)
+    smp_boot_aps();
+    boot_prof_mark("smp");
+
+    // Free the memory above CONFIG_PMM_EAGER_MB in the background
+    pmm_start_deferred_init();
+
+    // The TSC is calibrated now: print how long each boot phase took
+    boot_prof_report();
+
+    // -------------------------------------------------------------------------
+    // Optional Unit Tests and Benchmarks
+    // -------------------------------------------------------------------------
+    // Before the fault demos below: test_stack_overflow() never returns
+    int tests_failed __attribute__((unused)) = 0;
+    #if CONFIG_PROFILE_HZ
+    profile_start(CONFIG_PROFILE_HZ, PROFILE_CALLCHAIN);
+    #endif
+    #ifdef KERNEL_BENCH
+    bench_run_all();
+    perf_report(&page_fault_perf, CONSOLE_ALL);
+    #endif
+    #ifdef KERNEL_TESTS
+    tests_failed = run_kernel_tests();
+    trace_dump(CONSOLE_SERIAL);
+    #endif
+    #if CONFIG_PROFILE_HZ
+    profile_stop();
+    profile_dump(CONSOLE_SERIAL);
+    #endif
+
+    #ifdef KERNEL_HEADLESS
+    // Unattended run (make test-headless, bench-headless): the results are
+    // on the serial port, hand the verdict to QEMU's exit status
+    qemu_exit(tests_failed ? QEMU_EXIT_FAILURE : QEMU_EXIT_SUCCESS);
+    #endif
 
-    
     // -------------------------------------------------------------------------
     // Optional: Trigger a page fault for testing
     // -------------------------------------------------------------------------
@@ -113,13 +163,14 @@ void high_stack_entry() {
     volatile int *heap_ptr = (int *)(KERNEL_HEAP_START + 0x1234);
     *heap_ptr = 42;
     printk("Heap page mapped and write succeeded!\n");
+    perf_report(&page_fault_perf, CONSOLE_ALL);
 
     // printk("\nTriggering page fault...\n");
     // volatile int *ptr = (int *)0xDEADBEEF;  // This address is not mapped
     // *ptr = 123;                             // Will cause interrupt 14 (page fault)
 
     printk("Testing stack overflow...\n");
-    printk("Current page directory CR3: 0x%08x\n", tss_df.cr3);
+    printk("Current page directory CR3: 0x%08x\n", tss_df[0].cr3);
 
     // Check if VGA memory is accessible
     volatile uint16_t* vga_test = (volatile uint16_t*)0xB8000;
@@ -139,36 +190,57 @@ void high_stack_entry() {
 
     // while (1) { __asm__ __volatile__("hlt"); }
 
-    // -------------------------------------------------------------------------
-    // Optional Unit Tests
-    // -------------------------------------------------------------------------
-    #ifdef KERNEL_TESTS
-    printk("\n==================================================\n");
-    printk("Tests Running...\n");
-    run_printk_tests();
-    run_printk_scrolling_test();
-    run_panik_unit_tests();
-    printk("==================================================\n");
-    #endif
+    // Done: park the boot thread for good. The boot CPU's idle task sleeps
+    // until the next interrupt; with no timers queued the one-shot timer
+    // stays off and the CPU is not woken at all.
+    get_current()->state = TASK_BLOCKED;
+    schedule();
+    panik("Boot thread woke up");
+
+    // panik() returns in PANIK_MODE_TEST
+    for (;;) {
+        __asm__ __volatile__("cli; hlt");
+    }
 }
 
-void kernel_main() {
+void kernel_main(uint32_t boot_magic, uint32_t boot_info_addr) {
+    // Copy the loader's boot information before anything can overwrite it
+    int boot_info_err = boot_info_init(boot_magic, boot_info_addr);
+    boot_prof_start();
+
+    // Per-CPU GDT, TSS and %fs first: even printk's trace and log paths
+    // ask smp_processor_id(), which reads through %fs
+    smp_prepare_boot_cpu();
+    boot_prof_mark("percpu/gdt");
+
     // -------------------------------------------------------------------------
     // Console and Logger Initialization
     // -------------------------------------------------------------------------
     printk_init();
+    serial_init();
+    #ifdef KERNEL_HEADLESS
+    // No screen to look at: mirror the console to the serial port
+    printk_set_console_sinks(CONSOLE_ALL);
+    #endif
     printk("%s v%s - Hello Devjit!\n", KERNEL_NAME, KERNEL_VERSION);
     printk("Kernel-V is running! Welcome to your custom kernel, Devjit!\n");
 
-    check_double_fault_breadcrumbs();
+    if (boot_info_err != 0) {
+        panik("Unknown bootloader (magic 0x%08x)", boot_magic);
+    }
+    boot_info_print();
+    boot_prof_mark("console");
+
+    // Report a crash record left behind by the previous boot
+    pstore_init();
+    boot_prof_mark("pstore");
 
     // -------------------------------------------------------------------------
     // Initializing IDT (Interrupt Descriptor Table)
     // -------------------------------------------------------------------------
     idt_init();
-    init_tss();
-    gdt_init();
     // Do NOT enable interrupts yet
+    boot_prof_mark("idt");
 
     // Debug IDT and GDT setup
     printk("\n==================================================\n");
@@ -180,15 +252,16 @@ void kernel_main() {
 
     // Add this after TSS setup
     printk("Double fault stack: 0x%08x to 0x%08x\n", 
-        (uint32_t)double_fault_stack, 
-        (uint32_t)(double_fault_stack + DOUBLE_FAULT_STACK_SIZE));
+        (uint32_t)double_fault_stack[0], 
+        (uint32_t)(double_fault_stack[0] + DOUBLE_FAULT_STACK_SIZE));
     printk("Double fault stack size: %d bytes\n", DOUBLE_FAULT_STACK_SIZE);
 
     // Write a pattern to double fault stack to verify it's accessible
     for (int i = 0; i < 16; i++) {
-        double_fault_stack[i] = 0xAA + i;
+        double_fault_stack[0][i] = 0xAA + i;
     }
     printk("Double fault stack test pattern written\n");
+    boot_prof_mark("debug dump");
 
     // -------------------------------------------------------------------------
     // Display BIOS Memory Map (E820)
@@ -196,6 +269,7 @@ void kernel_main() {
     printk("\n==================================================\n");
     printk("Parsing BIOS Memory Map (E820)...\n");
     parse_and_print_e820_map();
+    boot_prof_mark("e820");
 
     // -------------------------------------------------------------------------
     // Physical Memory Manager Setup
@@ -204,12 +278,14 @@ void kernel_main() {
     pmm_reserve_memory_region(RESERVED_TYPE_INIT);
     pmm_reserve_memory_region(RESERVED_TYPE_KERNEL);
     pmm_reserve_memory_region(RESERVED_TYPE_BITMAP);
+    pmm_reserve_memory_region(RESERVED_TYPE_PSTORE);
 
     void* frame1 = pmm_alloc_frame();
     printk(frame1 ? "Allocated frame at address: %p\n" : "Failed to allocate frame\n", frame1);
 
     void* frame2 = pmm_alloc_frame();
     printk(frame2 ? "Allocated another frame at address: %p\n" : "Failed to allocate another frame\n", frame2);
+    boot_prof_mark("pmm");
 
     // -------------------------------------------------------------------------
     // Virtual Memory & Paging Setup
@@ -224,10 +300,10 @@ void kernel_main() {
     // Debug: Verify double fault handler setup
     printk("\n==================================================\n");
     printk("Double fault TSS configured:\n");
-    printk("  TSS address: 0x%08x\n", (uint32_t)&tss_df);
-    printk("  Handler EIP: 0x%08x\n", tss_df.eip);
-    printk("  Handler ESP: 0x%08x\n", tss_df.esp);
-    printk("  Handler CR3: 0x%08x\n", tss_df.cr3);
+    printk("  TSS address: 0x%08x\n", (uint32_t)&tss_df[0]);
+    printk("  Handler EIP: 0x%08x\n", tss_df[0].eip);
+    printk("  Handler ESP: 0x%08x\n", tss_df[0].esp);
+    printk("  Handler CR3: 0x%08x\n", tss_df[0].cr3);
     printk("\n==================================================\n");
     
 
@@ -243,12 +319,13 @@ void kernel_main() {
             printk("Failed to allocate stack frame for virt=0x%08x\n", virt);
             panik("Stack frame allocation failed");
         }
-        printk("Mapping stack page: virt=0x%08x phys=0x%08x\n", virt, (uint32_t)phys_frame);
+        pr_debug("Mapping stack page: virt=0x%08x phys=0x%08x\n", virt, (uint32_t)phys_frame);
         paging_map_page(virt, (uint32_t)phys_frame, PAGE_PRESENT | PAGE_WRITE);
         pmm_set_frame_bitmap((uint32_t)phys_frame, (uint32_t)phys_frame + PAGE_SIZE);
     }
 
     printk("Paging initialized successfully!\n");
+    boot_prof_mark("paging/stack map");
 
     // Switch ESP to high virtual address (inside mapped page, not at page boundary)
     printk("About to switch to high virtual stack...\n");
@@ -1,4 +1,5 @@
 #include "memory_map.h"
+#include "boot_info.h"
 #include "printk.h"
 
 uint16_t usable_memory_region_count = 0;
@@ -19,23 +20,21 @@ static const char* region_type_to_string (uint32_t type)
 
 void parse_and_print_e820_map(void)
 {
-    // stores pointer to the E820 map
-    e820_entry_t* map = (e820_entry_t*)E820_MAP_ADDRESS;
+    // boot_info_init() copied the loader's E820 map into the kernel
+    e820_entry_t* map = (e820_entry_t*)boot_info.mmap_addr;
 
     // count of number of entries in the E820 map
-    uint16_t count = *(uint16_t*)E820_MAP_COUNT_PTR;
+    uint16_t count = boot_info.mmap_count;
 
     printk("\n[MEMORY MAP] BIOS provided %u entries:\n", count);
 
     for (uint16_t i = 0; i < count; i++)
     {
         const char* current_region_type = region_type_to_string(map[i].type);
-        printk("[%u] Base: 0x%08x%08x, Length: 0x%08x%08x, Type: %s\n",
+        printk("[%u] Base: 0x%016llx, Length: 0x%016llx, Type: %s\n",
                i,
-               (uint32_t)(map[i].base >> 32),
-               (uint32_t)(map[i].base & 0xFFFFFFFF),
-               (uint32_t)(map[i].length >> 32),
-               (uint32_t)(map[i].length & 0xFFFFFFFF),
+               map[i].base,
+               map[i].length,
                current_region_type
             );
 
@@ -53,3 +52,18 @@ void parse_and_print_e820_map(void)
     printk("\n[MEMORY MAP] Usable memory regions count: %u\n", usable_memory_region_count);
 
 }
+
+uint32_t e820_lookup_type(uint64_t addr)
+{
+    e820_entry_t* map = (e820_entry_t*)boot_info.mmap_addr;
+    uint16_t count = boot_info.mmap_count;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (addr >= map[i].base && addr - map[i].base < map[i].length)
+        {
+            return map[i].type;
+        }
+    }
+    return 0;
+}
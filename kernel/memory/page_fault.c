@@ -3,20 +3,29 @@
 #include "pmm.h"
 #include "printk.h"
 #include "panik.h"
+#include "trace.h"
+#include "task.h"
+#include "backtrace.h"
+#include "console.h"
+#include "perf.h"
+#include "arch/x86/debug_exit.h"
 #include <stdint.h>
 
-void page_fault_handler (page_fault_stack_t* frame)
+DEFINE_PERF_REGION(page_fault_perf, "page_fault");
+
+static void handle_page_fault(interrupt_frame_t* frame)
 {
     // Disable interrupts to prevent nested faults
     __asm__ __volatile__ ("cli");
 
     // cr2 holds the fault linear address for the most recent page fault
     uint32_t fault_address;
-    uint32_t esp, ebp;
-    asm volatile("mov %%esp, %0" : "=r"(esp));
-    asm volatile("mov %%ebp, %0" : "=r"(ebp));
+    uint32_t esp = interrupt_frame_sp(frame);
+    uint32_t ebp = frame->ebp;
     __asm__ __volatile__("mov %%cr2, %0" : "=r"(fault_address));
 
+    trace_event("page fault addr=0x%x err=0x%x eip=0x%x", fault_address, frame->error_code, frame->eip);
+
     // Check to see if accessing guard page
     // Fault accessing Guard Page: Stack Overflow
     if (fault_address >= KERNEL_STACK_BOTTOM_VIRT && fault_address < KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE) 
@@ -42,7 +51,17 @@ void page_fault_handler (page_fault_stack_t* frame)
     }
 
 
-    printk("[PAGE FAULT] at address: 0x%x, error code: 0x%x [eip=0x%x, esp=0x%x, ebp=0x%x]\n", 
+    // Guard page below a kernel thread stack: that thread overflowed.
+    // A fault with esp still above the guard can report it; one that ran
+    // esp into it escalates to the double fault task instead.
+    struct task* owner = task_stack_guard_owner(fault_address);
+    if (owner)
+    {
+        panik("Stack overflow in thread '%s' (tid %d): fault at 0x%x, eip=0x%x",
+              owner->name, owner->tid, fault_address, frame->eip);
+    }
+
+    pr_warn_ratelimited("[PAGE FAULT] at address: 0x%x, error code: 0x%x [eip=0x%x, esp=0x%x, ebp=0x%x]\n", 
             fault_address, 
             frame->error_code, 
             frame->eip,
@@ -52,7 +71,7 @@ void page_fault_handler (page_fault_stack_t* frame)
     // Check if the fault_address is in the kernel heap range
     if (fault_address >= KERNEL_HEAP_START && fault_address < KERNEL_HEAP_END) 
     {
-        printk("[PAGE FAULT] Address within kernel heap region: allocating and mapping new page.\n");
+        pr_debug("[PAGE FAULT] Address within kernel heap region: allocating and mapping new page.\n");
 
         void* new_frame = pmm_alloc_frame();
         if(!new_frame)
@@ -67,8 +86,8 @@ void page_fault_handler (page_fault_stack_t* frame)
     // Typical stack growth threshold: only map if faulting within N bytes below ESP
     const uint32_t STACK_GROWTH_GAP = 32; // or 128, or 0
     if (fault_address >= KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE && fault_address < KERNEL_STACK_TOP_VIRT) {
-        if (fault_address >= frame->esp - STACK_GROWTH_GAP && fault_address < frame->esp) {
-            printk("[PF] Stack growth: mapping new stack page at 0x%x (esp=0x%x)\n", fault_address, frame->esp);
+        if (fault_address >= esp - STACK_GROWTH_GAP && fault_address < esp) {
+            pr_debug("[PF] Stack growth: mapping new stack page at 0x%x (esp=0x%x)\n", fault_address, esp);
             void* new_frame = pmm_alloc_frame();
             if (!new_frame) panik("Out of memory in stack PF recovery");
             paging_map_page(fault_address, (uint32_t)new_frame, PAGE_PRESENT | PAGE_WRITE);
@@ -109,8 +128,24 @@ void page_fault_handler (page_fault_stack_t* frame)
         printk("[PAGE FAULT] Instruction fetch.\n");
     }
 
+    backtrace_print_context(CONSOLE_ALL, frame->eip, ebp);
+
+#ifdef KERNEL_HEADLESS
+    qemu_exit(QEMU_EXIT_PANIK);
+#endif
+
     // halt or implement fault recovery
     while (1) {
         __asm__ __volatile__("hlt");
     }
-}
\ No newline at end of file
+}
+
+void page_fault_handler(interrupt_frame_t* frame, void* ctx)
+{
+    (void)ctx;
+
+    // Only faults that are resolved and return end up in the counts
+    perf_begin(&page_fault_perf);
+    handle_page_fault(frame);
+    perf_end(&page_fault_perf);
+}
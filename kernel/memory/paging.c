@@ -1,5 +1,11 @@
 #include "paging.h"
+#include "pmm.h"
+#include "panik.h"
 #include "printk.h"
+#include "spinlock.h"
+
+// Serializes page table updates between CPUs. Lock order: paging, then pmm.
+static DEFINE_TICKET_LOCK(paging_lock);
 
 static uint32_t* page_directory         = (uint32_t*)PAGE_DIR_START_ADDR;
 static uint32_t* first_page_table       = (uint32_t*)PAGE_TABLE_START_ADDR;
@@ -73,6 +79,8 @@ void paging_map_page (uint32_t virtual_addr, uint32_t physical_addr, uint32_t fl
     // Extract page table index (bits 12 - 21) - next 10 bits
     uint32_t ptable_index = (virtual_addr >> 12) & 0x03FF;
 
+    uint32_t irq_flags = ticket_lock_irqsave(&paging_lock);
+
     // If already present - get the address of the page table
     uint32_t* page_table;
     if (page_directory[pdir_index] & PAGE_PRESENT)
@@ -112,6 +120,71 @@ void paging_map_page (uint32_t virtual_addr, uint32_t physical_addr, uint32_t fl
         : "r"(virtual_addr)
         : "memory"
     );
+
+    ticket_unlock_irqrestore(&paging_lock, irq_flags);
+}
+
+static uint32_t* paging_lookup_pte (uint32_t virtual_addr)
+{
+    uint32_t pdir_index = virtual_addr >> 22;
+    uint32_t ptable_index = (virtual_addr >> 12) & 0x03FF;
+
+    if (!(page_directory[pdir_index] & PAGE_PRESENT))
+    {
+        return 0;
+    }
+    uint32_t* page_table = (uint32_t*)(page_directory[pdir_index] & 0xFFFFF000);
+    return &page_table[ptable_index];
+}
+
+//
+// Clear the page table entry for the given virtual address
+// The page table itself is kept even if it becomes empty
+//
+uint32_t paging_unmap_page (uint32_t virtual_addr)
+{
+    uint32_t irq_flags = ticket_lock_irqsave(&paging_lock);
+
+    uint32_t* pte = paging_lookup_pte(virtual_addr);
+    if (!pte || !(*pte & PAGE_PRESENT))
+    {
+        ticket_unlock_irqrestore(&paging_lock, irq_flags);
+        return 0;
+    }
+
+    uint32_t physical_addr = *pte & 0xFFFFF000;
+    *pte = 0;
+    __asm__ __volatile__ ("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+
+    ticket_unlock_irqrestore(&paging_lock, irq_flags);
+    return physical_addr;
+}
+
+int paging_is_mapped (uint32_t virtual_addr)
+{
+    uint32_t* pte = paging_lookup_pte(virtual_addr);
+    return pte && (*pte & PAGE_PRESENT);
+}
+
+//
+// Identity map a physical range (ACPI tables, device MMIO above the first 4MB)
+// Pages inside the boot identity map are left alone
+//
+void* paging_map_identity (uint32_t phys, uint32_t size, uint32_t flags)
+{
+    uint32_t start = phys & ~(PAGE_SIZE - 1);
+    uint32_t end = phys + size;
+
+    for (uint32_t page = start; page < end && page >= start; page += PAGE_SIZE)
+    {
+        if (page < PAGE_ENTRIES * PAGE_SIZE)
+        {
+            continue;
+        }
+        paging_map_page(page, page, flags);
+    }
+
+    return (void*)phys;
 }
 
 void debug_page_tables ()
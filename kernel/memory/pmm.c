@@ -1,12 +1,27 @@
 #include "pmm.h"
 #include "memory_map.h"
+#include "boot_info.h"
 #include "printk.h"
 #include "paging.h"
+#include "trace.h"
+#include "pstore.h"
+#include "spinlock.h"
+#include "task.h"
+#include "arch/x86/cpu.h"
+
+// Taken for every bitmap update: frames are allocated and freed from any
+// CPU, and from interrupt context when a dead thread is reaped
+static DEFINE_MCS_LOCK(pmm_lock);
 
 static uint8_t* frame_bitmap = NULL;;
 static uint32_t total_frames = 0;
 static uint32_t used_frames = 0;
 static uint32_t max_frame_idx = 0;
+static uint32_t bitmap_words = 0;
+
+// Frames from here up are not online yet: still marked used in the bitmap
+// until pmm_online_locked() frees their usable parts
+static uint32_t online_frames_end = 0;
 
 // frame_bitmap[x] -> byte entry (8 bits) => array_index = bitmap_index / 8 
 // now within that 8 bits -> need to update the correct bit at (bitmap_index % 8)
@@ -15,6 +30,85 @@ static uint32_t max_frame_idx = 0;
 #define BITMAP_CLEAR(idx)   (frame_bitmap[(idx) / 8] &= ~(1 << ((idx) % 8)))
 #define BITMAP_GET(idx)     (frame_bitmap[(idx) / 8] &   (1 << ((idx) % 8)))
 
+// The same bitmap seen as 32-bit words: frame idx is bit (idx % 32) of
+// word (idx / 32), x86 being little endian
+#define BITMAP_WORDS        ((uint32_t*)frame_bitmap)
+
+static inline uint32_t popcount32(uint32_t x)
+{
+    // No __builtin_popcount: it needs libgcc
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return (x * 0x01010101) >> 24;
+}
+
+// Set or clear frames [first, end): single bits up to the first word
+// boundary, rep stosd for the whole words, single bits for the tail
+static void bitmap_fill(uint32_t first, uint32_t end, int set)
+{
+    for (; first < end && (first % 32); first++) {
+        if (set) BITMAP_SET(first); else BITMAP_CLEAR(first);
+    }
+
+    uint32_t words = (end - first) / 32;
+    if (first < end && words) {
+        memset32(&BITMAP_WORDS[first / 32], set ? 0xFFFFFFFF : 0, words);
+        first += words * 32;
+    }
+
+    for (; first < end; first++) {
+        if (set) BITMAP_SET(first); else BITMAP_CLEAR(first);
+    }
+}
+
+// Number of used frames in [first, end)
+static uint32_t bitmap_count_set(uint32_t first, uint32_t end)
+{
+    uint32_t count = 0;
+
+    for (; first < end && (first % 32); first++) {
+        count += BITMAP_GET(first) ? 1 : 0;
+    }
+    for (; first + 32 <= end; first += 32) {
+        count += popcount32(BITMAP_WORDS[first / 32]);
+    }
+    for (; first < end; first++) {
+        count += BITMAP_GET(first) ? 1 : 0;
+    }
+    return count;
+}
+
+// Free the usable frames in [online_frames_end, end_frame)
+static void pmm_online_locked(uint32_t end_frame)
+{
+    if (end_frame > max_frame_idx) {
+        end_frame = max_frame_idx;
+    }
+    if (end_frame <= online_frames_end) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < usable_memory_region_count; i++)
+    {
+        // Whole frames only; nothing above 4GiB is reachable anyway
+        uint64_t base = usable_memory_region[i].base;
+        uint64_t top = base + usable_memory_region[i].length;
+        if (base >= 0x100000000ULL) continue;
+        if (top > 0x100000000ULL) top = 0x100000000ULL;
+        uint32_t first = (uint32_t)((base + PAGE_SIZE - 1) / PAGE_SIZE);
+        uint32_t end = (uint32_t)(top / PAGE_SIZE);
+
+        if (first < online_frames_end) first = online_frames_end;
+        if (end > end_frame) end = end_frame;
+        if (first < end) {
+            bitmap_fill(first, end, 0);
+            total_frames += end - first;
+        }
+    }
+    online_frames_end = end_frame;
+}
+
 //
 // Initialize the entire bitmap to 1 (used)
 // Iterate through all the usable memory regions
@@ -24,6 +118,7 @@ void pmm_init(void)
 {
     total_frames = 0;
     used_frames = 0;
+    max_frame_idx = 0;
 
     // Step1: Calculate the maximum frame index based on the usable memory regions
     for (uint32_t usable_memory_region_idx = 0; usable_memory_region_idx < usable_memory_region_count; usable_memory_region_idx++)
@@ -41,35 +136,21 @@ void pmm_init(void)
     }
 
     // Step2: Allocate address for bitmap array in a safe memory region
-    frame_bitmap = (uint8_t*)0x90000;
-    uint32_t max_frame_bitmap_idx = (max_frame_idx / 8) + 1; 
+    frame_bitmap = (uint8_t*)PMM_BITMAP_ADDR;
+    bitmap_words = (max_frame_idx + 31) / 32;
 
     // Step3: Initialize the bitmap to 1 (all frames are used)
-    for (uint32_t frame = 0; frame < max_frame_bitmap_idx; frame++)
-    {
-        frame_bitmap[frame] = 0xFF;
-    }     
+    memset32(frame_bitmap, 0xFFFFFFFF, bitmap_words);
 
-    // Step4: Iterate through the usable memory regions and mark frames as free
-    for (uint32_t usable_memory_region_idx = 0; usable_memory_region_idx < usable_memory_region_count; usable_memory_region_idx++)
-    {
-        uint32_t region_base = usable_memory_region[usable_memory_region_idx].base;
-        uint32_t region_length = usable_memory_region[usable_memory_region_idx].length;
-        
-        for (uint32_t addr = region_base; addr < region_base + region_length; addr += PAGE_SIZE)
-        {
-            uint32_t frame_index = FRAME_INDEX(addr);
-            if (frame_index < max_frame_idx)
-            {
-                BITMAP_CLEAR(frame_index);
-                total_frames++;
-            }
-        }
-    }
+    // Step4: Mark the usable frames of the first CONFIG_PMM_EAGER_MB as
+    // free; pmm_start_deferred_init() brings the rest online later
+    uint32_t eager_frames = CONFIG_PMM_EAGER_MB ? CONFIG_PMM_EAGER_MB * (0x100000 / PAGE_SIZE) : max_frame_idx;
+    online_frames_end = 0;
+    pmm_online_locked(eager_frames);
 
     // initially none of the usable frames are used
     used_frames = 0;
-    printk("[PMM] Total Usable Frames: %u\n", total_frames);
+    printk("[PMM] Total Usable Frames: %u (%u of %u frames online)\n", total_frames, online_frames_end, max_frame_idx);
 }
 
 //
@@ -85,29 +166,35 @@ void pmm_reserve_memory_region(reserved_memory_type_t reserved_type)
     {
         pmm_set_frame_bitmap(0x0, 0x100000);
 
-        printk("[PMM] Reserved kernel range: 0x%u - 0x%u\n", 0, 100000);
+        printk("[PMM] Reserved low memory: 0x%x - 0x%x\n", 0, 0x100000);
     }
  
     // reserve the kernel memory region
     if (reserved_type & RESERVED_TYPE_KERNEL)
     {
-        // We load the kernel at 0x100000, get it from the linker script
-        // reserve the memory used to load the kernel
+        // The loader reports the range it wrote (0x100000 up); the linker
+        // script range covers the same image
         extern char kernel_start;
         extern char kernel_end;
-    
-        uint32_t kernel_memory_start = (uint32_t)&kernel_start;
-        uint32_t kernel_memory_end   = (uint32_t)&kernel_end;
+
+        uint32_t kernel_memory_start = boot_info.kernel_start;
+        uint32_t kernel_memory_end   = boot_info.kernel_end;
+        if (!(boot_info.flags & BOOT_INFO_KERNEL_RANGE) ||
+            kernel_memory_start > (uint32_t)&kernel_start || kernel_memory_end < (uint32_t)&kernel_end)
+        {
+            kernel_memory_start = (uint32_t)&kernel_start;
+            kernel_memory_end   = (uint32_t)&kernel_end;
+        }
         pmm_set_frame_bitmap(kernel_memory_start, kernel_memory_end);
 
-        printk("[PMM] Reserved kernel range: 0x%u - 0x%u\n", kernel_memory_start, kernel_memory_end);
+        printk("[PMM] Reserved kernel range: 0x%x - 0x%x\n", kernel_memory_start, kernel_memory_end);
     }
 
     // reserve memory used by memory bitmap
     if (reserved_type & RESERVED_TYPE_BITMAP)
     {
-        // each frame - 1 bit -> max_frame_idx / 8 + 1 gives total bytes of bitmap
-        uint32_t bitmap_bytes = (max_frame_idx / 8) + 1;
+        // each frame - 1 bit, rounded up to whole words
+        uint32_t bitmap_bytes = bitmap_words * sizeof(uint32_t);
         uint32_t bitmap_start = (uint32_t)frame_bitmap;
         uint32_t bitmap_end = bitmap_start + bitmap_bytes;
         pmm_set_frame_bitmap(bitmap_start, bitmap_end);
@@ -132,6 +219,13 @@ void pmm_reserve_memory_region(reserved_memory_type_t reserved_type)
         printk("[PMM] Page Table: 0x%u - 0x%u (%u bytes)\n", page_table_start, page_table_end, page_table_end - page_table_start);
     }
 
+    // reserve the persistent crash record region so it survives until the next boot
+    if (reserved_type & RESERVED_TYPE_PSTORE)
+    {
+        pmm_set_frame_bitmap(PSTORE_ADDR, PSTORE_ADDR + PSTORE_SIZE);
+        printk("[PMM] Crash record: 0x%x - 0x%x (%u bytes)\n", PSTORE_ADDR, PSTORE_ADDR + PSTORE_SIZE, PSTORE_SIZE);
+    }
+
     printk("[PMM] Total usable frames: %u\n", total_frames);
     printk("[PMM] Total reserved frames: %u\n", used_frames);
 }
@@ -149,31 +243,66 @@ void pmm_set_frame_bitmap(uint32_t start_address, uint32_t end_address)
     uint32_t end = end_address + PAGE_SIZE - 1;
     end &= ~(PAGE_SIZE - 1);
 
-    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE)
+    uint32_t first = FRAME_INDEX(start);
+    uint32_t last = FRAME_INDEX(end);
+    if (last > max_frame_idx) last = max_frame_idx;
+    if (first >= last) return;
+
+    struct mcs_node node;
+    uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+
+    // Not online yet: bring it online first, or onlining would free it again
+    if (last > online_frames_end) {
+        pmm_online_locked(last);
+    }
+
+    used_frames += (last - first) - bitmap_count_set(first, last);
+    bitmap_fill(first, last, 1);
+    mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+}
+
+// First free frame below online_frames_end, 0 if none
+static uint32_t bitmap_find_free_locked(void)
+{
+    uint32_t end_word = (online_frames_end + 31) / 32;
+
+    for (uint32_t w = 0; w < end_word; w++)
     {
-        uint32_t frame_index = FRAME_INDEX (addr);
-        if (!BITMAP_GET(frame_index))
+        // Frame 0 (address 0x0) is never handed out, often reserved by BIOS
+        uint32_t used = BITMAP_WORDS[w] | (w == 0 ? 1 : 0);
+        if (used != 0xFFFFFFFF)
         {
-            BITMAP_SET(frame_index);
-            used_frames++;
+            uint32_t frame_idx = w * 32 + __builtin_ctz(~used);
+            return frame_idx < online_frames_end ? frame_idx : 0;
         }
     }
-
+    return 0;
 }
 
 void* pmm_alloc_frame (void)
 {
-    // Start from frame 1 to avoid allocating frame 0 (address 0x0)
-    // often reserved by BIOS.
-    for (uint32_t frame_idx = 1; frame_idx < total_frames; frame_idx++)
+    struct mcs_node node;
+    uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+
+    // Skip full words; if everything online is taken, do not wait for the
+    // deferred init thread
+    uint32_t frame_idx = bitmap_find_free_locked();
+    while (!frame_idx && online_frames_end < max_frame_idx)
     {
-        if (!BITMAP_GET(frame_idx))
-        {
-            BITMAP_SET(frame_idx);
-            used_frames++;
-            return (void*)(frame_idx * PAGE_SIZE);
-        }
+        pmm_online_locked(online_frames_end + PMM_ONLINE_CHUNK_FRAMES);
+        frame_idx = bitmap_find_free_locked();
     }
+
+    if (frame_idx)
+    {
+        BITMAP_SET(frame_idx);
+        used_frames++;
+        trace_event("pmm alloc frame=0x%x used=%u", frame_idx * PAGE_SIZE, used_frames);
+        mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+        return (void*)(frame_idx * PAGE_SIZE);
+    }
+    mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+
     printk("[PMM] No free frames available!\n");
     return 0;
 }
@@ -181,13 +310,66 @@ void* pmm_alloc_frame (void)
 void pmm_free_frame (void* addr)
 {
     uint32_t frame_idx = FRAME_INDEX((uint32_t)addr);
-    if (frame_idx < total_frames)
+    if (frame_idx < max_frame_idx)
     {
+        struct mcs_node node;
+        uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
         BITMAP_CLEAR(frame_idx);
         used_frames--;
+        trace_event("pmm free frame=0x%x used=%u", (uint32_t)addr, used_frames);
+        mcs_unlock_irqrestore(&pmm_lock, &node, flags);
     }
     else
     {
         printk("[PMM] Attempted to free an invalid frame at address: %p\n", addr);
     }
-}
\ No newline at end of file
+}
+
+// Bring the rest of memory online a chunk at a time. Not pinned: an idle
+// AP usually steals it, so the boot CPU carries on meanwhile.
+static void pmm_deferred_init_fn(void *arg)
+{
+    (void)arg;
+    uint64_t start = rdtsc();
+
+    for (;;)
+    {
+        struct mcs_node node;
+        uint32_t flags = mcs_lock_irqsave(&pmm_lock, &node);
+        if (online_frames_end >= max_frame_idx)
+        {
+            mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+            break;
+        }
+        pmm_online_locked(online_frames_end + PMM_ONLINE_CHUNK_FRAMES);
+        mcs_unlock_irqrestore(&pmm_lock, &node, flags);
+        yield();
+    }
+
+    printk("[PMM] Deferred init done on CPU%d: %u usable frames online (%llu cycles)\n",
+           smp_processor_id(), total_frames, rdtsc() - start);
+}
+
+void pmm_start_deferred_init(void)
+{
+    if (online_frames_end >= max_frame_idx)
+    {
+        return;
+    }
+
+    struct task *t = kthread_create(pmm_deferred_init_fn, NULL, "pmm-online");
+    if (t)
+    {
+        sched_set_prio(t, IDLE_PRIO - 1);
+    }
+    else
+    {
+        // No thread slot: do it now
+        pmm_deferred_init_fn(NULL);
+    }
+}
+
+uint32_t pmm_used_frames (void)
+{
+    return used_frames;
+}
@@ -0,0 +1,655 @@
+#include "task.h"
+#include "clock.h"
+#include "timer.h"
+#include "panik.h"
+#include "trace.h"
+#include "printk.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/apic.h"
+#include "arch/x86/interrupt.h"
+
+/*
+O(1) priority run queues, one per CPU, with work stealing.
+    Each CPU has one ring of READY tasks per priority level, plus a bitmap
+    with bit p set while level p may be non-empty. The next task is taken
+    from the lowest set bit: a single `bsf`, however many tasks are queued.
+    Tasks of equal priority share the CPU round-robin, one time slice each.
+
+    Only the owning CPU pushes onto its rings, at the bottom. Tasks are
+    taken from the top, by the owner as well as by idle CPUs stealing work,
+    with a compare-and-swap on the top index: no lock, and the owner still
+    sees its tasks in FIFO order. A ring holds every task at most once, so
+    CONFIG_MAX_TASKS slots never overflow.
+
+    The bitmap is written by the owner only; other CPUs read it as a hint.
+    A level emptied by a thief keeps its bit until the owner finds it empty.
+
+Wakeups.
+    A task is queued on the CPU it last ran on. Waking it from another CPU
+    pushes it on that CPU's wake list (a lock-free stack) and sends an IPI;
+    the owner moves it onto its rings from the interrupt.
+
+Balancing.
+    A CPU with nothing to run steals the most urgent task from the busiest
+    CPU, skipping tasks that are pinned, still on their old CPU's stack or
+    cache hot (ran there less than SCHED_MIGRATION_COST_NS ago). A CPU that
+    queues a task it will not run right away kicks one idle CPU with an
+    IPI, so idle CPUs sleep until there is work to take.
+
+Everything else runs with interrupts off, so interrupt handlers can
+task_wake() safely.
+*/
+#define RQ_SLOTS        CONFIG_MAX_TASKS
+#define RQ_SLOT_MASK    (RQ_SLOTS - 1)
+
+_Static_assert((RQ_SLOTS & RQ_SLOT_MASK) == 0, "run queue rings need a power of two size");
+
+struct prio_queue {
+    volatile uint32_t top;                  // Next to take (any CPU)
+    volatile uint32_t bottom;               // Next free slot (owner only)
+    struct task *slots[RQ_SLOTS];
+};
+
+struct run_queue {
+    uint32_t bitmap;                        // Bit p: queues[p] may be non-empty
+    uint32_t stale_levels;                  // Levels holding a reprioritized task
+    uint32_t nr_running;                    // Queued, not counting current
+    uint32_t nr_migratable;                 // Queued and allowed on another CPU
+    struct task *wake_list;                 // Woken from other CPUs, not queued yet
+    int active;                             // Runs tasks (has a timer wheel)
+    uint32_t nr_preemptions;                // Switches forced at interrupt exit
+    uint32_t nr_steals;                     // Tasks taken from other CPUs
+    struct timer_list slice_timer;          // Ends the current time slice
+    struct prio_queue queues[MAX_PRIO];
+};
+
+static struct run_queue run_queues[NR_CPUS];
+
+// CPUs whose run queue is active / which are halted in their idle task
+static uint32_t sched_active_mask;
+static uint32_t sched_idle_mask;
+
+static inline struct run_queue* this_rq(void)
+{
+    return &run_queues[smp_processor_id()];
+}
+
+// Bitmap bits for priorities 0..prio (as urgent as prio, or more)
+static inline uint32_t prio_mask_upto(int prio)
+{
+    return (2u << prio) - 1;
+}
+
+// Bitmap bits for priorities more urgent than prio
+static inline uint32_t prio_mask_below(int prio)
+{
+    return (1u << prio) - 1;
+}
+
+static inline int task_is_pinned(const struct task *t, int cpu)
+{
+    return t->migrate_disable || t->allowed_cpus == (1u << cpu);
+}
+
+// Owner only
+static void rq_push(struct run_queue *rq, struct task *t)
+{
+    int cpu = (int)(rq - run_queues);
+    struct prio_queue *q = &rq->queues[t->prio];
+    uint32_t bottom = q->bottom;
+
+    t->cpu = cpu;
+    t->queued_prio = t->prio;
+    q->slots[bottom & RQ_SLOT_MASK] = t;
+    __atomic_store_n(&q->bottom, bottom + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&rq->bitmap, rq->bitmap | (1u << t->prio), __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&rq->nr_running, 1, __ATOMIC_RELAXED);
+    if (!task_is_pinned(t, cpu)) {
+        __atomic_fetch_add(&rq->nr_migratable, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Whether CPU `cpu` may take t off another CPU's run queue
+static int can_migrate(const struct task *t, int cpu, uint64_t now)
+{
+    if (task_is_pinned(t, (int)t->cpu) || !(t->allowed_cpus & (1u << cpu))) {
+        return 0;
+    }
+    if (__atomic_load_n(&t->on_cpu, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    return t->last_ran == 0 || now - t->last_ran >= SCHED_MIGRATION_COST_NS;
+}
+
+/**
+ * Take the task at the top of one level. `thief` is the stealing CPU, or
+ * -1 for the owner; a thief gives up if the head may not move to it (the
+ * slot cannot change under it while `top` is unchanged, which the CAS
+ * checks).
+ */
+static struct task* rq_take(struct run_queue *rq, int prio, int thief, uint64_t now)
+{
+    struct prio_queue *q = &rq->queues[prio];
+
+    for (;;) {
+        uint32_t top = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+        uint32_t bottom = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+        if ((int32_t)(bottom - top) <= 0) {
+            return NULL;
+        }
+
+        struct task *t = q->slots[top & RQ_SLOT_MASK];
+        if (thief >= 0 && !can_migrate(t, thief, now)) {
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(&q->top, &top, top + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            __atomic_fetch_sub(&rq->nr_running, 1, __ATOMIC_RELAXED);
+            if (!task_is_pinned(t, (int)(rq - run_queues))) {
+                __atomic_fetch_sub(&rq->nr_migratable, 1, __ATOMIC_RELAXED);
+            }
+            return t;
+        }
+        cpu_relax();
+    }
+}
+
+// Owner only: most urgent queued task, NULL if none
+static struct task* rq_pop(struct run_queue *rq)
+{
+    uint32_t bitmap;
+
+    while ((bitmap = rq->bitmap) != 0) {
+        int prio = __builtin_ctz(bitmap);
+        struct task *t = rq_take(rq, prio, -1, 0);
+
+        if (!t) {
+            __atomic_store_n(&rq->bitmap, bitmap & ~(1u << prio), __ATOMIC_RELAXED);
+        } else if (t->prio != prio) {
+            // Reprioritized while queued: move it to its level
+            rq_push(rq, t);
+        } else {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * sched_set_prio() cannot pull a task out of the middle of a ring, so it
+ * marks the level instead. Cycle every marked level once: tasks still on
+ * the right level go back in the same order, the others move.
+ */
+static void rq_requeue_stale(struct run_queue *rq)
+{
+    uint32_t stale = __atomic_exchange_n(&rq->stale_levels, 0, __ATOMIC_ACQUIRE);
+
+    while (stale) {
+        int prio = __builtin_ctz(stale);
+        struct prio_queue *q = &rq->queues[prio];
+        uint32_t count = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED) -
+                         __atomic_load_n(&q->top, __ATOMIC_RELAXED);
+
+        for (uint32_t i = 0; i < count; i++) {
+            struct task *t = rq_take(rq, prio, -1, 0);
+            if (!t) {
+                break;
+            }
+            rq_push(rq, t);
+        }
+        stale &= stale - 1;
+    }
+}
+
+static void sched_send_ipi(int cpu)
+{
+    lapic_send_ipi((uint8_t)cpu_data[cpu].apic_id, LAPIC_ICR_FIXED | LAPIC_IPI_VECTOR);
+}
+
+// Wake one halted CPU (not this one) to come and steal
+static void sched_kick_idle(int this_cpu_id)
+{
+    uint32_t idle = __atomic_load_n(&sched_idle_mask, __ATOMIC_SEQ_CST) & ~(1u << this_cpu_id);
+
+    while (idle) {
+        int cpu = __builtin_ctz(idle);
+        uint32_t bit = 1u << cpu;
+
+        // Claiming the bit makes sure only one waker sends the IPI
+        if (__atomic_fetch_and(&sched_idle_mask, ~bit, __ATOMIC_SEQ_CST) & bit) {
+            sched_send_ipi(cpu);
+            return;
+        }
+        idle &= idle - 1;
+    }
+}
+
+/**
+ * Time slice timer: only armed while a task of the same or better priority
+ * waits. Asks for a reschedule at the next interrupt exit, and re-arms so
+ * the request is repeated if the task had preemption disabled.
+ */
+static void sched_slice_expired(struct timer_list *timer)
+{
+    set_need_resched();
+    timer_mod(timer, ktime_get_ns() + SCHED_TIMESLICE_NS);
+}
+
+// restart: cur was just switched in, so any pending expiry belongs to prev
+static void sched_arm_slice(struct run_queue *rq, struct task *cur, int restart)
+{
+    if (!rq->active) {
+        return;
+    }
+    if (cur != this_cpu()->idle && (rq->bitmap & prio_mask_upto(cur->prio))) {
+        if (restart || !timer_pending(&rq->slice_timer)) {
+            timer_mod(&rq->slice_timer, cur->exec_start + cur->time_slice_ns);
+        }
+    } else {
+        timer_del(&rq->slice_timer);
+    }
+}
+
+// Queue a READY task on this CPU
+static void sched_enqueue(struct task *t)
+{
+    int cpu = smp_processor_id();
+    struct run_queue *rq = &run_queues[cpu];
+    struct task *cur = get_current();
+
+    rq_push(rq, t);
+
+    if (cur == this_cpu()->idle || ((1u << t->prio) & prio_mask_below(cur->prio))) {
+        set_need_resched();
+    } else {
+        sched_arm_slice(rq, cur, 0);
+        if (!task_is_pinned(t, cpu)) {
+            sched_kick_idle(cpu);
+        }
+    }
+}
+
+// Move tasks woken by other CPUs onto this CPU's rings
+static void sched_drain_wake_list(struct run_queue *rq)
+{
+    struct task *t = __atomic_exchange_n(&rq->wake_list, NULL, __ATOMIC_ACQUIRE);
+
+    while (t) {
+        struct task *next = t->next;
+        t->next = NULL;
+        sched_enqueue(t);
+        t = next;
+    }
+}
+
+static void sched_ipi_handler(interrupt_frame_t *frame, void *ctx)
+{
+    (void)frame;
+    (void)ctx;
+    // Whatever got queued, the idle loop re-checks once the IPI returns
+    sched_drain_wake_list(this_rq());
+}
+
+/**
+ * CPU a woken task goes to: where it last ran, if it still may. Never one
+ * outside allowed_cpus; if none of those runs tasks it waits on its own.
+ */
+static int sched_select_cpu(const struct task *t)
+{
+    uint32_t active = __atomic_load_n(&sched_active_mask, __ATOMIC_RELAXED);
+    uint32_t bit = 1u << t->cpu;
+
+    if ((t->allowed_cpus & bit) && (active & bit)) {
+        return t->cpu;
+    }
+    if (t->allowed_cpus & active) {
+        return __builtin_ctz(t->allowed_cpus & active);
+    }
+    if (t->allowed_cpus & bit) {
+        return t->cpu;
+    }
+    return __builtin_ctz(t->allowed_cpus);
+}
+
+void task_wake(struct task *t)
+{
+    uint32_t flags = irq_save();
+    task_state_t blocked = TASK_BLOCKED;
+
+    // Exactly one waker gets to queue it
+    if (__atomic_compare_exchange_n(&t->state, &blocked, TASK_READY, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        int cpu = sched_select_cpu(t);
+        if (cpu == smp_processor_id()) {
+            sched_enqueue(t);
+        } else {
+            struct run_queue *rq = &run_queues[cpu];
+            t->next = __atomic_load_n(&rq->wake_list, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&rq->wake_list, &t->next, t, 0,
+                                                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                cpu_relax();
+            }
+            __atomic_fetch_and(&sched_idle_mask, ~(1u << cpu), __ATOMIC_RELAXED);
+            sched_send_ipi(cpu);
+        }
+    }
+    irq_restore(flags);
+
+    // Called from a thread with interrupts on: preempt right here instead
+    // of at the next interrupt
+    if ((flags & EFLAGS_IF) && need_resched() && !get_current()->preempt_count) {
+        schedule();
+    }
+}
+
+void sched_set_prio(struct task *t, int prio)
+{
+    if (prio < 0) {
+        prio = 0;
+    } else if (prio >= MAX_PRIO) {
+        prio = MAX_PRIO - 1;
+    }
+
+    uint32_t flags = irq_save();
+    struct task *cur = get_current();
+    int cpu = smp_processor_id();
+
+    t->prio = prio;
+    if (t->state == TASK_READY && t->queued_prio != prio) {
+        // Its CPU moves it on its next pass through schedule()
+        __atomic_fetch_or(&run_queues[t->cpu].stale_levels, 1u << t->queued_prio,
+                          __ATOMIC_RELEASE);
+        if (t->cpu == cpu) {
+            if ((1u << prio) & prio_mask_below(cur->prio)) {
+                set_need_resched();
+            }
+        } else {
+            set_need_resched_cpu(t->cpu);
+            sched_send_ipi(t->cpu);
+        }
+    } else if (t == cur && (this_rq()->bitmap & prio_mask_below(prio))) {
+        // The running task dropped below something queued
+        set_need_resched();
+    }
+    irq_restore(flags);
+
+    if ((flags & EFLAGS_IF) && need_resched() && !cur->preempt_count) {
+        schedule();
+    }
+}
+
+/**
+ * Runs on the new task right after every switch (also the first one, from
+ * kthread_entry). `prev` is off the CPU now: other CPUs may pick it up, and
+ * if it exited its stack can be freed.
+ */
+void finish_task_switch(struct task *prev)
+{
+    if (prev->state == TASK_DEAD) {
+        task_free(prev);
+    } else {
+        __atomic_store_n(&prev->on_cpu, 0, __ATOMIC_RELEASE);
+    }
+    sched_arm_slice(this_rq(), get_current(), 1);
+}
+
+// Charge prev for the time since it was switched in
+static void sched_account(struct task *prev, uint64_t now)
+{
+    uint64_t ran = now - prev->exec_start;
+
+    prev->runtime_ns += ran;
+    prev->last_ran = now;
+    if (ran >= prev->time_slice_ns) {
+        prev->time_slice_ns = SCHED_TIMESLICE_NS;
+    } else {
+        prev->time_slice_ns -= ran;
+    }
+}
+
+/**
+ * Take a task from the busiest other CPU that has something this CPU may
+ * run. Only the head of each level is looked at, most urgent level first.
+ */
+static struct task* sched_steal(struct run_queue *rq, int cpu)
+{
+    if (!rq->active) {
+        return NULL;
+    }
+
+    uint32_t active = __atomic_load_n(&sched_active_mask, __ATOMIC_RELAXED) & ~(1u << cpu);
+    struct run_queue *busiest = NULL;
+    uint32_t max_running = 0;
+
+    for (; active; active &= active - 1) {
+        struct run_queue *other = &run_queues[__builtin_ctz(active)];
+        uint32_t running = __atomic_load_n(&other->nr_running, __ATOMIC_RELAXED);
+        if (running > max_running && __atomic_load_n(&other->nr_migratable, __ATOMIC_RELAXED)) {
+            busiest = other;
+            max_running = running;
+        }
+    }
+    if (!busiest) {
+        return NULL;
+    }
+
+    uint64_t now = ktime_get_ns();
+    uint32_t bitmap = __atomic_load_n(&busiest->bitmap, __ATOMIC_RELAXED);
+    for (; bitmap; bitmap &= bitmap - 1) {
+        struct task *t = rq_take(busiest, __builtin_ctz(bitmap), cpu, now);
+        if (t) {
+            rq->nr_steals++;
+            t->nr_migrations++;
+            trace_event("steal tid=%d cpu%d -> cpu%d", t->tid, t->cpu, cpu);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+void schedule(void)
+{
+    uint32_t flags = irq_save();
+    int cpu = smp_processor_id();
+    struct run_queue *rq = &run_queues[cpu];
+    struct task *prev = get_current();
+    struct task *idle = this_cpu()->idle;
+
+    __atomic_store_n(&this_cpu()->need_resched, 0, __ATOMIC_SEQ_CST);
+    sched_drain_wake_list(rq);
+    rq_requeue_stale(rq);
+
+    uint64_t now = ktime_get_ns();
+    if (prev->state == TASK_RUNNING && prev != idle) {
+        // Only give way to tasks at least as urgent
+        if (!(rq->bitmap & prio_mask_upto(prev->prio))) {
+            irq_restore(flags);
+            return;
+        }
+        // Charged before it is queued: thieves go by last_ran, and on_cpu
+        // keeps them off it until it is switched out
+        sched_account(prev, now);
+        prev->state = TASK_READY;
+        rq_push(rq, prev);
+    } else {
+        sched_account(prev, now);
+    }
+
+    struct task *next = rq_pop(rq);
+    if (!next) {
+        next = sched_steal(rq, cpu);
+    }
+    if (!next) {
+        // prev blocked or exited with nothing runnable anywhere
+        next = idle;
+    } else if (__atomic_load_n(&rq->nr_migratable, __ATOMIC_RELAXED)) {
+        // More queued here than this CPU can run now
+        sched_kick_idle(cpu);
+    }
+
+    next->state = TASK_RUNNING;
+    next->exec_start = now;
+    next->cpu = cpu;
+
+    if (next == prev) {
+        // Woken up again before it got switched out
+        sched_arm_slice(rq, prev, 1);
+        irq_restore(flags);
+        return;
+    }
+
+    if (prev == idle) {
+        prev->state = TASK_READY;
+    }
+    // Woken onto this CPU while another one is still switching it out:
+    // wait until that CPU is off its stack
+    while (__atomic_load_n(&next->on_cpu, __ATOMIC_ACQUIRE)) {
+        cpu_relax();
+    }
+    next->on_cpu = 1;
+    next->nr_switches++;
+    task_sync_stack_tlb(next);
+    trace_event("switch tid=%d -> tid=%d prio=%d", prev->tid, next->tid, next->prio);
+    this_cpu()->current = next;
+    prev = switch_to(prev, next);
+
+    // Back on this task's stack; `prev` is whoever ran just before us
+    finish_task_switch(prev);
+    irq_restore(flags);
+}
+
+void yield(void)
+{
+    schedule();
+}
+
+/**
+ * Called from isr_common when some CPU needs a reschedule. The frame tells
+ * whether the interrupted code could be switched away from: not if it had
+ * interrupts off (an irq_save section or a nested exception).
+ */
+void preempt_schedule_irq(interrupt_frame_t *frame)
+{
+    struct task *cur = get_current();
+
+    if (!cur || !need_resched()) {
+        return;
+    }
+    if (!(frame->eflags & EFLAGS_IF) || cur->preempt_count) {
+        return;
+    }
+
+    if (cur != this_cpu()->idle) {
+        this_rq()->nr_preemptions++;
+    }
+    schedule();
+}
+
+// Work this CPU could run or steal; the idle loop must not halt on it
+static int sched_has_work(int cpu)
+{
+    struct run_queue *rq = &run_queues[cpu];
+    if (rq->bitmap || __atomic_load_n(&rq->wake_list, __ATOMIC_RELAXED) || need_resched()) {
+        return 1;
+    }
+    if (!rq->active) {
+        return 0;
+    }
+
+    uint32_t others = __atomic_load_n(&sched_active_mask, __ATOMIC_RELAXED) & ~(1u << cpu);
+    for (; others; others &= others - 1) {
+        if (__atomic_load_n(&run_queues[__builtin_ctz(others)].nr_migratable, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Idle task. Announces itself in sched_idle_mask before the last look for
+ * work, so a CPU queueing a task afterwards sees the bit and kicks it; one
+ * that queued just before is seen by sched_has_work(). Stealable tasks that
+ * are still cache hot keep the loop polling rather than halted.
+ */
+void sched_idle(void *arg)
+{
+    int cpu = smp_processor_id();
+    uint32_t bit = 1u << cpu;
+    (void)arg;
+
+    for (;;) {
+        schedule();
+
+        irq_disable();
+        if (run_queues[cpu].active) {
+            __atomic_fetch_or(&sched_idle_mask, bit, __ATOMIC_SEQ_CST);
+        }
+        if (sched_has_work(cpu)) {
+            irq_enable();
+        } else {
+            cpu_idle();
+        }
+        __atomic_fetch_and(&sched_idle_mask, ~bit, __ATOMIC_RELAXED);
+    }
+}
+
+static void msleep_wake(struct timer_list *timer)
+{
+    task_wake((struct task*)timer->data);
+}
+
+void msleep(uint32_t ms)
+{
+    struct task *cur = get_current();
+    struct timer_list timer;
+
+    timer_setup(&timer, msleep_wake, cur);
+
+    uint32_t flags = irq_save();
+    // The timer is on this CPU's wheel: come back here to delete it
+    cur->migrate_disable++;
+    cur->state = TASK_BLOCKED;
+    timer_mod(&timer, ktime_get_ns() + (uint64_t)ms * NSEC_PER_MSEC);
+    schedule();
+    irq_restore(flags);
+
+    timer_del(&timer);
+    cur->migrate_disable--;
+}
+
+uint32_t sched_nr_preemptions(void)
+{
+    return this_rq()->nr_preemptions;
+}
+
+uint32_t sched_nr_steals(int cpu)
+{
+    return run_queues[cpu].nr_steals;
+}
+
+int sched_cpu_active(int cpu)
+{
+    return (__atomic_load_n(&sched_active_mask, __ATOMIC_RELAXED) >> cpu) & 1;
+}
+
+void sched_init_cpu(void)
+{
+    int cpu = smp_processor_id();
+
+    run_queues[cpu].active = 1;
+    __atomic_fetch_or(&sched_active_mask, 1u << cpu, __ATOMIC_SEQ_CST);
+}
+
+void sched_init(void)
+{
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        timer_setup(&run_queues[cpu].slice_timer, sched_slice_expired, NULL);
+    }
+
+    if (apic_available() &&
+        irq_register_handler(LAPIC_IPI_VECTOR, sched_ipi_handler, NULL) < 0) {
+        pr_err("[SCHED] Could not register the reschedule IPI\n");
+    }
+    sched_init_cpu();
+}
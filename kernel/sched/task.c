@@ -0,0 +1,288 @@
+#include "task.h"
+#include "paging.h"
+#include "pmm.h"
+#include "printk.h"
+#include "panik.h"
+#include "clock.h"
+#include "arch/x86/interrupt.h"
+
+struct task tasks[CONFIG_MAX_TASKS];
+
+static int next_tid = 1;
+
+/*
+Stack mappings are only invalidated in the TLB of the CPU that changes
+them. Each slot counts how often its stack was mapped, and each CPU the
+count it last ran a thread of that slot at; a CPU switching to a thread
+whose slot was remapped since flushes the stale entries first.
+*/
+static uint32_t stack_gen[CONFIG_MAX_TASKS];
+static uint32_t stack_gen_seen[NR_CPUS][CONFIG_MAX_TASKS];
+
+// First `ret` of a new thread lands here (switch_to.asm)
+extern void kthread_start(void);
+
+static void task_set_name(struct task *t, const char *name)
+{
+    int i = 0;
+    for (; name && name[i] && i < TASK_NAME_LEN - 1; i++) {
+        t->name[i] = name[i];
+    }
+    t->name[i] = '\0';
+}
+
+static inline uint32_t task_stack_slot(const struct task *t)
+{
+    return KTHREAD_STACK_AREA_BOTTOM + (uint32_t)(t - tasks) * KTHREAD_STACK_SLOT;
+}
+
+// Unmap and free every page of a thread stack; the guard page was never mapped
+static void task_unmap_stack(struct task *t)
+{
+    for (uint32_t virt = t->stack_bottom; virt < t->stack_top; virt += PAGE_SIZE) {
+        uint32_t phys = paging_unmap_page(virt);
+        if (phys) {
+            pmm_free_frame((void*)phys);
+        }
+    }
+}
+
+void task_init(void)
+{
+    struct task *boot = &tasks[0];
+
+    boot->tid = 0;
+    boot->state = TASK_RUNNING;
+    boot->prio = DEFAULT_PRIO;
+    boot->time_slice_ns = SCHED_TIMESLICE_NS;
+    task_set_name(boot, "boot");
+    boot->stack_bottom = KERNEL_STACK_BOTTOM_VIRT + PAGE_SIZE;
+    boot->stack_top = KERNEL_STACK_TOP_VIRT;
+    boot->exec_start = ktime_get_ns();
+    boot->on_cpu = 1;
+    // Brings up the boot CPU's devices; keep it where they were set up
+    boot->cpu = smp_processor_id();
+    boot->allowed_cpus = 1u << boot->cpu;
+    this_cpu()->current = boot;
+
+    this_cpu()->idle = task_create_idle(boot->cpu);
+    if (!this_cpu()->idle) {
+        panik("No idle task for the boot CPU");
+    }
+
+    sched_init();
+
+    printk("[TASK] %d thread slots, %u KiB stacks at 0x%08x-0x%08x\n",
+           CONFIG_MAX_TASKS, KTHREAD_STACK_SIZE / 1024,
+           KTHREAD_STACK_AREA_BOTTOM, KTHREAD_STACK_AREA_TOP);
+}
+
+// Claim a task slot and map its stack. The task is BLOCKED (off every run
+// queue) until the caller makes it runnable.
+static struct task* task_alloc(const char *name)
+{
+    struct task *t = NULL;
+
+    // Other CPUs may be creating threads too: claim the slot atomically
+    for (int i = 1; i < CONFIG_MAX_TASKS; i++) {
+        task_state_t unused = TASK_UNUSED;
+        if (__atomic_compare_exchange_n(&tasks[i].state, &unused, TASK_BLOCKED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            t = &tasks[i];
+            t->tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    if (!t) {
+        pr_err("[TASK] No free task slot for '%s'\n", name);
+        return NULL;
+    }
+
+    uint32_t slot = task_stack_slot(t);
+    t->stack_bottom = slot + PAGE_SIZE;
+    t->stack_top = slot + KTHREAD_STACK_SLOT;
+
+    for (uint32_t virt = t->stack_bottom; virt < t->stack_top; virt += PAGE_SIZE) {
+        void *frame = pmm_alloc_frame();
+        if (!frame) {
+            pr_err("[TASK] Out of memory for '%s' stack\n", name);
+            task_unmap_stack(t);
+            __atomic_store_n(&t->state, TASK_UNUSED, __ATOMIC_RELEASE);
+            return NULL;
+        }
+        paging_map_page(virt, (uint32_t)frame, PAGE_PRESENT | PAGE_WRITE);
+    }
+    int idx = (int)(t - tasks);
+    stack_gen_seen[smp_processor_id()][idx] = __atomic_add_fetch(&stack_gen[idx], 1, __ATOMIC_RELEASE);
+
+    task_set_name(t, name);
+    t->esp = t->stack_top;
+    t->fn = NULL;
+    t->arg = NULL;
+    t->next = NULL;
+    t->prio = DEFAULT_PRIO;
+    t->preempt_count = 0;
+    t->time_slice_ns = SCHED_TIMESLICE_NS;
+    t->cpu = smp_processor_id();
+    t->allowed_cpus = CPU_MASK_ALL;
+    t->on_cpu = 0;
+    t->migrate_disable = 0;
+    t->last_ran = 0;
+    t->runtime_ns = 0;
+    t->nr_switches = 0;
+    t->nr_migrations = 0;
+    return t;
+}
+
+// Build the frame switch_to() pops: zeroed registers, then kthread_start
+static void task_setup_frame(struct task *t, void (*fn)(void *arg), void *arg)
+{
+    struct task_context *ctx = (struct task_context*)(t->stack_top - sizeof(*ctx));
+    ctx->edi = 0;
+    ctx->esi = 0;
+    ctx->ebx = 0;
+    ctx->ebp = 0;           // Terminates frame-pointer walks
+    ctx->eip = (uint32_t)kthread_start;
+    t->esp = (uint32_t)ctx;
+    t->fn = fn;
+    t->arg = arg;
+}
+
+static struct task* kthread_create_mask(void (*fn)(void *arg), void *arg, const char *name,
+                                        int cpu, uint32_t allowed_cpus)
+{
+    struct task *t = task_alloc(name);
+    if (!t) {
+        return NULL;
+    }
+
+    task_setup_frame(t, fn, arg);
+    t->cpu = cpu;
+    t->allowed_cpus = allowed_cpus;
+
+    pr_debug("[TASK] Created '%s' tid=%d stack=0x%08x-0x%08x\n",
+             t->name, t->tid, t->stack_bottom, t->stack_top);
+
+    task_wake(t);
+    return t;
+}
+
+struct task* kthread_create(void (*fn)(void *arg), void *arg, const char *name)
+{
+    return kthread_create_mask(fn, arg, name, smp_processor_id(), CPU_MASK_ALL);
+}
+
+struct task* kthread_create_on_cpu(void (*fn)(void *arg), void *arg, const char *name, int cpu)
+{
+    // Nothing would ever run it there
+    if (cpu < 0 || cpu >= NR_CPUS || !sched_cpu_active(cpu)) {
+        return NULL;
+    }
+    return kthread_create_mask(fn, arg, name, cpu, 1u << cpu);
+}
+
+struct task* task_create_idle(int cpu)
+{
+    char name[TASK_NAME_LEN] = "idle/0";
+    name[5] = (char)('0' + cpu);
+
+    struct task *t = task_alloc(name);
+    if (!t) {
+        return NULL;
+    }
+
+    // The boot CPU switches to it through this frame; an AP starts on the
+    // top of the stack directly and calls sched_idle() itself
+    task_setup_frame(t, sched_idle, NULL);
+    t->state = TASK_READY;
+    t->prio = IDLE_PRIO;
+    t->cpu = cpu;
+    t->allowed_cpus = 1u << cpu;
+    return t;
+}
+
+/**
+ * C entry of every new thread, called by kthread_start with the task that
+ * ran before it. schedule() disabled interrupts before switching and the
+ * new thread has no irq_restore() of its own to return into, so finish
+ * the switch and turn them back on here.
+ */
+void kthread_entry(struct task *prev)
+{
+    finish_task_switch(prev);
+    irq_enable();
+
+    struct task *self = get_current();
+    self->fn(self->arg);
+
+    kthread_exit();
+}
+
+void kthread_exit(void)
+{
+    irq_disable();
+    struct task *self = get_current();
+
+    pr_debug("[TASK] '%s' tid=%d exited after %llu ns\n",
+             self->name, self->tid, self->runtime_ns);
+
+    // Still running on this stack: the next task frees it
+    self->state = TASK_DEAD;
+    schedule();
+
+    panik("Dead task '%s' was scheduled again", self->name);
+
+    // panik() returns in PANIK_MODE_TEST; a dead task must not
+    for (;;) {
+        __asm__ __volatile__("cli; hlt");
+    }
+}
+
+void task_free(struct task *t)
+{
+    task_unmap_stack(t);
+    t->fn = NULL;
+    t->arg = NULL;
+    __atomic_store_n(&t->state, TASK_UNUSED, __ATOMIC_RELEASE);
+}
+
+void task_sync_stack_tlb(struct task *t)
+{
+    int idx = (int)(t - tasks);
+    int cpu = smp_processor_id();
+    uint32_t gen = __atomic_load_n(&stack_gen[idx], __ATOMIC_ACQUIRE);
+
+    if (idx == 0 || stack_gen_seen[cpu][idx] == gen) {
+        return;
+    }
+    for (uint32_t virt = t->stack_bottom; virt < t->stack_top; virt += PAGE_SIZE) {
+        __asm__ __volatile__("invlpg (%0)" : : "r"(virt) : "memory");
+    }
+    stack_gen_seen[cpu][idx] = gen;
+}
+
+struct task* task_stack_guard_owner(uint32_t addr)
+{
+    if (addr < KTHREAD_STACK_AREA_BOTTOM || addr >= KTHREAD_STACK_AREA_TOP) {
+        return NULL;
+    }
+
+    uint32_t idx = (addr - KTHREAD_STACK_AREA_BOTTOM) / KTHREAD_STACK_SLOT;
+    uint32_t guard = KTHREAD_STACK_AREA_BOTTOM + idx * KTHREAD_STACK_SLOT;
+    if (addr >= guard + PAGE_SIZE || tasks[idx].state == TASK_UNUSED) {
+        return NULL;
+    }
+    return &tasks[idx];
+}
+
+int task_count(void)
+{
+    int count = 0;
+    for (int i = 0; i < CONFIG_MAX_TASKS; i++) {
+        if (tasks[i].state != TASK_UNUSED) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,39 @@
+#include "bench.h"
+#include "printk.h"
+#include "drivers/vga.h"
+
+BENCH(vsnprintf_string) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "%s", "Hello World");
+}
+
+BENCH(vsnprintf_int) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "%d", 123456789);
+}
+
+BENCH(vsnprintf_hex32) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "0x%08x", 0xdeadbeef);
+}
+
+BENCH(vsnprintf_u64) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "%llu", 18446744073709551615ULL);
+}
+
+BENCH(vsnprintf_hex64) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "0x%016llx", 0x123456789abcdef0ULL);
+}
+
+BENCH(vsnprintf_e820_line) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "[%u] Base: 0x%016llx, Length: 0x%016llx, Type: %s\n",
+                3, 0x100000ULL, 0x7ee0000ULL, "Available");
+}
+
+// One full line, so every sample scrolls the screen once
+BENCH(vga_print_string) {
+    vga_print_string("vga_print_string benchmark line\n", WHITE_ON_BLACK);
+}
@@ -0,0 +1,34 @@
+#include "bench.h"
+#include "pmm.h"
+#include "paging.h"
+
+// Heap pages the paging and page fault benchmarks map and unmap again
+#define BENCH_MAP_ADDR      (KERNEL_HEAP_END - 2 * PAGE_SIZE)
+#define BENCH_FAULT_ADDR    (KERNEL_HEAP_END - 1 * PAGE_SIZE)
+
+BENCH(pmm_alloc_frame) {
+    void *frame = pmm_alloc_frame();
+    bench_stop(bench);
+    pmm_free_frame(frame);
+}
+
+BENCH(pmm_free_frame) {
+    void *frame = pmm_alloc_frame();
+    bench_start(bench);
+    pmm_free_frame(frame);
+}
+
+BENCH(paging_map_page) {
+    void *frame = pmm_alloc_frame();
+    bench_start(bench);
+    paging_map_page(BENCH_MAP_ADDR, (uint32_t)frame, PAGE_PRESENT | PAGE_WRITE);
+    bench_stop(bench);
+    pmm_free_frame((void*)paging_unmap_page(BENCH_MAP_ADDR));
+}
+
+// Demand paging: fault entry, frame allocation, mapping and the return
+BENCH(heap_page_fault) {
+    *(volatile uint32_t*)BENCH_FAULT_ADDR = 1;
+    bench_stop(bench);
+    pmm_free_frame((void*)paging_unmap_page(BENCH_FAULT_ADDR));
+}
@@ -0,0 +1,89 @@
+#include "host.h"
+#include "bench.h"
+#include "printk.h"
+#include "pmm.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+Host benchmarks (make host-bench): the same BENCH() harness as the kernel,
+cycles from the host TSC. The libc_* entries run the C library's snprintf
+on the same input as the vsnprintf_* ones next to them.
+*/
+
+BENCH(vsnprintf_int) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "%d", 123456789);
+}
+
+BENCH(libc_snprintf_int) {
+    char out[128];
+    snprintf(out, sizeof(out), "%d", 123456789);
+}
+
+BENCH(vsnprintf_hex64) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "0x%016llx", 0x123456789abcdef0ULL);
+}
+
+BENCH(libc_snprintf_hex64) {
+    char out[128];
+    snprintf(out, sizeof(out), "0x%016llx", 0x123456789abcdef0ULL);
+}
+
+BENCH(vsnprintf_e820_line) {
+    char out[128];
+    my_snprintf(out, sizeof(out), "[%u] Base: 0x%016llx, Length: 0x%016llx, Type: %s\n",
+                3, 0x100000ULL, 0x7ee0000ULL, "Available");
+}
+
+BENCH(libc_snprintf_e820_line) {
+    char out[128];
+    snprintf(out, sizeof(out), "[%u] Base: 0x%016llx, Length: 0x%016llx, Type: %s\n",
+             3, 0x100000ULL, 0x7ee0000ULL, "Available");
+}
+
+// Stamp, format and copy into the log ring; below the console level
+BENCH(printk_ring_only) {
+    printk(KERN_DEBUG "bench record %u\n", 42u);
+}
+
+BENCH(trace_event) {
+    trace_event("bench event %u", 42u);
+}
+
+// The first 32MiB are taken, so every allocation scans past them
+BENCH(pmm_alloc_frame) {
+    void *frame = pmm_alloc_frame();
+    bench_stop(bench);
+    pmm_free_frame(frame);
+}
+
+// 128MiB of RAM above 1MiB
+static const memory_region_t bench_map[] = {
+    { 0x00000000, 0x0009FC00, E820_TYPE_AVAILABLE },
+    { 0x00100000, 0x07F00000, E820_TYPE_AVAILABLE },
+};
+
+int main(void)
+{
+    host_tsc_calibrate();
+    printk_init();
+    printk_set_console_loglevel(LOGLEVEL_INFO);
+
+    usable_memory_region[0] = bench_map[0];
+    usable_memory_region[1] = bench_map[1];
+    usable_memory_region_count = 2;
+    host_frame_bitmap = malloc((0x8000000 / PAGE_SIZE + 31) / 32 * sizeof(uint32_t));
+    host_console_quiet = 1;
+    pmm_init();
+    pmm_start_deferred_init();
+    pmm_set_frame_bitmap(0, 0x2000000);
+    host_console_quiet = 0;
+
+    bench_run_all();
+
+    free(host_frame_bitmap);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+Host build of the portable kernel code (make host-test, make host-bench).
+    printk.c (my_vsnprintf and the log ring), trace.c, pmm.c and
+    spinlock.c are compiled for the Linux host and run as a normal
+    process, with AddressSanitizer and UBSan in the test build. This file
+    is force-included (-include) into every translation unit:
+
+    - KERNEL_HOST swaps the few helpers that cannot run in user mode
+      (cli/sti, %fs per-CPU reads, rep stosd) for plain C; see smp.h,
+      arch/x86/interrupt.h and arch/x86/cpu.h.
+    - The PMM bitmap lives in host_frame_bitmap, sized by the test for
+      the simulated memory map, so an overrun is a sanitizer report.
+
+host_stubs.c stands in for the hardware: VGA and serial output go to
+stdout, the memory map is whatever the test puts in usable_memory_region[],
+and there is one CPU and no scheduler.
+*/
+
+#define KERNEL_HOST     1
+
+#include <stdint.h>
+
+extern uint8_t *host_frame_bitmap;
+#define PMM_BITMAP_ADDR ((uintptr_t)host_frame_bitmap)
+
+// Failed checks, the kernel suites' test_fail() included; main() exits
+// non-zero on any
+extern int host_failures;
+// Set to keep the VGA and serial stubs from echoing to stdout
+extern int host_console_quiet;
+
+#define HOST_EXPECT(cond, fmt, ...) \
+    do { \
+        if (!(cond)) { \
+            host_failures++; \
+            host_printf("[FAIL] %s:%d: " fmt "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// printf to stdout; the kernel's own printk goes to the log ring as well
+void host_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Calibrate tsc_khz/tsc_mult/tsc_shift against CLOCK_MONOTONIC
+void host_tsc_calibrate(void);
+
+// Host test suites
+void run_host_printk_tests(void);
+void run_host_trace_tests(void);
+void run_host_pmm_tests(void);
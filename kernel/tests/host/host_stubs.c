@@ -0,0 +1,125 @@
+#include "host.h"
+#include "boot_info.h"
+#include "memory_map.h"
+#include "smp.h"
+#include "task.h"
+#include "drivers/vga.h"
+#include "drivers/serial.h"
+#include "arch/x86/tsc.h"
+#include "tests/test_runner.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+int host_failures;
+int host_console_quiet;
+
+uint8_t *host_frame_bitmap;
+
+// --- Boot and memory map (filled in by the tests) ---
+struct boot_info boot_info;
+memory_region_t usable_memory_region[MAX_MEMORY_REGIONS];
+uint16_t usable_memory_region_count;
+
+// pmm.c falls back to these when boot_info has no kernel range
+char kernel_start;
+char kernel_end;
+
+// --- One CPU, no scheduler ---
+struct cpu_data cpu_data[NR_CPUS];
+
+// No threads: pmm_start_deferred_init() then onlines memory synchronously
+struct task* kthread_create(void (*fn)(void *arg), void *arg, const char *name)
+{
+    (void)fn;
+    (void)arg;
+    (void)name;
+    return NULL;
+}
+
+void sched_set_prio(struct task *t, int prio)
+{
+    (void)t;
+    (void)prio;
+}
+
+void yield(void)
+{
+}
+
+// The kernel's own suites report checks here (tests/test_runner.h)
+void test_check(void)
+{
+}
+
+void test_fail(void)
+{
+    host_failures++;
+}
+
+// --- Console ---
+void vga_init(void)
+{
+}
+
+void vga_print_string(const char *str, char color)
+{
+    (void)color;
+    if (!host_console_quiet) {
+        fputs(str, stdout);
+    }
+}
+
+void serial_print_string(const char *str)
+{
+    if (!host_console_quiet) {
+        fputs(str, stdout);
+    }
+}
+
+void host_printf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+// --- TSC ---
+uint32_t tsc_khz;
+uint32_t tsc_mult;
+uint32_t tsc_shift;
+
+static uint64_t host_monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Same scale as tsc.c: the largest shift whose mult still fits in 32 bits
+void host_tsc_calibrate(void)
+{
+    uint64_t ns0 = host_monotonic_ns();
+    uint64_t tsc0 = rdtsc();
+    while (host_monotonic_ns() - ns0 < TSC_CALIBRATE_MS * 1000000ULL) {
+        cpu_relax();
+    }
+    uint64_t tsc1 = rdtsc();
+    uint64_t ns1 = host_monotonic_ns();
+
+    uint32_t khz = (uint32_t)((tsc1 - tsc0) * 1000000ULL / (ns1 - ns0));
+    uint32_t shift = 32;
+    uint64_t mult;
+    for (;;) {
+        mult = (1000000ULL << shift) / khz;
+        if (mult <= 0xFFFFFFFF || shift == 0) {
+            break;
+        }
+        shift--;
+    }
+
+    tsc_khz = khz;
+    tsc_shift = shift;
+    tsc_mult = (uint32_t)mult;
+}
@@ -0,0 +1,24 @@
+#include "host.h"
+#include "printk.h"
+#include "tests/test_printk.h"
+
+int main(void)
+{
+    host_tsc_calibrate();
+    printk_init();
+
+    // The kernel's own suites, unchanged
+    run_vsnprintf_tests();
+    run_log_reader_tests();
+
+    run_host_printk_tests();
+    run_host_trace_tests();
+    run_host_pmm_tests();
+
+    if (host_failures) {
+        host_printf("host tests: %d failed checks\n", host_failures);
+        return 1;
+    }
+    host_printf("host tests: all passed\n");
+    return 0;
+}
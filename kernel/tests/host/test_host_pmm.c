@@ -0,0 +1,148 @@
+#include "host.h"
+#include "pmm.h"
+#include "memory_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Simulated memory map, roughly what QEMU reports for 128MiB plus a small
+region that does not start on a frame boundary:
+    0x00000000 - 0x0009FC00     159 frames (the last partial frame is not usable)
+    0x00100000 - 0x07FE0000     32480 frames
+    0x10000800 - 0x10003800     2 whole frames
+*/
+static const memory_region_t host_map[] = {
+    { 0x00000000, 0x0009FC00, E820_TYPE_AVAILABLE },
+    { 0x00100000, 0x07EE0000, E820_TYPE_AVAILABLE },
+    { 0x10000800, 0x00003000, E820_TYPE_AVAILABLE },
+};
+
+#define HOST_MAP_FRAMES     (159 + 32480 + 2)
+#define HOST_MAX_FRAME      (0x10003800 / PAGE_SIZE)
+
+static uint8_t frame_owned[HOST_MAX_FRAME];
+
+// Load host_map and run pmm_init() on a bitmap of exactly the size it needs
+static void host_pmm_init(void)
+{
+    memcpy(usable_memory_region, host_map, sizeof(host_map));
+    usable_memory_region_count = sizeof(host_map) / sizeof(host_map[0]);
+
+    free(host_frame_bitmap);
+    host_frame_bitmap = malloc((HOST_MAX_FRAME + 31) / 32 * sizeof(uint32_t));
+    host_console_quiet = 1;
+    pmm_init();
+    host_console_quiet = 0;
+}
+
+static int host_frame_usable(uint32_t frame)
+{
+    uint64_t addr = (uint64_t)frame * PAGE_SIZE;
+    for (uint32_t i = 0; i < sizeof(host_map) / sizeof(host_map[0]); i++) {
+        if (addr >= host_map[i].base && addr + PAGE_SIZE <= host_map[i].base + host_map[i].length) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Allocate until the PMM runs dry, checking every frame, then free them all
+static uint32_t host_pmm_drain(void)
+{
+    uint32_t count = 0;
+    uintptr_t addr;
+
+    memset(frame_owned, 0, sizeof(frame_owned));
+    host_console_quiet = 1;
+    while ((addr = (uintptr_t)pmm_alloc_frame()) != 0) {
+        uint32_t frame = addr / PAGE_SIZE;
+        if (addr % PAGE_SIZE || frame >= HOST_MAX_FRAME || frame_owned[frame] || !host_frame_usable(frame)) {
+            HOST_EXPECT(0, "bad frame 0x%lx handed out", (unsigned long)addr);
+            break;
+        }
+        frame_owned[frame] = 1;
+        count++;
+    }
+    host_console_quiet = 0;
+
+    for (uint32_t frame = 0; frame < HOST_MAX_FRAME; frame++) {
+        if (frame_owned[frame]) {
+            pmm_free_frame((void*)((uintptr_t)frame * PAGE_SIZE));
+        }
+    }
+    return count;
+}
+
+static void test_pmm_reserve_and_alloc(void)
+{
+    host_pmm_init();
+    HOST_EXPECT(pmm_used_frames() == 0, "%u frames used after init", pmm_used_frames());
+
+    // Frame 0 is never handed out
+    void *first = pmm_alloc_frame();
+    HOST_EXPECT((uintptr_t)first == 0x1000, "first frame %p", first);
+    pmm_free_frame(first);
+
+    // Only the 159 usable frames below 1MiB count as newly used
+    host_console_quiet = 1;
+    pmm_reserve_memory_region(RESERVED_TYPE_INIT);
+    HOST_EXPECT(pmm_used_frames() == 159, "%u frames used after the low 1MiB", pmm_used_frames());
+    pmm_reserve_memory_region(RESERVED_TYPE_PSTORE | RESERVED_TYPE_PAGE_TABLE);
+    host_console_quiet = 0;
+    HOST_EXPECT(pmm_used_frames() == 159, "low memory reserved twice: %u", pmm_used_frames());
+
+    // Unaligned range across word boundaries: frames 261..330
+    pmm_set_frame_bitmap(0x100000 + 5 * PAGE_SIZE + 123, 0x100000 + 75 * PAGE_SIZE);
+    HOST_EXPECT(pmm_used_frames() == 159 + 70, "%u frames used after the range", pmm_used_frames());
+
+    uintptr_t expect[] = { 0x100000, 0x101000, 0x102000, 0x103000, 0x104000, 0x100000 + 75 * PAGE_SIZE };
+    void *frames[6];
+    for (int i = 0; i < 6; i++) {
+        frames[i] = pmm_alloc_frame();
+        HOST_EXPECT((uintptr_t)frames[i] == expect[i], "alloc %d got %p", i, frames[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+        pmm_free_frame(frames[i]);
+    }
+
+    // Draining crosses CONFIG_PMM_EAGER_MB and reaches the unaligned region
+    uint32_t count = host_pmm_drain();
+    HOST_EXPECT(count == HOST_MAP_FRAMES - 159 - 70, "drained %u frames", count);
+    HOST_EXPECT(frame_owned[0x10001] && frame_owned[0x10002], "unaligned region not handed out");
+    HOST_EXPECT(pmm_used_frames() == 159 + 70, "%u frames used after the drain", pmm_used_frames());
+
+    // Out of range frees are refused
+    host_console_quiet = 1;
+    pmm_free_frame((void*)0xF0000000);
+    host_console_quiet = 0;
+    HOST_EXPECT(pmm_used_frames() == 159 + 70, "bad free changed the count");
+}
+
+static void test_pmm_deferred_init(void)
+{
+    host_pmm_init();
+
+    // Reserving memory that is not online yet must keep it reserved
+    // once the rest comes online
+    pmm_set_frame_bitmap(0x6000000, 0x6100000);
+    HOST_EXPECT(pmm_used_frames() == 256, "%u frames used above the eager range", pmm_used_frames());
+
+    // No scheduler on the host: this onlines everything right away
+    host_console_quiet = 1;
+    pmm_start_deferred_init();
+    host_console_quiet = 0;
+
+    uint32_t count = host_pmm_drain();
+    HOST_EXPECT(count == HOST_MAP_FRAMES - 1 - 256, "drained %u frames", count);
+    HOST_EXPECT(!frame_owned[0x6000], "reserved frame handed out");
+}
+
+void run_host_pmm_tests(void)
+{
+    host_printf("=== host: PMM bitmap ===\n");
+    test_pmm_reserve_and_alloc();
+    test_pmm_deferred_init();
+
+    free(host_frame_bitmap);
+    host_frame_bitmap = NULL;
+}
@@ -0,0 +1,131 @@
+#include "host.h"
+#include "printk.h"
+#include <stdio.h>
+#include <string.h>
+
+// my_snprintf must print what the C library prints
+#define FMT_SAME(fmt, ...) \
+    do { \
+        char ours[256], libc[256]; \
+        my_snprintf(ours, sizeof(ours), fmt, ##__VA_ARGS__); \
+        snprintf(libc, sizeof(libc), fmt, ##__VA_ARGS__); \
+        HOST_EXPECT(!strcmp(ours, libc), "\"%s\": \"%s\", libc \"%s\"", fmt, ours, libc); \
+    } while (0)
+
+static void test_vsnprintf_vs_libc(void)
+{
+    FMT_SAME("%d", 0);
+    FMT_SAME("%d", -5);
+    FMT_SAME("%05d", -5);
+    FMT_SAME("%-6d|", 42);
+    FMT_SAME("%+d", 7);
+    FMT_SAME("% d", 7);
+    FMT_SAME("%.3d", 5);
+    FMT_SAME("%8.3d", -5);
+    FMT_SAME("%.0d", 0);
+    FMT_SAME("%u", 3000000000u);
+    FMT_SAME("%10u", 99u);
+    FMT_SAME("%x", 0);
+    FMT_SAME("%08x", 0xdeadbeef);
+    FMT_SAME("%X", 0xabcU);
+    FMT_SAME("%#x", 255);
+    FMT_SAME("%#010x", 255);
+    FMT_SAME("%llu", 18446744073709551615ULL);
+    FMT_SAME("%lld", -9223372036854775807LL - 1);
+    FMT_SAME("%llx", 0x123456789abcdef0ULL);
+    FMT_SAME("%016llx", 0x9fc00ULL);
+    FMT_SAME("%llu", 4294967296ULL);
+    FMT_SAME("%zu", (size_t)12345);
+    FMT_SAME("%lu", 123456UL);
+    FMT_SAME("%ld", -123456L);
+    FMT_SAME("%s", "hi");
+    FMT_SAME("%5s|", "hi");
+    FMT_SAME("%-5s|", "hi");
+    FMT_SAME("%.1s", "hi");
+    FMT_SAME("%c%c", 'a', 'b');
+    FMT_SAME("%3c|", 'a');
+    FMT_SAME("%-3c|", 'a');
+    FMT_SAME("%d %d %d", 1, 22, 333);
+    FMT_SAME("%%");
+    FMT_SAME("%p", (void*)0xdeadbeef);
+
+    // Every power of 3 that fits, both halves of the 64-bit paths
+    uint64_t v = 1;
+    for (int i = 0; i < 41; i++, v *= 3) {
+        FMT_SAME("%llu", (unsigned long long)v);
+        FMT_SAME("%llx", (unsigned long long)v);
+    }
+    for (int i = -100000; i < 100000; i += 7) {
+        FMT_SAME("%d", i);
+    }
+}
+
+// Unlike snprintf, the return value is what was written, not what would have been
+static void test_vsnprintf_truncation(void)
+{
+    char out[4];
+    int len = my_snprintf(out, sizeof(out), "%d", 123456);
+    HOST_EXPECT(len == 3 && !strcmp(out, "123"), "truncated to \"%s\" (%d)", out, len);
+
+    len = my_snprintf(out, sizeof(out), "ab%");
+    HOST_EXPECT(len == 2 && !strcmp(out, "ab"), "trailing %% gave \"%s\" (%d)", out, len);
+
+    char canary[8] = "xxxxxxx";
+    len = my_snprintf(canary, 1, "%s", "overflow");
+    HOST_EXPECT(len == 0 && canary[0] == '\0' && canary[1] == 'x', "size 1 wrote past the NUL");
+}
+
+// Wrap the ring several times: what is left must be whole, consecutive records
+static void test_log_ring_wrap(void)
+{
+    const int records = 4000;
+    char rec[LOG_LINE_MAX];
+    struct log_iter it;
+
+    printk_init();
+    host_console_quiet = 1;
+    for (int i = 0; i < records; i++) {
+        printk("ring record %05d\n", i);
+    }
+    host_console_quiet = 0;
+
+    HOST_EXPECT(log_buffer_used() == LOG_RING_SIZE - 1, "ring holds %zu bytes", log_buffer_used());
+
+    int seen = 0;
+    int prev = -1;
+    log_iter_init(&it);
+    while (log_iter_next(&it, rec, sizeof(rec)) > 0) {
+        const char *msg = strstr(rec, "ring record ");
+        int n;
+        HOST_EXPECT(rec[0] == '[' && msg && sscanf(msg, "ring record %d", &n) == 1,
+                    "torn record \"%s\"", rec);
+        if (!msg) {
+            break;
+        }
+        sscanf(msg, "ring record %d", &n);
+        HOST_EXPECT(prev < 0 || n == prev + 1, "record %d follows %d", n, prev);
+        prev = n;
+        seen++;
+    }
+    HOST_EXPECT(prev == records - 1, "newest record is %d", prev);
+    HOST_EXPECT(seen > 0 && (size_t)seen * strlen("[    0.000000] ring record 00000\n") < LOG_RING_SIZE,
+                "%d records in the ring", seen);
+
+    // A short buffer hands a record out in pieces that add up to the whole
+    char piece[8];
+    size_t total = 0, len;
+    log_iter_init_tail(&it, 64);
+    while ((len = log_iter_next(&it, piece, sizeof(piece))) > 0) {
+        HOST_EXPECT(len < sizeof(piece), "piece of %zu bytes", len);
+        total += len;
+    }
+    HOST_EXPECT(total > 0 && total <= 64, "tail of %zu bytes", total);
+}
+
+void run_host_printk_tests(void)
+{
+    host_printf("=== host: my_vsnprintf / log ring ===\n");
+    test_vsnprintf_vs_libc();
+    test_vsnprintf_truncation();
+    test_log_ring_wrap();
+}
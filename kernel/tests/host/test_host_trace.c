@@ -0,0 +1,50 @@
+#include "host.h"
+#include "trace.h"
+#include "console.h"
+
+// Overrun the ring: the newest TRACE_RING_ENTRIES events survive, in slot order
+static void test_trace_ring_wrap(void)
+{
+    const uint32_t events = TRACE_RING_ENTRIES + 44;
+    struct trace_ring *ring = &trace_rings[0];
+
+    trace_reset();
+    trace_start();
+    for (uint32_t i = 0; i < events; i++) {
+        trace_event("host event %u of %u", i, events);
+    }
+    trace_stop();
+
+    HOST_EXPECT(ring->head == events, "head %u after %u events", ring->head, events);
+    for (uint32_t i = events - TRACE_RING_ENTRIES; i < events; i++) {
+        const struct trace_record *rec = &ring->rec[i & (TRACE_RING_ENTRIES - 1)];
+        HOST_EXPECT(rec->fmt && rec->args[0] == i && rec->args[1] == events,
+                    "slot of event %u holds event %u", i, rec->args[0]);
+    }
+
+    // Stamps never go backwards within the surviving window
+    for (uint32_t i = events - TRACE_RING_ENTRIES + 1; i < events; i++) {
+        const struct trace_record *prev = &ring->rec[(i - 1) & (TRACE_RING_ENTRIES - 1)];
+        const struct trace_record *rec = &ring->rec[i & (TRACE_RING_ENTRIES - 1)];
+        HOST_EXPECT(rec->tsc >= prev->tsc, "event %u stamped before event %u", i, i - 1);
+    }
+
+    // Stopped: nothing more is recorded
+    trace_event("host event after stop");
+    HOST_EXPECT(ring->head == events, "recorded while stopped");
+
+    host_console_quiet = 1;
+    trace_dump(CONSOLE_SERIAL);
+    host_console_quiet = 0;
+    HOST_EXPECT(!trace_enabled, "trace_dump() restarted a stopped trace");
+
+    trace_reset();
+    HOST_EXPECT(ring->head == 0 && !ring->rec[0].fmt, "trace_reset() left records");
+    trace_start();
+}
+
+void run_host_trace_tests(void)
+{
+    host_printf("=== host: trace ring ===\n");
+    test_trace_ring_wrap();
+}
@@ -0,0 +1,130 @@
+#include "printk.h"
+#include "clock.h"
+#include "timer.h"
+#include "smp.h"
+#include "tests/test_clock.h"
+#include "tests/test_runner.h"
+
+/**
+ * Clocksource and timer wheel tests
+ */
+static void test_ktime_monotonic(void)
+{
+    uint64_t prev = ktime_get_ns();
+    int backwards = 0;
+
+    for (int i = 0; i < 10000; i++) {
+        uint64_t now = ktime_get_ns();
+        if (now < prev) {
+            backwards++;
+        }
+        prev = now;
+    }
+    TEST_EXPECT(backwards == 0, "ktime_get_ns never goes backwards");
+}
+
+static void test_udelay_accuracy(void)
+{
+    uint64_t start = ktime_get_ns();
+    udelay(2000);
+    uint64_t elapsed = ktime_get_ns() - start;
+
+    printk("  udelay(2000) took %llu ns\n", elapsed);
+    // Generous bounds: a VM can steal time, but never run the TSC backwards
+    TEST_EXPECT(elapsed >= 2 * NSEC_PER_MSEC, "udelay waits at least as long as asked");
+    TEST_EXPECT(elapsed < 20 * NSEC_PER_MSEC, "udelay does not overshoot 10x");
+}
+
+static volatile int timer_order[4];
+static volatile int timer_fired;
+static volatile int timer_early;
+
+static void test_timer_fn(struct timer_list *t)
+{
+    if (ktime_get_ns() < t->expires) {
+        timer_early++;
+    }
+    timer_order[timer_fired++ & 3] = (int)(uintptr_t)t->data;
+}
+
+// Spin with interrupts on for `ms` milliseconds
+static void wait_with_irqs(uint32_t ms)
+{
+    uint32_t flags = irq_save();
+    irq_enable();
+    mdelay(ms);
+    irq_restore(flags);
+}
+
+static void test_timer_wheel(void)
+{
+    struct timer_list a, b, c, d;
+    uint64_t now = ktime_get_ns();
+
+    if (!clockevent_get()) {
+        pr_info("[SKIP] no clock event device\n");
+        return;
+    }
+
+    timer_fired = 0;
+    timer_early = 0;
+    timer_setup(&a, test_timer_fn, (void*)1);
+    timer_setup(&b, test_timer_fn, (void*)2);
+    timer_setup(&c, test_timer_fn, (void*)3);
+    timer_setup(&d, test_timer_fn, (void*)4);
+
+    // Added out of order; d is cancelled, c is moved after a
+    timer_mod(&b, now + 6 * NSEC_PER_MSEC);
+    timer_mod(&a, now + 2 * NSEC_PER_MSEC);
+    timer_mod(&c, now + 1 * NSEC_PER_MSEC);
+    timer_mod(&d, now + 4 * NSEC_PER_MSEC);
+    TEST_EXPECT(timer_del(&d) == 1, "timer_del of a pending timer returns 1");
+    TEST_EXPECT(timer_del(&d) == 0, "timer_del of an idle timer returns 0");
+    TEST_EXPECT(timer_mod(&c, now + 4 * NSEC_PER_MSEC) == 1, "timer_mod of a pending timer returns 1");
+
+    wait_with_irqs(20);
+
+    TEST_EXPECT(timer_fired == 3, "three timers fired, the cancelled one did not");
+    TEST_EXPECT(timer_order[0] == 1 && timer_order[1] == 3 && timer_order[2] == 2, "timers fired in expiry order");
+    TEST_EXPECT(timer_early == 0, "no timer fired early");
+    TEST_EXPECT(!timer_pending(&a) && !timer_pending(&b) && !timer_pending(&c), "fired timers are no longer pending");
+
+    // A long timeout sits in a coarse level and is cancelled before it fires
+    timer_mod(&d, ktime_get_ns() + 10 * NSEC_PER_SEC);
+    TEST_EXPECT(timer_next_expiry() >= d.expires, "next expiry is not before the only timer");
+    timer_del(&d);
+    TEST_EXPECT(timer_next_expiry() == TIMER_NEVER, "empty wheel has no next expiry");
+}
+
+static void test_tickless_idle(void)
+{
+    struct timer_stats *stats = &timer_stats[smp_processor_id()];
+
+    if (!clockevent_get()) {
+        return;
+    }
+
+    // Nothing queued: the one-shot device must stay silent
+    uint32_t before = stats->interrupts;
+    wait_with_irqs(50);
+    uint32_t wakeups = stats->interrupts - before;
+
+    printk("  %u timer interrupts in 50ms with no timers pending\n", wakeups);
+    TEST_EXPECT(wakeups <= 1, "no periodic tick while idle");
+}
+
+void run_clock_tests(void)
+{
+    pr_notice("=== CLOCK TESTS ===\n");
+
+    if (!tsc_khz) {
+        pr_err("[FAIL] TSC not calibrated\n");
+        test_fail();
+        return;
+    }
+
+    test_ktime_monotonic();
+    test_udelay_accuracy();
+    test_timer_wheel();
+    test_tickless_idle();
+}
@@ -0,0 +1,95 @@
+#include "printk.h"
+#include "arch/x86/interrupt.h"
+#include "arch/x86/irq.h"
+#include "arch/x86/pic.h"
+#include "arch/x86/apic.h"
+#include "arch/x86/acpi.h"
+#include "tests/test_interrupt.h"
+#include "tests/test_runner.h"
+
+/**
+ * Interrupt dispatch and IRQ controller tests
+ */
+// Software vector well above the controller range
+#define TEST_VECTOR 0x81
+
+static volatile uint32_t seen_vector;
+static void* volatile seen_ctx;
+
+static void test_vector_handler(interrupt_frame_t *frame, void *ctx)
+{
+    seen_vector = frame->vector;
+    seen_ctx = ctx;
+}
+
+static void test_software_dispatch(void)
+{
+    static int cookie;
+    uint32_t before = irq_get_count(TEST_VECTOR);
+
+    TEST_EXPECT(irq_register_handler(TEST_VECTOR, test_vector_handler, &cookie) == 0,
+                "register handler on free vector");
+    TEST_EXPECT(irq_register_handler(TEST_VECTOR, test_vector_handler, NULL) < 0,
+                "second handler on same vector rejected");
+
+    __asm__ __volatile__("int %0" :: "i"(TEST_VECTOR));
+
+    TEST_EXPECT(seen_vector == TEST_VECTOR, "handler sees its vector in the frame");
+    TEST_EXPECT(seen_ctx == &cookie, "handler receives its context");
+    TEST_EXPECT(irq_get_count(TEST_VECTOR) == before + 1, "vector hit counted");
+
+    irq_unregister_handler(TEST_VECTOR);
+}
+
+static void test_pic_masking(void)
+{
+    if (irq_chip_get() != &pic_8259_chip) {
+        pr_info("[SKIP] 8259 not the active controller\n");
+        return;
+    }
+
+    uint16_t saved = pic_get_mask();
+
+    TEST_EXPECT(!(saved & (1 << IRQ_CASCADE)), "cascade line unmasked");
+
+    irq_unmask(IRQ_LPT1);
+    TEST_EXPECT(!(pic_get_mask() & (1 << IRQ_LPT1)), "unmask clears the IMR bit");
+    irq_mask(IRQ_LPT1);
+    TEST_EXPECT(pic_get_mask() & (1 << IRQ_LPT1), "mask sets the IMR bit");
+
+    irq_unmask(IRQ_ATA_SECOND);
+    TEST_EXPECT(!(pic_get_mask() & (1 << IRQ_ATA_SECOND)), "slave line unmask");
+    irq_mask(IRQ_ATA_SECOND);
+
+    TEST_EXPECT(pic_get_mask() == saved, "mask restored");
+}
+
+static void test_apic_masking(void)
+{
+    if (irq_chip_get() != &apic_chip) {
+        pr_info("[SKIP] IOAPIC not the active controller\n");
+        return;
+    }
+
+    // IRQ1 (keyboard) is never overridden on PC hardware
+    uint64_t entry = ioapic_read_redirection(IRQ_KEYBOARD);
+    TEST_EXPECT((entry & 0xFF) == IRQ_VECTOR(IRQ_KEYBOARD), "IRQ1 routed to its vector");
+    TEST_EXPECT((entry >> 56) == lapic_id(), "IRQ1 routed to the BSP");
+    TEST_EXPECT(entry & IOAPIC_MASKED, "IRQ1 masked until requested");
+
+    irq_unmask(IRQ_KEYBOARD);
+    TEST_EXPECT(!(ioapic_read_redirection(IRQ_KEYBOARD) & IOAPIC_MASKED), "unmask clears the mask bit");
+    irq_mask(IRQ_KEYBOARD);
+    TEST_EXPECT(ioapic_read_redirection(IRQ_KEYBOARD) & IOAPIC_MASKED, "mask sets the mask bit");
+
+    TEST_EXPECT(acpi_madt.cpu_count >= 1, "MADT lists at least one CPU");
+}
+
+void run_interrupt_tests(void)
+{
+    pr_notice("=== INTERRUPT TESTS ===\n");
+
+    test_software_dispatch();
+    test_pic_masking();
+    test_apic_masking();
+}
@@ -2,6 +2,7 @@
 #include "../include/drivers/vga.h"
 #include "../include/panik.h"
 #include "../include/assert.h"
+#include "../include/tests/test_runner.h"
 #include <stddef.h>
 
 /**
@@ -12,24 +13,7 @@
  * and simulating panik scenarios.
  */
 
-// Test counters
-static int tests_run = 0;
-static int tests_passed = 0;
-static int tests_failed = 0;
-
 // Test result macros
-#define TEST_ASSERT(condition, message) \
-    do { \
-        tests_run++; \
-        if (condition) { \
-            tests_passed++; \
-            pr_info("[PASS] %s\n", message); \
-        } else { \
-            tests_failed++; \
-            pr_err("[FAIL] %s\n", message); \
-        } \
-    } while(0)
-
 #define TEST_START(test_name) \
     pr_notice("Starting test: %s\n", test_name)
 
@@ -52,7 +36,7 @@ void test_null_pointer_panik(void)
     }
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Null pointer panik triggered");
+    TEST_EXPECT(state->panik_called == 1, "Null pointer panik triggered");
 }
 
 void test_memory_corruption_panik(void)
@@ -72,7 +56,7 @@ void test_memory_corruption_panik(void)
     panik("Stack canary corruption detected at 0x%x", 0xDEADBEEF);
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Memory corruption panik triggered");
+    TEST_EXPECT(state->panik_called == 1, "Memory corruption panik triggered");
 }
 
 void test_division_by_zero_panik(void)
@@ -87,7 +71,7 @@ void test_division_by_zero_panik(void)
     }
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Division by zero panik triggered");
+    TEST_EXPECT(state->panik_called == 1, "Division by zero panik triggered");
 }
 
 void test_assert_failures(void)
@@ -99,14 +83,14 @@ void test_assert_failures(void)
     assert(2 + 2 == 5);  // Intentional failure
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Assert failure triggered panik");
+    TEST_EXPECT(state->panik_called == 1, "Assert failure triggered panik");
     
     // Test BUG_ON macro
     reset_panik_state();
     BUG_ON(1);  // Should always trigger
     
     state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "BUG_ON triggered panik");
+    TEST_EXPECT(state->panik_called == 1, "BUG_ON triggered panik");
 }
 
 void test_stack_overflow_panik(void)
@@ -118,7 +102,7 @@ void test_stack_overflow_panik(void)
     panik("Stack overflow detected: SP=0x%x limit=0x%x", 0x1000, 0x2000);
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Stack overflow panik triggered");
+    TEST_EXPECT(state->panik_called == 1, "Stack overflow panik triggered");
 }
 
 void test_hardware_fault_panik(void)
@@ -130,7 +114,7 @@ void test_hardware_fault_panik(void)
     panik("Page fault in kernel mode: CR2=0x%x EIP=0x%x", 0xDEADBEEF, 0x12345678);
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Hardware fault panik triggered");
+    TEST_EXPECT(state->panik_called == 1, "Hardware fault panik triggered");
 }
 
 void test_panik_with_real_formatting(void)
@@ -142,7 +126,7 @@ void test_panik_with_real_formatting(void)
     panik("Unable to mount root fs on unknown-block(%d,%d)", 8, 1);
     
     const panik_state_t* state = get_panik_state();
-    TEST_ASSERT(state->panik_called == 1, "Formatted panik message works");
+    TEST_EXPECT(state->panik_called == 1, "Formatted panik message works");
     
     pr_info("panik message: %s\n", state->last_panik_msg);
 }
@@ -158,10 +142,6 @@ void run_panik_unit_tests(void)
     set_panik_mode(PANIK_MODE_TEST);
     pr_info("panik mode: TEST (safe for testing)\n");
     
-    // Initialize counters
-    tests_run = 0;
-    tests_passed = 0;
-    
     // Run focused real-world tests
     test_null_pointer_panik();
     test_memory_corruption_panik();
@@ -171,18 +151,6 @@ void run_panik_unit_tests(void)
     test_hardware_fault_panik();
     test_panik_with_real_formatting();
     
-    // Test summary
-    pr_notice("\n=== TEST RESULTS ===\n");
-    pr_info("Tests run: %d\n", tests_run);
-    pr_info("Tests passed: %d\n", tests_passed);
-    pr_info("Tests failed: %d\n", tests_run - tests_passed);
-    
-    if (tests_passed == tests_run) {
-        pr_info("✓ All kernel panik scenarios tested successfully!\n");
-    } else {
-        pr_err("✗ Some tests failed!\n");
-    }
-    
     // Show panik statistics
     const panik_state_t* state = get_panik_state();
     pr_info("Total panik calls: %d\n", state->panik_call_count);
@@ -0,0 +1,72 @@
+#include "printk.h"
+#include "console.h"
+#include "perf.h"
+#include "arch/x86/interrupt.h"
+#include "tests/test_perf.h"
+#include "tests/test_runner.h"
+
+/**
+ * PMU and perf region tests
+ */
+#define PERF_LOOP_ITERS     100000
+
+static DEFINE_PERF_REGION(test_perf, "test_loop");
+
+// At least 3 instructions per iteration: add, dec, branch
+static __attribute__((noinline)) void perf_loop(uint32_t n)
+{
+    __asm__ __volatile__("1: add $1, %%eax\n\t"
+                         "dec %%ecx\n\t"
+                         "jnz 1b"
+                         : "+c"(n) : : "eax", "cc");
+}
+
+static void test_perf_region(void)
+{
+    struct perf_counts counts;
+
+    perf_region_reset(&test_perf);
+    for (int run = 0; run < 4; run++) {
+        uint32_t flags = irq_save();
+        perf_begin(&test_perf);
+        perf_loop(PERF_LOOP_ITERS);
+        perf_end(&test_perf);
+        irq_restore(flags);
+    }
+
+    perf_region_sum(&test_perf, &counts);
+    TEST_EXPECT(counts.runs == 4, "every run is counted");
+
+    perf_counts_per_run(&counts);
+    if (pmu.events & (1u << PMU_EV_INSTRUCTIONS)) {
+        uint64_t instr = counts.count[PMU_EV_INSTRUCTIONS];
+        TEST_EXPECT(instr >= 3 * PERF_LOOP_ITERS, "instructions cover the loop");
+        TEST_EXPECT(instr < 4 * PERF_LOOP_ITERS, "instructions are not counted twice");
+    }
+    if (pmu.events & (1u << PMU_EV_CYCLES)) {
+        TEST_EXPECT(counts.count[PMU_EV_CYCLES] > 0, "cycles advance");
+    }
+    if (pmu.events & (1u << PMU_EV_BRANCH_MISSES)) {
+        // One loop exit per run, plus whatever the predictor warms up on
+        TEST_EXPECT(counts.count[PMU_EV_BRANCH_MISSES] < PERF_LOOP_ITERS / 100,
+                    "a tight loop barely mispredicts");
+    }
+
+    perf_report(&test_perf, CONSOLE_ALL);
+
+    perf_region_reset(&test_perf);
+    perf_region_sum(&test_perf, &counts);
+    TEST_EXPECT(counts.runs == 0 && counts.count[PMU_EV_CYCLES] == 0, "perf_region_reset() clears the totals");
+}
+
+void run_perf_tests(void)
+{
+    printk("\n=== PMU Tests ===\n");
+
+    if (!pmu.events) {
+        pr_info("[SKIP] no hardware performance counters\n");
+        return;
+    }
+
+    test_perf_region();
+}
@@ -1,6 +1,7 @@
 #include "printk.h"
 #include "drivers/vga.h"
 #include "tests/test_printk.h"
+#include "tests/test_runner.h"
 
 void run_printk_tests(void) {
 
@@ -40,3 +41,73 @@ void run_printk_scrolling_test(void) {
         printk("Line %d - Testing kernel scrolling functionality\n", i);
     }
 }
+
+/**
+ * Formatter correctness tests
+ */
+// Like TEST_EXPECT, but only failures are logged, with the output
+#define FMT_EXPECT(expected, fmt, ...) \
+    do { \
+        char out[64]; \
+        test_check(); \
+        my_snprintf(out, sizeof(out), fmt, ##__VA_ARGS__); \
+        if (!test_str_equal(out, expected)) { \
+            pr_err("[FAIL] \"%s\" -> \"%s\" (expected \"%s\")\n", fmt, out, expected); \
+            test_fail(); \
+        } \
+    } while (0)
+
+void run_vsnprintf_tests(void) {
+    pr_notice("=== my_vsnprintf TESTS ===\n");
+
+    FMT_EXPECT("0", "%d", 0);
+    FMT_EXPECT("-2147483648", "%d", (int)0x80000000);
+    FMT_EXPECT("-0005", "%05d", -5);
+    FMT_EXPECT("42   |", "%-5d|", 42);
+    FMT_EXPECT("  005", "%5.3d", 5);
+    FMT_EXPECT("+7", "%+d", 7);
+    FMT_EXPECT("3000000000", "%u", 3000000000u);
+    FMT_EXPECT("deadbeef", "%x", 0xdeadbeef);
+    FMT_EXPECT("DEADBEEF", "%X", 0xdeadbeef);
+    FMT_EXPECT("0x00ff", "%#06x", 0xff);
+    FMT_EXPECT("18446744073709551615", "%llu", 18446744073709551615ULL);
+    FMT_EXPECT("-9223372036854775808", "%lld", (long long)0x8000000000000000ULL);
+    FMT_EXPECT("000000000009fc00", "%016llx", 0x9fc00ULL);
+    FMT_EXPECT("123456789abcdef0", "%llx", 0x123456789abcdef0ULL);
+    FMT_EXPECT("4096", "%zu", (size_t)4096);
+    FMT_EXPECT("-12", "%ld", -12L);
+    FMT_EXPECT("  hi|", "%4s|", "hi");
+    FMT_EXPECT("hi  |", "%-4s|", "hi");
+    FMT_EXPECT("ab", "%.2s", "abcdef");
+    FMT_EXPECT("(null)", "%s", (char*)NULL);
+    FMT_EXPECT("0xdeadbeef", "%p", (void*)0xdeadbeef);
+    FMT_EXPECT("100%", "%d%%", 100);
+}
+
+/**
+ * Log ring reader test: the last record read back must be the last line printed
+ */
+void run_log_reader_tests(void) {
+    char rec[LOG_LINE_MAX];
+    char last[LOG_LINE_MAX];
+    struct log_iter it;
+    int records = 0;
+
+    pr_notice("=== LOG READER TESTS ===\n");
+    printk("log reader marker %d\n", 4242);
+
+    last[0] = '\0';
+    log_iter_init_tail(&it, 128);
+    while (log_iter_next(&it, rec, sizeof(rec)) > 0) {
+        my_snprintf(last, sizeof(last), "%s", rec);
+        records++;
+    }
+
+    // With CONFIG_PRINTK_TIME the record starts with its "[time] " stamp
+    int found = records > 0 && test_str_ends_with(last, "log reader marker 4242\n") &&
+                (!CONFIG_PRINTK_TIME || last[0] == '[');
+    TEST_EXPECT(found, "last record read back from the log ring");
+    if (!found) {
+        pr_err("  last record was \"%s\"\n", last);
+    }
+}
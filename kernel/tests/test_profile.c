@@ -0,0 +1,78 @@
+#include "printk.h"
+#include "clock.h"
+#include "profile.h"
+#include "ksyms.h"
+#include "smp.h"
+#include "tests/test_profile.h"
+#include "tests/test_runner.h"
+
+/**
+ * Sampling profiler tests
+ */
+// Spin with interrupts on, so the sampling timer can land in here
+static __attribute__((noinline)) void profile_busy(uint32_t ms)
+{
+    uint32_t flags = irq_save();
+    irq_enable();
+    mdelay(ms);
+    irq_restore(flags);
+}
+
+// Does the sample's stack go through profile_busy()?
+static int profile_sample_in_busy(const struct profile_sample *sample)
+{
+    for (uint32_t i = 0; i < sample->depth; i++) {
+        uint32_t addr = i ? sample->pc[i] - 1 : sample->pc[i];
+        uint32_t offset;
+        if (ksym_lookup(addr, &offset) && addr - offset == (uint32_t)profile_busy) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void test_profile_samples(void)
+{
+    struct profile_buffer *buf = &profile_buffers[smp_processor_id()];
+
+    profile_reset();
+    profile_start(PROFILE_MAX_HZ, PROFILE_CALLCHAIN);
+    profile_busy(50);
+    profile_stop();
+
+    uint32_t in_busy = 0;
+    for (uint32_t i = 0; i < buf->count; i++) {
+        if (profile_sample_in_busy(&buf->samples[i])) {
+            in_busy++;
+        }
+    }
+
+    printk("  %u samples in 50ms, %u in profile_busy()\n", buf->count, in_busy);
+    TEST_EXPECT(buf->count > 0, "timer samples this CPU");
+    TEST_EXPECT(buf->count <= 50 * PROFILE_MAX_HZ / 1000 + 2, "no more samples than the rate allows");
+    TEST_EXPECT(in_busy > 0, "call chains reach the spinning function");
+
+    // Stopped: the timer lapses and records nothing more
+    uint32_t count = buf->count;
+    profile_busy(10);
+    TEST_EXPECT(buf->count == count, "no samples after profile_stop()");
+
+    profile_reset();
+    TEST_EXPECT(buf->count == 0 && buf->dropped == 0, "profile_reset() empties the buffer");
+}
+
+void run_profile_tests(void)
+{
+    printk("\n=== Profiler Tests ===\n");
+
+    if (!clockevent_get()) {
+        pr_info("[SKIP] no clock event device\n");
+        return;
+    }
+    if (CONFIG_PROFILE_HZ) {
+        pr_info("[SKIP] profiling the whole run (CONFIG_PROFILE_HZ)\n");
+        return;
+    }
+
+    test_profile_samples();
+}
@@ -0,0 +1,92 @@
+#include "printk.h"
+#include "console.h"
+#include "clock.h"
+#include "arch/x86/div64.h"
+#include "tests/test_runner.h"
+#include "tests/test_printk.h"
+#include "tests/test_interrupt.h"
+#include "tests/test_clock.h"
+#include "tests/test_task.h"
+#include "tests/test_smp.h"
+#include "tests/test_spinlock.h"
+#include "tests/test_profile.h"
+#include "tests/test_perf.h"
+#include "tests/test_trace.h"
+#include "tests/test_panik.h"
+
+struct kernel_test {
+    const char *name;
+    void (*fn)(void);
+};
+
+static const struct kernel_test kernel_tests[] = {
+    { "printk",         run_printk_tests },
+    { "printk_scroll",  run_printk_scrolling_test },
+    { "vsnprintf",      run_vsnprintf_tests },
+    { "log_reader",     run_log_reader_tests },
+    { "interrupt",      run_interrupt_tests },
+    { "clock",          run_clock_tests },
+    { "task",           run_task_tests },
+    { "smp",            run_smp_tests },
+    { "spinlock",       run_spinlock_tests },
+    { "profile",        run_profile_tests },
+    { "perf",           run_perf_tests },
+    { "trace",          run_trace_tests },
+    { "panik",          run_panik_unit_tests },
+};
+
+#define NR_KERNEL_TESTS (sizeof(kernel_tests) / sizeof(kernel_tests[0]))
+
+static volatile uint32_t test_checks;
+static volatile uint32_t test_failures;
+
+void test_check(void)
+{
+    __atomic_fetch_add(&test_checks, 1, __ATOMIC_RELAXED);
+}
+
+void test_fail(void)
+{
+    __atomic_fetch_add(&test_failures, 1, __ATOMIC_RELAXED);
+}
+
+int run_kernel_tests(void)
+{
+    char line[128];
+    int passed = 0;
+    int failed = 0;
+
+    printk("\n==================================================\n");
+    printk("Tests Running...\n");
+
+    for (uint32_t i = 0; i < NR_KERNEL_TESTS; i++) {
+        const struct kernel_test *test = &kernel_tests[i];
+        uint32_t checks = test_checks;
+        uint32_t failures = test_failures;
+        uint64_t start = ktime_get_ns();
+
+        test->fn();
+
+        uint64_t us = ktime_get_ns() - start;
+        do_div_u64(&us, 1000);
+        checks = test_checks - checks;
+        failures = test_failures - failures;
+        if (failures) {
+            failed++;
+        } else {
+            passed++;
+        }
+        printk("Suite %s: %u checks, %u failed\n", test->name, checks, failures);
+
+        my_snprintf(line, sizeof(line), "TEST name=%s result=%s failures=%u us=%llu\n",
+                    test->name, failures ? "FAIL" : "PASS", failures, us);
+        console_write(CONSOLE_SERIAL, line, 0);
+    }
+
+    printk("==================================================\n");
+    printk("Test suites: %d passed, %d failed\n", passed, failed);
+
+    my_snprintf(line, sizeof(line), "TEST done passed=%d failed=%d\n", passed, failed);
+    console_write(CONSOLE_SERIAL, line, 0);
+    return failed;
+}
@@ -0,0 +1,58 @@
+#include "printk.h"
+#include "smp.h"
+#include "task.h"
+#include "arch/x86/gdt.h"
+#include "arch/x86/tss.h"
+#include "tests/test_smp.h"
+#include "tests/test_runner.h"
+
+/**
+ * Per-CPU data and AP bring-up tests
+ */
+static void test_percpu_segment(void)
+{
+    uint16_t fs;
+    __asm__ __volatile__("mov %%fs, %0" : "=r"(fs));
+
+    TEST_EXPECT(fs == GDT_PERCPU_SEL, "%fs holds the per-CPU selector");
+    TEST_EXPECT(smp_processor_id() == 0, "tests run on the boot CPU");
+    TEST_EXPECT(this_cpu() == &cpu_data[0], "this_cpu() is the boot CPU's area");
+}
+
+static void test_cpus_online(void)
+{
+    int online = 0;
+    int distinct = 1;
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (!cpu_data[cpu].online) {
+            continue;
+        }
+        online++;
+        for (int other = 0; other < cpu; other++) {
+            if (cpu_data[other].online && cpu_data[other].apic_id == cpu_data[cpu].apic_id) {
+                distinct = 0;
+            }
+        }
+        printk("  CPU%d: APIC ID %u, double fault stack 0x%08x\n", cpu,
+               cpu_data[cpu].apic_id, tss_df[cpu].esp);
+    }
+
+    TEST_EXPECT(online == smp_num_cpus(), "online flags match the CPU count");
+    TEST_EXPECT(distinct, "every online CPU has its own APIC ID");
+    for (int cpu = 1; cpu < NR_CPUS; cpu++) {
+        if (cpu_data[cpu].online) {
+            TEST_EXPECT(cpu_data[cpu].idle && cpu_data[cpu].current == cpu_data[cpu].idle,
+                        "AP runs its idle task");
+            TEST_EXPECT(tss_df[cpu].esp != tss_df[0].esp, "AP has its own double fault stack");
+        }
+    }
+}
+
+void run_smp_tests(void)
+{
+    pr_notice("=== SMP TESTS ===\n");
+
+    test_percpu_segment();
+    test_cpus_online();
+}
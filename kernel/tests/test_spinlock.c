@@ -0,0 +1,111 @@
+#include "printk.h"
+#include "spinlock.h"
+#include "task.h"
+#include "smp.h"
+#include "tests/test_spinlock.h"
+#include "tests/test_runner.h"
+
+/**
+ * Spinlock, ticket lock and MCS lock tests
+ */
+#define LOCK_ROUNDS 20000
+
+static DEFINE_SPINLOCK(test_spin);
+static DEFINE_TICKET_LOCK(test_ticket);
+static DEFINE_MCS_LOCK(test_mcs);
+
+static volatile uint32_t spin_count;
+static volatile uint32_t ticket_count;
+static volatile uint32_t mcs_count;
+static volatile int workers_done;
+
+// Split read-modify-write: loses updates unless the lock excludes others
+static inline void slow_inc(volatile uint32_t *counter)
+{
+    uint32_t val = *counter;
+    cpu_relax();
+    *counter = val + 1;
+}
+
+static void lock_worker(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < LOCK_ROUNDS; i++) {
+        uint32_t flags = spin_lock_irqsave(&test_spin);
+        slow_inc(&spin_count);
+        spin_unlock_irqrestore(&test_spin, flags);
+
+        flags = ticket_lock_irqsave(&test_ticket);
+        slow_inc(&ticket_count);
+        ticket_unlock_irqrestore(&test_ticket, flags);
+
+        struct mcs_node node;
+        flags = mcs_lock_irqsave(&test_mcs, &node);
+        slow_inc(&mcs_count);
+        mcs_unlock_irqrestore(&test_mcs, &node, flags);
+    }
+    __atomic_fetch_add(&workers_done, 1, __ATOMIC_RELEASE);
+}
+
+static void test_lock_basics(void)
+{
+    TEST_EXPECT(spin_trylock(&test_spin), "spin_trylock takes a free lock");
+    TEST_EXPECT(!spin_trylock(&test_spin), "spin_trylock fails on a held lock");
+    spin_unlock(&test_spin);
+
+    ticket_lock(&test_ticket);
+    TEST_EXPECT(ticket_is_locked(&test_ticket), "ticket lock reads as held");
+    ticket_unlock(&test_ticket);
+    TEST_EXPECT(!ticket_is_locked(&test_ticket), "ticket lock reads as free after unlock");
+
+    struct mcs_node node;
+    mcs_lock(&test_mcs, &node);
+    TEST_EXPECT(test_mcs.tail == &node, "MCS lock tail is the holder's node");
+    mcs_unlock(&test_mcs, &node);
+    TEST_EXPECT(test_mcs.tail == NULL, "MCS lock is free after unlock");
+}
+
+static void test_lock_exclusion(void)
+{
+    int workers = 0;
+
+    spin_count = 0;
+    ticket_count = 0;
+    mcs_count = 0;
+    workers_done = 0;
+    lock_stat_reset();
+
+    // One worker per CPU that runs tasks, all hammering the same locks
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (sched_cpu_active(cpu) && kthread_create_on_cpu(lock_worker, NULL, "locker", cpu)) {
+            workers++;
+        }
+    }
+    for (int spins = 0; workers_done < workers && spins < 2000; spins++) {
+        msleep(1);
+    }
+
+    uint32_t expected = (uint32_t)workers * LOCK_ROUNDS;
+    printk("  %d workers: spin=%u ticket=%u mcs=%u (expected %u each)\n",
+           workers, spin_count, ticket_count, mcs_count, expected);
+    TEST_EXPECT(workers_done == workers, "lock workers finished");
+    TEST_EXPECT(spin_count == expected, "spinlock_t excludes concurrent holders");
+    TEST_EXPECT(ticket_count == expected, "ticket lock excludes concurrent holders");
+    TEST_EXPECT(mcs_count == expected, "MCS lock excludes concurrent holders");
+
+#if CONFIG_LOCK_STAT
+    TEST_EXPECT(test_spin.stat.acquisitions == expected &&
+                test_ticket.stat.acquisitions == expected &&
+                test_mcs.stat.acquisitions == expected,
+                "lock statistics count every acquisition");
+    lock_stat_dump();
+#endif
+}
+
+void run_spinlock_tests(void)
+{
+    pr_notice("=== SPINLOCK TESTS ===\n");
+
+    test_lock_basics();
+    test_lock_exclusion();
+}
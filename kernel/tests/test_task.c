@@ -0,0 +1,329 @@
+#include "printk.h"
+#include "task.h"
+#include "paging.h"
+#include "pmm.h"
+#include "clock.h"
+#include "arch/x86/cpu.h"
+#include "arch/x86/interrupt.h"
+#include "tests/test_task.h"
+#include "tests/test_runner.h"
+
+/**
+ * Kernel thread and context switch tests
+ */
+#define PINGPONG_ROUNDS 3
+
+static char pingpong_log[2 * PINGPONG_ROUNDS + 1];
+static volatile int pingpong_len;
+static volatile int threads_done;
+
+// Order-sensitive tests keep their threads on this CPU, next to the test
+static struct task* test_thread(void (*fn)(void *arg), void *arg, const char *name)
+{
+    return kthread_create_on_cpu(fn, arg, name, smp_processor_id());
+}
+
+static void pingpong_fn(void *arg)
+{
+    char id = (char)(uintptr_t)arg;
+    for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+        pingpong_log[pingpong_len++] = id;
+        yield();
+    }
+    threads_done++;
+}
+
+// Yield until `count` threads have finished (and their exits were reaped)
+static void wait_for_threads(int count)
+{
+    for (int spins = 0; threads_done < count && spins < 1000; spins++) {
+        yield();
+    }
+    // One more round so the last exited task gets freed
+    yield();
+}
+
+static void test_pingpong(void)
+{
+    pingpong_len = 0;
+    threads_done = 0;
+
+    struct task *a = test_thread(pingpong_fn, (void*)'a', "ping");
+    struct task *b = test_thread(pingpong_fn, (void*)'b', "pong");
+    TEST_EXPECT(a && b, "kthread_create returns a task");
+
+    wait_for_threads(2);
+    pingpong_log[pingpong_len] = '\0';
+
+    printk("  switch order: %s\n", pingpong_log);
+    int interleaved = (pingpong_len == 2 * PINGPONG_ROUNDS);
+    for (int i = 0; interleaved && i < pingpong_len; i++) {
+        interleaved = (pingpong_log[i] == ((i & 1) ? 'b' : 'a'));
+    }
+    TEST_EXPECT(interleaved, "yield alternates round-robin between threads");
+}
+
+static volatile int guard_checked;
+
+static void guard_fn(void *arg)
+{
+    struct task *self = get_current();
+    (void)arg;
+
+    guard_checked = paging_is_mapped(self->stack_top - PAGE_SIZE) &&
+                    !paging_is_mapped(self->stack_bottom - PAGE_SIZE) &&
+                    task_stack_guard_owner(self->stack_bottom - PAGE_SIZE) == self;
+    threads_done++;
+}
+
+static void test_stack_lifecycle(void)
+{
+    threads_done = 0;
+    guard_checked = 0;
+    int tasks_before = task_count();
+    uint32_t frames_before = pmm_used_frames();
+
+    struct task *t = test_thread(guard_fn, NULL, "guard");
+    TEST_EXPECT(t != NULL, "thread created");
+    TEST_EXPECT(pmm_used_frames() == frames_before + KTHREAD_STACK_SIZE / PAGE_SIZE,
+                "stack pages are allocated up front");
+
+    uint32_t bottom = t->stack_bottom;
+    wait_for_threads(1);
+
+    TEST_EXPECT(guard_checked, "stack mapped below a guard page");
+    TEST_EXPECT(task_count() == tasks_before, "exited thread is reaped");
+    TEST_EXPECT(pmm_used_frames() == frames_before, "exited thread's stack frames are freed");
+    TEST_EXPECT(!paging_is_mapped(bottom), "exited thread's stack is unmapped");
+}
+
+#define SWITCH_ROUNDS 1000
+
+static void spinner_fn(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < SWITCH_ROUNDS; i++) {
+        yield();
+    }
+    threads_done++;
+}
+
+static void test_switch_cost(void)
+{
+    threads_done = 0;
+    test_thread(spinner_fn, NULL, "spinner");
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SWITCH_ROUNDS; i++) {
+        yield();
+    }
+    uint64_t cycles = rdtsc() - start;
+    wait_for_threads(1);
+
+    // Each round trip is two switches
+    uint32_t per_switch = (uint32_t)(cycles >> 1) / SWITCH_ROUNDS;
+    printk("  yield round trip: %u cycles per switch\n", per_switch);
+    TEST_EXPECT(threads_done == 1, "spinner ran to completion");
+}
+
+static char prio_log[4];
+static volatile int prio_len;
+
+static void prio_fn(void *arg)
+{
+    prio_log[prio_len++] = (char)(uintptr_t)arg;
+    threads_done++;
+}
+
+static void test_priority_order(void)
+{
+    struct task *self = get_current();
+    threads_done = 0;
+    prio_len = 0;
+
+    // Queued at the default priority first, then reprioritized
+    struct task *lo = test_thread(prio_fn, (void*)'l', "prio-lo");
+    struct task *hi = test_thread(prio_fn, (void*)'h', "prio-hi");
+    sched_set_prio(lo, self->prio + 4);
+    TEST_EXPECT(prio_len == 0, "lowering a queued task does not run anything");
+    sched_set_prio(hi, self->prio - 4);
+    TEST_EXPECT(prio_len == 1 && prio_log[0] == 'h', "raising a task above current preempts at once");
+
+    yield();
+    TEST_EXPECT(prio_len == 1, "yield does not give way to a less urgent task");
+
+    // Blocking lets the low priority task in
+    msleep(5);
+    TEST_EXPECT(prio_len == 2 && prio_log[1] == 'l', "less urgent task runs while current sleeps");
+    wait_for_threads(2);
+}
+
+static void test_msleep(void)
+{
+    if (!clockevent_get()) {
+        pr_info("[SKIP] no clock event device\n");
+        return;
+    }
+
+    uint64_t start = ktime_get_ns();
+    msleep(10);
+    uint64_t slept = ktime_get_ns() - start;
+
+    TEST_EXPECT(slept >= 10 * NSEC_PER_MSEC, "msleep sleeps at least as long as asked");
+    TEST_EXPECT(slept < 100 * NSEC_PER_MSEC, "msleep wakes up in time");
+}
+
+static volatile uint32_t spin_counts[2];
+static volatile int spin_stop;
+
+// Never yields: can only share the CPU through preemption
+static void hog_fn(void *arg)
+{
+    int idx = (int)(uintptr_t)arg;
+    while (!spin_stop) {
+        spin_counts[idx]++;
+    }
+    threads_done++;
+}
+
+static void test_preemption(void)
+{
+    if (!clockevent_get()) {
+        pr_info("[SKIP] no clock event device\n");
+        return;
+    }
+
+    threads_done = 0;
+    spin_stop = 0;
+    spin_counts[0] = 0;
+    spin_counts[1] = 0;
+    uint32_t preempt_before = sched_nr_preemptions();
+
+    test_thread(hog_fn, (void*)0, "hog0");
+    test_thread(hog_fn, (void*)1, "hog1");
+
+    // Busy wait too; the hogs only get the CPU when this thread's slice ends
+    uint32_t flags = irq_save();
+    irq_enable();
+    mdelay(5 * SCHED_TIMESLICE_NS / NSEC_PER_MSEC);
+    spin_stop = 1;
+    irq_restore(flags);
+    wait_for_threads(2);
+
+    printk("  hog0=%u hog1=%u iterations, %u preemptions\n",
+           spin_counts[0], spin_counts[1], sched_nr_preemptions() - preempt_before);
+    TEST_EXPECT(spin_counts[0] && spin_counts[1], "CPU-bound threads share the CPU");
+    TEST_EXPECT(sched_nr_preemptions() - preempt_before >= 2, "time slices end with a preemption");
+}
+
+#define STEAL_THREADS 4
+
+static volatile int ran_on[STEAL_THREADS];
+
+// Busy for a while so the other threads pile up behind it
+static void busy_fn(void *arg)
+{
+    ran_on[(uintptr_t)arg] = smp_processor_id();
+    mdelay(2);
+    __atomic_fetch_add(&threads_done, 1, __ATOMIC_RELEASE);
+}
+
+// APs only run tasks when each has its own clock event device
+static int aps_schedule(void)
+{
+    struct clock_event_device *dev = clockevent_get();
+    return smp_num_cpus() > 1 && dev && (dev->features & CLOCK_EVT_FEAT_PERCPU);
+}
+
+static void test_work_stealing(void)
+{
+    if (!aps_schedule()) {
+        pr_info("[SKIP] no second CPU running tasks\n");
+        return;
+    }
+
+    threads_done = 0;
+    uint32_t steals_before = 0;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        steals_before += sched_nr_steals(cpu);
+    }
+
+    // All queued here; idle CPUs get kicked and take some
+    for (int i = 0; i < STEAL_THREADS; i++) {
+        ran_on[i] = -1;
+        kthread_create(busy_fn, (void*)(uintptr_t)i, "busy");
+    }
+    for (int spins = 0; threads_done < STEAL_THREADS && spins < 100; spins++) {
+        msleep(1);
+    }
+    // Let the last ones be reaped
+    msleep(1);
+
+    uint32_t cpus_used = 0;
+    uint32_t steals = 0;
+    for (int i = 0; i < STEAL_THREADS; i++) {
+        if (ran_on[i] >= 0) {
+            cpus_used |= 1u << ran_on[i];
+        }
+    }
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        steals += sched_nr_steals(cpu);
+    }
+    steals -= steals_before;
+
+    printk("  %d threads ran on CPU mask 0x%x, %u steals\n",
+           STEAL_THREADS, cpus_used, steals);
+    TEST_EXPECT(threads_done == STEAL_THREADS, "threads queued on one CPU all ran");
+    TEST_EXPECT((cpus_used & (cpus_used - 1)) && steals > 0,
+                "idle CPUs steal queued threads");
+}
+
+static volatile int remote_cpu;
+
+static void remote_fn(void *arg)
+{
+    (void)arg;
+    remote_cpu = smp_processor_id();
+    __atomic_fetch_add(&threads_done, 1, __ATOMIC_RELEASE);
+}
+
+static void test_remote_wakeup(void)
+{
+    int target = -1;
+    for (int cpu = 1; cpu < NR_CPUS && target < 0; cpu++) {
+        if (cpu_data[cpu].online) {
+            target = cpu;
+        }
+    }
+    if (target < 0 || !aps_schedule()) {
+        pr_info("[SKIP] no second CPU running tasks\n");
+        return;
+    }
+
+    threads_done = 0;
+    remote_cpu = -1;
+
+    // Woken from here onto the other CPU's wake list, delivered by IPI
+    struct task *t = kthread_create_on_cpu(remote_fn, NULL, "remote", target);
+    TEST_EXPECT(t != NULL, "thread created for another CPU");
+    for (int spins = 0; threads_done < 1 && spins < 100; spins++) {
+        msleep(1);
+    }
+    msleep(1);
+
+    TEST_EXPECT(remote_cpu == target, "thread pinned to another CPU runs there");
+}
+
+void run_task_tests(void)
+{
+    pr_notice("=== TASK TESTS ===\n");
+
+    test_pingpong();
+    test_stack_lifecycle();
+    test_switch_cost();
+    test_priority_order();
+    test_msleep();
+    test_preemption();
+    test_work_stealing();
+    test_remote_wakeup();
+}
@@ -0,0 +1,97 @@
+#include "printk.h"
+#include "trace.h"
+#include "task.h"
+#include "smp.h"
+#include "arch/x86/interrupt.h"
+#include "tests/test_trace.h"
+#include "tests/test_runner.h"
+
+/**
+ * Trace ring tests
+ */
+static const char trace_remote_fmt[] = "trace test from cpu%d";
+
+static volatile int remote_done;
+
+// An event lands in this CPU's ring and formats like a printk of it
+static void test_trace_record(void)
+{
+    char msg[64];
+
+    // Interrupt handlers trace too: keep them off the ring until checked
+    uint32_t flags = irq_save();
+    struct trace_ring *ring = &trace_rings[smp_processor_id()];
+    uint32_t head = ring->head;
+
+    trace_event("trace test a=%u b=0x%x", 7, 0xbeef);
+
+    const struct trace_record *rec = &ring->rec[head & (TRACE_RING_ENTRIES - 1)];
+    int recorded = ring->head == head + 1;
+    int stored = rec->fmt && rec->args[0] == 7 && rec->args[1] == 0xbeef;
+    trace_format(msg, sizeof(msg), rec);
+
+    trace_stop();
+    trace_event("trace test while stopped");
+    int stopped = ring->head == head + 1;
+    trace_start();
+    irq_restore(flags);
+
+    TEST_EXPECT(recorded, "event takes one slot of this CPU's ring");
+    TEST_EXPECT(stored, "record keeps the format and raw arguments");
+    TEST_EXPECT(test_str_equal(msg, "trace test a=7 b=0xbeef"), "record formats like printk");
+    TEST_EXPECT(stopped, "nothing is recorded while stopped");
+}
+
+static void trace_remote_fn(void *arg)
+{
+    (void)arg;
+    trace_event(trace_remote_fmt, smp_processor_id());
+    __atomic_store_n(&remote_done, 1, __ATOMIC_RELEASE);
+}
+
+// Events of another CPU go to that CPU's ring
+static void test_trace_percpu(void)
+{
+    int target = -1;
+    for (int cpu = 1; cpu < NR_CPUS && target < 0; cpu++) {
+        if (sched_cpu_active(cpu)) {
+            target = cpu;
+        }
+    }
+    if (target < 0) {
+        pr_info("[SKIP] no second CPU running tasks\n");
+        return;
+    }
+
+    remote_done = 0;
+    struct task *t = kthread_create_on_cpu(trace_remote_fn, NULL, "tracer", target);
+    TEST_EXPECT(t != NULL, "thread created for another CPU");
+    for (int spins = 0; !remote_done && spins < 100; spins++) {
+        msleep(1);
+    }
+
+    const struct trace_ring *ring = &trace_rings[target];
+    uint32_t head = ring->head;
+    uint32_t count = head < TRACE_RING_ENTRIES ? head : TRACE_RING_ENTRIES;
+    int found = 0;
+    for (uint32_t i = head - count; i != head && !found; i++) {
+        const struct trace_record *rec = &ring->rec[i & (TRACE_RING_ENTRIES - 1)];
+        found = rec->fmt == trace_remote_fmt && rec->args[0] == (uint32_t)target;
+    }
+    TEST_EXPECT(found, "event of another CPU is in that CPU's ring");
+}
+
+void run_trace_tests(void)
+{
+    pr_notice("=== TRACE TESTS ===\n");
+
+    int was_enabled = trace_enabled;
+    trace_start();
+
+    test_trace_record();
+    test_trace_percpu();
+
+    if (!was_enabled) {
+        trace_stop();
+    }
+}
@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Generate the kernel symbol table (see kernel/include/ksyms.h).
+#
+#   scripts/gen_ksyms.sh <kernel.elf>  >  ksyms.c
+#
+# Text symbols only, sorted by address; of several names at one address
+# the first nm lists wins. Local labels (.L*) are skipped.
+
+set -eu
+
+elf=$1
+
+nm -n --defined-only "$elf" | awk '
+    BEGIN { n = 0 }
+    NF == 3 && $2 ~ /^[tTwW]$/ && $3 !~ /^\.L/ && $1 != last {
+        addr[n] = $1; name[n] = $3; last = $1; n++
+    }
+    END {
+        print "// Generated by scripts/gen_ksyms.sh, do not edit"
+        print "#include <stdint.h>"
+        print ""
+        print "#define KSYMS __attribute__((section(\".ksyms\")))"
+        print ""
+        printf "const uint32_t ksym_count KSYMS = %d;\n\n", n
+        print "const uint32_t ksym_addrs[] KSYMS = {"
+        for (i = 0; i < n; i++) printf "    0x%s,\n", addr[i]
+        print "};\n"
+        print "const uint32_t ksym_name_offs[] KSYMS = {"
+        off = 0
+        for (i = 0; i < n; i++) { printf "    %d,\n", off; off += length(name[i]) + 1 }
+        print "};\n"
+        print "const char ksym_names[] KSYMS ="
+        for (i = 0; i < n; i++) printf "    \"%s\\0\"\n", name[i]
+        print "    ;"
+    }'
@@ -0,0 +1,126 @@
+#!/bin/bash
+#
+# Run the kernel test and benchmark suites in headless QEMU and judge them.
+#
+#   scripts/run_qemu_tests.sh [options]
+#
+#   --tests-only            Skip the benchmarks
+#   --bench-only            Skip the tests
+#   --baseline FILE         Fail if a benchmark median is more than
+#                           --threshold percent slower than in FILE
+#   --save-baseline FILE    Write this run's BENCH lines to FILE
+#   --threshold PCT         Allowed slowdown against the baseline (default 10)
+#   --timeout SEC           Kill a run that takes longer (default 120)
+#   --out DIR               Logs and results (default build/qemu-tests)
+#
+# Each suite is built in a BUILDDIR of its own (objects differ in their
+# -D flags) and run with `make test-headless` / `make bench-headless`.
+# The serial log of every run is kept; the TEST and BENCH lines in it
+# (see tests/test_runner.h and bench.h) and the wall time of each run
+# are collected in results.txt. Exits non-zero if a suite failed, QEMU
+# did not exit with the success code, or a benchmark regressed.
+
+set -u
+
+run_tests=1
+run_bench=1
+baseline=""
+save_baseline=""
+threshold=10
+timeout_sec=120
+out=build/qemu-tests
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        --tests-only)    run_bench=0 ;;
+        --bench-only)    run_tests=0 ;;
+        --baseline)      baseline=$2; shift ;;
+        --save-baseline) save_baseline=$2; shift ;;
+        --threshold)     threshold=$2; shift ;;
+        --timeout)       timeout_sec=$2; shift ;;
+        --out)           out=$2; shift ;;
+        -h|--help)       sed -n '3,21p' "$0" | sed 's/^# \{0,1\}//'; exit 0 ;;
+        *)               echo "unknown option: $1" >&2; exit 2 ;;
+    esac
+    shift
+done
+
+cd "$(dirname "$0")/.." || exit 2
+mkdir -p "$out"
+results=$out/results.txt
+: > "$results"
+failed=0
+
+# run_suite <name> <make target>
+run_suite() {
+    local name=$1 target=$2
+    local log=$out/$name.log
+    local start end status
+
+    echo "=== $name: make $target"
+    start=$(date +%s%N)
+    timeout "$timeout_sec" make --no-print-directory BUILDDIR="$out/build-$name" "$target" > "$log" 2>&1
+    status=$?
+    end=$(date +%s%N)
+
+    # The serial port is raw: drop carriage returns before parsing
+    sed -i 's/\r$//' "$log"
+    grep -E '^(TEST|BENCH) ' "$log" >> "$results"
+    echo "RUN name=$name status=$status ms=$(( (end - start) / 1000000 ))" >> "$results"
+
+    if [ $status -eq 124 ]; then
+        echo "$name: timed out after ${timeout_sec}s (log: $log)"
+        failed=1
+    elif [ $status -ne 0 ]; then
+        echo "$name: failed (log: $log)"
+        grep -E '^TEST .*result=FAIL|QEMU exit status|\[PANIK\]' "$log"
+        failed=1
+    elif ! grep -qE '^(TEST|BENCH) done' "$log"; then
+        echo "$name: no results on the serial port (log: $log)"
+        failed=1
+    else
+        echo "$name: ok"
+    fi
+}
+
+[ $run_tests -eq 1 ] && run_suite test test-headless
+[ $run_bench -eq 1 ] && run_suite bench bench-headless
+
+if [ $run_tests -eq 1 ]; then
+    awk '/^TEST name=/ { printf "  %-16s %s\n", substr($2, 6), $3 " " $5 }' "$results"
+fi
+
+if [ $run_bench -eq 1 ]; then
+    if [ -n "$save_baseline" ]; then
+        grep '^BENCH name=' "$results" > "$save_baseline"
+        echo "Baseline written to $save_baseline"
+    fi
+
+    # Median cycles per benchmark, compared against the baseline's
+    if [ -n "$baseline" ]; then
+        if ! awk -v thr="$threshold" '
+            function field(line, key,    i, n, kv) {
+                n = split(line, kv, " ")
+                for (i = 1; i <= n; i++) {
+                    if (index(kv[i], key "=") == 1) return substr(kv[i], length(key) + 2)
+                }
+                return ""
+            }
+            FNR == NR { if (/^BENCH name=/) base[field($0, "name")] = field($0, "median"); next }
+            /^BENCH name=/ {
+                name = field($0, "name"); now = field($0, "median")
+                if (!(name in base)) { printf "  %-24s %10s %10d  (new)\n", name, "-", now; next }
+                pct = base[name] ? (now - base[name]) * 100.0 / base[name] : 0
+                flag = pct > thr ? "  REGRESSION" : ""
+                printf "  %-24s %10d %10d %+7.1f%%%s\n", name, base[name], now, pct, flag
+                if (flag != "") bad = 1
+            }
+            END { exit bad }' "$baseline" "$results"; then
+            echo "Benchmarks regressed by more than ${threshold}% against $baseline"
+            failed=1
+        fi
+    fi
+fi
+
+echo "Results in $results"
+exit $failed